@@ -8,14 +8,44 @@
 #include <glm/gtx/transform.hpp>
 #include <math.h>
 
+#include "gl_state.hpp"
 #include "shader_loader.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+// scene color and history formats and their size per texel
+const GLenum TAA_FORMATS[TAA_FORMAT_COUNT]          = {GL_RGBA32F, GL_RGBA16F, GL_R11F_G11F_B10F};
+const char* const TAA_FORMAT_NAMES[TAA_FORMAT_COUNT] = {"RGBA32F", "RGBA16F", "R11G11B10F"};
+const unsigned TAA_FORMAT_BYTES[TAA_FORMAT_COUNT]    = {16, 8, 4};
+// difference to the cpu reference accepted per format, about one unit in the last place of
+// the output near 1, r11g11b10f has 5 mantissa bits in blue
+const float TAA_FORMAT_TOLERANCE[TAA_FORMAT_COUNT] = {1e-4f, 2e-3f, 4e-2f};
+const char* const TAA_KERNEL_NAMES[TAA_KERNEL_COUNT] = {"reference", "tiled"};
+// profiler markers of each variant, string literals outlive the profiler
+const char* const TAA_VARIANT_NAMES[TAA_KERNEL_COUNT][TAA_FORMAT_COUNT] = {
+    {"taa reference RGBA32F", "taa reference RGBA16F", "taa reference R11G11B10F"},
+    {"taa tiled RGBA32F", "taa tiled RGBA16F", "taa tiled R11G11B10F"}};
+// color texels fetched per pixel, the tiled kernel reads each 18x18 apron tile once per 16x16 pixels
+const float TAA_COLOR_FETCHES[TAA_KERNEL_COUNT] = {9.0f, 18.0f * 18.0f / (16.0f * 16.0f)};
+// frames every variant runs during a comparison
+const unsigned TAA_COMPARE_FRAMES = 60;
+// frames native and scaled rendering run during an upscale comparison, the history converges
+// during the first ones, which are left out of the timings
+const unsigned UPSCALE_COMPARE_FRAMES = 180;
+const unsigned UPSCALE_SETTLE_FRAMES  = 60;
+// frames per phase of the lod comparison, the first are not measured
+const unsigned LOD_COMPARE_FRAMES = 120;
+const unsigned LOD_SETTLE_FRAMES  = 20;
 
 
 void Assignment01::update(float dt)
 {
     // when rotation is enabled, compute new angle and update view matrix
-    if (rotateCam && !freeze)
+    // the upscale and lod comparisons need the same view in both phases
+    if (rotateCam && !freeze && upscaleComparePhase < 0 && lodComparePhase < 0)
     {
         m_cam.camRotation( dt * degreesPerSecond / 180.0f * 3.1415f );
         updateCamera();
@@ -24,47 +54,83 @@ void Assignment01::update(float dt)
 
 void Assignment01::render()
 {
+    collectTaaTimings();
+    {
+        // the comparisons switch parameters the simulation step reads
+        auto lock = simulationLock();
+        advanceTaaComparison();
+        advanceUpscaleComparison();
+        advanceLodComparison();
+    }
+
     // calc jitterd proj and weights
     jitterAndWeight();
 
-    // render scene to temporary buffer
-    fbo.bind();
+    // scene at the render resolution, its targets are only needed until the taa pass
+    GLenum format               = TAA_FORMATS[taaFormat];
+    RenderGraph::Resource color = graph.transient({renderResolution(), format});
+    RenderGraph::Resource depth = graph.transient({renderResolution(), GL_DEPTH_COMPONENT32});
+    graph
+        .addPass("scene",
+                 [this]() {
+                     auto scope = profile("renderScene");
+                     glClearColor(0.2f, 0.2f, 0.2f, 1);
+                     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                     gl_state::set_enabled(GL_DEPTH_TEST, true);
+
+                     renderScene();
+                 })
+        .color(color)
+        .depth(depth);
+
+    // compute taa, the history is kept at the output resolution
+    RenderGraph::Resource shown = color;
+    if (useTaa)
     {
-        glClearColor(0.2f, 0.2f, 0.2f, 1);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
-
-        renderScene();
+        RenderGraph::History history = graph.history("taa", {resolution(), format});
+        initTaa |= history.reset;
+        graph
+            .addPass("taa",
+                     [this, color, depth, history]() {
+                         auto scope = profile("taaPass");
+                         taaPass();
+                         if (taaValidate)
+                         {
+                             validateTaa(color, depth, history);
+                         }
+                         if (taaCapture || taaCaptureContinuous)
+                         {
+                             captureTaa(history.current);
+                         }
+                     })
+            .sample(color, 0)
+            .sample(history.previous, 1)
+            .sample(depth, 3)
+            .image(history.current, 2, GL_WRITE_ONLY);
+        shown = history.current;
     }
-    fbo.unbind();
-
-    // compute taa
-    if (useTaa)
-        taaPass();
     else
         initTaa = true;
 
     // render quad
-    {
-        glClearColor(0.2f, 0.2f, 0.2f, 1);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glDisable(GL_DEPTH_TEST);
-        glUseProgram(shader("quad"));
-
-        glActiveTexture(GL_TEXTURE0);
-        if (useTaa)
-            taa_out->bind();
-        else
-            color_buffer.bind();
-
-        uniform("quad", "tex", 0);
-        uniform("quad", "zoom", zoom);
-        uniform("quad", "res", resolution());
-
-        quad.draw();
-        glEnable(GL_DEPTH_TEST);
-    }
-    glUseProgram(0);
+    graph
+        .addPass("quad",
+                 [this]() {
+                     auto scope = profile("quad");
+                     glClearColor(0.2f, 0.2f, 0.2f, 1);
+                     glClear(GL_COLOR_BUFFER_BIT);
+                     gl_state::set_enabled(GL_DEPTH_TEST, false);
+                     gl_state::use_program(shader("quad"));
+
+                     quad_tex.set(0);
+                     quad_zoom.set(zoom);
+                     quad_res.set(resolution());
+
+                     quad.draw();
+                 })
+        .sample(shown, 0);
+
+    graph.execute(resolution());
 }
 
 
@@ -96,50 +162,30 @@ void Assignment01::jitterAndWeight()
     const float jitterY = HALTON23[frameId][1];
     frameId             = (frameId + 1) % samples;
 
-    // jitter projection
-    jittProjMatrix = projectionMatrix();
+    // jitter projection, in pixels of the render resolution so a reduced resolution
+    // still covers its whole pixel area over the sequence
+    glm::uvec2 size = renderResolution();
+    jittProjMatrix  = projectionMatrix();
     // TODO a) setup jittered projection for the current frame (screen space translation)
     // Note the matrix layout if altering the matrix directly
-    jittProjMatrix[2][0] += jitterX / static_cast<float>(resolution().x);
-    jittProjMatrix[2][1] += jitterY / static_cast<float>(resolution().y);
+    jittProjMatrix[2][0] += jitterX / static_cast<float>(size.x);
+    jittProjMatrix[2][1] += jitterY / static_cast<float>(size.y);
+    // the translation is -jitter / 2 pixels as clip w is -z, so pixel centers sample +jitter / 2,
+    // the upsampling resolve weights the samples by their distance to each output pixel
+    jitter = glm::fvec2(jitterX, jitterY) * 0.5f;
 
 
     // TODO b) calculate normalized filter weights (3x3 pixels) for the current frame
-    const float sampleOffsets[9][2] = {{-1.0f, -1.0f}, {0.0f, -1.0f}, {1.0f, -1.0f}, {-1.0f, 0.0f}, {0.0f, 0.0f},
-                                       {1.0f, 0.0f},   {-1.0f, 1.0f}, {0.0f, 1.0f},  {1.0f, 1.0f}};
-    glm::vec2 jittMiddle = glm::vec2(jitterX, jitterY);
-    float weightSum = 0;
-    for (int i = 0; i < 9; i++) {
-        // Get middle pixel with jitter applied
-        // Calculate euclid distance to jittered middle point
-        glm::vec2 offsetVec = glm::vec2(sampleOffsets[i][0], sampleOffsets[i][1]);
-        float distance = glm::distance(jittMiddle, offsetVec);
-        weights[i] = exp(-2.29f * (distance * distance));
-        weightSum += weights[i];
-    }
-    for (int i = 0; i < 9; i++) {
-        // Normalize
-        weights[i] /= weightSum;
-        //printf("%f\n", weights[i]);
-    }
-    //printf("asd\n");
+    weights = taaFilterWeights(glm::fvec2(jitterX, jitterY));
 }
 
-void Assignment01::renderScene() const
+void Assignment01::buildInstances()
 {
-    glUseProgram(shader("scene"));
-    uniform("scene", "lightDir", lightDir);
-    uniform("scene", "viewMatrix", viewMatrix());
-
-    if (useTaa)
-        uniform("scene", "projMatrix", jittProjMatrix);
-    else
-        uniform("scene", "projMatrix", projectionMatrix());
-
     glm::fvec3 colors[5] = {glm::fvec3(1, 1, 0), glm::fvec3(0.91, 0.54, 0), glm::fvec3(1, 0, 0),
                             glm::fvec3(0.4, 0, 0.91), glm::fvec3(0, 0.65, 1)};
 
-    uniform("scene", "pattern", false);
+    // color alpha selects the checker pattern
+    sceneInstances.clear();
     for (int i = 0; i < 10; ++i)
     {
         float rad  = ((float)i / 10.f) * (float)M_PI * 2;
@@ -147,43 +193,101 @@ void Assignment01::renderScene() const
         float x    = glm::cos(rad) * dist;
         float y    = glm::sin(rad) * dist;
 
-        uniform("scene", "color", colors[i % 5]);
-        uniform("scene", "modelMatrix",
-                glm::translate(glm::fvec3(x, 0, y)) * glm::scale(glm::fmat4{1.0f}, glm::fvec3(2.5, 2.5, 2.5)));
-        teaPot.draw();
+        sceneInstances.push_back(
+            {&teaPot, {glm::translate(glm::fvec3(x, 0, y)) * glm::scale(glm::fmat4{1.0f}, glm::fvec3(2.5, 2.5, 2.5)),
+                       glm::fvec4(colors[i % 5], 0.0f)}});
+    }
+    // grid of smaller teapots around the ring to give the culling some work
+    int side = static_cast<int>(glm::ceil(glm::sqrt(static_cast<float>(crowdSize))));
+    for (int i = 0; i < crowdSize; ++i)
+    {
+        glm::fvec2 cell = (glm::fvec2(glm::ivec2(i % side, i / side)) - glm::fvec2(glm::ivec2(side - 1)) * 0.5f) * 4.0f;
+        sceneInstances.push_back({&teaPot, {glm::translate(glm::fvec3(cell.x, 0.5f, cell.y)), glm::fvec4(colors[i % 5], 0.0f)}});
     }
 
     // render plane
-    uniform("scene", "pattern", true);
-    uniform("scene", "color", glm::fvec3(0.8f, 0.8f, 0.8f));
-    uniform("scene", "modelMatrix", glm::fmat4{1.0f});
-    plane.draw();
+    sceneInstances.push_back({&plane, {glm::fmat4{1.0f}, glm::fvec4(0.8f, 0.8f, 0.8f, 1.0f)}});
+
+    // the bvh is built on the next cull and kept while the scene stays the same
+    visibility.clear();
+    for (SceneInstance const& instance : sceneInstances)
+    {
+        visibility.add(transform_bounds(instance.model->bounds(), instance.data.modelMatrix));
+    }
+    builtCrowdSize = crowdSize;
+}
 
-    glUseProgram(0);
+void Assignment01::renderScene()
+{
+    gl_state::use_program(shader("scene"));
+
+    CameraBlock camera{viewMatrix(), useTaa ? jittProjMatrix : projectionMatrix(), glm::fvec4(lightDir, 0.0f)};
+    uniformBlock(CAMERA_BLOCK, camera);
+
+    // teapot ring and plane in a single multi draw
+    currentScene().batch.submit(arena);
 }
 
-void Assignment01::taaPass()
+std::shared_ptr<SceneSnapshot> Assignment01::buildScene(FrameSnapshot const& frame)
 {
-    std::swap(taa_in, taa_out);
+    if (builtCrowdSize != crowdSize)
+    {
+        buildInstances();
+    }
+
+    // the jitter moves the frustum by less than a pixel, the unjittered one is close enough
+    visibility.setMode(static_cast<Visibility::Mode>(cullMode));
+    visibility.cull(extract_frustum(projectionMatrix() * frame.view));
+    std::shared_ptr<SceneFrame> scene = std::make_shared<SceneFrame>();
+    scene->renderScale = renderScale;
+    scene->freeze      = freeze;
+    bool const lod     = lodComparePhase < 0 ? useLod : lodComparePhase == 1;
+    float const height = float(renderResolution(renderScale).y);
+    for (std::uint32_t index : visibility.visibleInstances())
+    {
+        simpleModel const& model = *sceneInstances[index].model;
+        std::size_t level =
+            lod ? model.selectLod(visibility.bounds(index), frame.view, projectionMatrix(), height, lodPixelError) : 0;
+        scene->batch.add(model.mesh(level), sceneInstances[index].data);
+    }
+    return scene;
+}
 
-    glUseProgram(shader("taa"));
-    GLint work_size[3];
-    glGetProgramiv(shader("taa"), GL_COMPUTE_WORK_GROUP_SIZE, work_size);
+Assignment01::SceneFrame& Assignment01::currentScene() const
+{
+    return static_cast<SceneFrame&>(*frame().scene);
+}
+
+void Assignment01::taaPass()
+{
+    // only the tiled kernel reconstructs from a reduced render resolution
+    int kernel          = currentScene().renderScale < 1.0f ? TAA_TILED : taaKernel;
+    char const* program = kernel == TAA_TILED ? "taaTiled" : "taa";
+    gl_state::use_program(shader(program));
+    // work group size is reflected once after linking
+    glm::ivec3 const& work_size = shaderInfo(program).work_group_size;
     unsigned w = resolution().x, h = resolution().y;
     int call_x = (w / work_size[0]) + (w % work_size[0] ? 1 : 0);
-    int call_y = (h / work_size[1]) + (w % work_size[1] ? 1 : 0);
+    int call_y = (h / work_size[1]) + (h % work_size[1] ? 1 : 0);
 
-    uniform("taa", "init", initTaa);
-    initTaa = false;
+    TaaBlock taa{};
+    taa.init = initTaa;
+    initTaa  = false;
 
-    uniform("taa", "res", resolution());
-    uniform("taa", "weights", weights);
+    taa.res         = resolution();
+    taa.frameRes    = renderResolution();
+    taa.jitter      = jitter;
+    taa.renderScale = float(taa.frameRes.x) / float(taa.res.x);
+    for (int i = 0; i < 9; ++i)
+    {
+        taa.weights[i / 4][i % 4] = weights[i];
+    }
 
-    uniform("taa", "doFilter", doFilter);
-    uniform("taa", "doClamp", doClamp);
-    uniform("taa", "doDynamicFeedback", doDynamicFeedback);
-    uniform("taa", "maxFeedback", maxFeedback);
-    uniform("taa", "freeze", freeze);
+    taa.doFilter          = doFilter;
+    taa.doClamp           = doClamp;
+    taa.doDynamicFeedback = doDynamicFeedback;
+    taa.maxFeedback       = maxFeedback;
+    taa.freeze            = currentScene().freeze;
 
     glm::fmat4 reProj = glm::fmat4(1);
     if (useReprojection)
@@ -195,37 +299,253 @@ void Assignment01::taaPass()
         prevViewMatrix = viewMatrix();
     }
 
-    uniform("taa", "reProj", reProj);
+    taa.reProj = reProj;
+    uniformBlock(TAA_BLOCK, taa);
+    taaBlock = taa;
+
+    // frame, history, depth and output are bound by the render graph at the units of
+    // their layout qualifiers
+    {
+        auto scope = profile(TAA_VARIANT_NAMES[kernel][taaFormat]);
+        glDispatchCompute(call_x, call_y, 1);
+    }
+}
+
+
+void Assignment01::captureTaa(RenderGraph::Resource output)
+{
+    taaCapture = false;
+    // the resolve wrote through an image unit, the readback must see it
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+    char name[32];
+    std::snprintf(name, sizeof(name), "taa_%05u.pfm", unsigned(frame().index));
+    Tex const& texture = graph.texture(output);
+    frameCapture().captureTexture(texture.index(), texture.dimensions(), captureDirectory() + "/" + name);
+}
+
+void Assignment01::validateTaa(RenderGraph::Resource color, RenderGraph::Resource depth,
+                               RenderGraph::History const& history)
+{
+    taaValidate = false;
+    if (currentScene().renderScale < 1.0f)
+    {
+        std::cout << "taa cpu reference resolves at render scale 1 only" << std::endl;
+        return;
+    }
+    // the resolve wrote through an image unit, reads below must see it
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    auto read = [this](RenderGraph::Resource resource, TaaImage& image) {
+        Tex const& texture = graph.texture(resource);
+        image.size         = texture.dimensions();
+        image.texels.resize(std::size_t(image.size.x) * image.size.y);
+        texture.bind();
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, image.texels.data());
+    };
+    TaaImage frame{}, previous{}, resolved{}, expected{};
+    read(color, frame);
+    read(history.previous, previous);
+    read(history.current, resolved);
+    std::vector<float> depths(frame.texels.size());
+    graph.texture(depth).bind();
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data());
+
+    if (!taaReference)
+    {
+        taaReference.reset(new TaaReference{});
+    }
+    auto start = std::chrono::steady_clock::now();
+    taaReference->resolve(taaBlock, frame, depths, previous, expected);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // the reference kernel differs along the image edges
+    int kernel    = taaKernel;
+    taaValidation = compareTaaImages(resolved, expected, TAA_FORMAT_TOLERANCE[taaFormat], kernel == TAA_REFERENCE);
+    std::cout << "taa cpu check " << TAA_VARIANT_NAMES[kernel][taaFormat] << ": " << taaValidation.failed << " of "
+              << taaValidation.compared << " pixels off by more than " << TAA_FORMAT_TOLERANCE[taaFormat]
+              << ", max error " << taaValidation.max_error << ", cpu resolve " << ms << " ms" << std::endl;
+}
+
+void Assignment01::collectTaaTimings()
+{
+    FrameProfile const& frame = profiler().latest();
+    if (frame.index == taaTimingFrame)
+    {
+        return;
+    }
+    taaTimingFrame = frame.index;
+    if (upscaleComparePhase >= 0 && upscaleCompareFrame >= UPSCALE_SETTLE_FRAMES)
+    {
+        upscaleTimings[upscaleComparePhase].total += frame.gpu();
+        ++upscaleTimings[upscaleComparePhase].frames;
+    }
+    if (lodComparePhase >= 0 && lodCompareFrame >= LOD_SETTLE_FRAMES)
+    {
+        lodTimings[lodComparePhase].total += frame.gpu();
+        ++lodTimings[lodComparePhase].frames;
+    }
+    for (auto const& marker : frame.markers)
+    {
+        for (int kernel = 0; kernel < TAA_KERNEL_COUNT; ++kernel)
+        {
+            for (int format = 0; format < TAA_FORMAT_COUNT; ++format)
+            {
+                if (marker.name == TAA_VARIANT_NAMES[kernel][format])
+                {
+                    taaTimings[kernel][format].total += marker.gpu();
+                    ++taaTimings[kernel][format].frames;
+                }
+            }
+        }
+    }
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    color_buffer.bind();
-    uniform("taa", "currFrame", 0);
+void Assignment01::advanceTaaComparison()
+{
+    if (taaCompareVariant < 0 || ++taaCompareFrame < TAA_COMPARE_FRAMES)
+    {
+        return;
+    }
+    taaCompareFrame = 0;
+    if (++taaCompareVariant == TAA_KERNEL_COUNT * TAA_FORMAT_COUNT)
+    {
+        taaCompareVariant = -1;
+        std::cout << std::fixed << std::setprecision(3);
+        for (int kernel = 0; kernel < TAA_KERNEL_COUNT; ++kernel)
+        {
+            for (int format = 0; format < TAA_FORMAT_COUNT; ++format)
+            {
+                std::cout << std::left << std::setw(26) << TAA_VARIANT_NAMES[kernel][format] << std::right
+                          << std::setw(8) << taaTimings[kernel][format].mean() << " ms" << std::endl;
+            }
+        }
+        return;
+    }
+    taaKernel = taaCompareVariant / TAA_FORMAT_COUNT;
+    taaFormat = taaCompareVariant % TAA_FORMAT_COUNT;
+}
 
-    glActiveTexture(GL_TEXTURE1);
-    taa_in->bind();
-    uniform("taa", "history", 1);
+void Assignment01::advanceUpscaleComparison()
+{
+    if (upscaleComparePhase < 0 || ++upscaleCompareFrame < UPSCALE_COMPARE_FRAMES)
+    {
+        return;
+    }
+    // the taa history still holds the resolved image of the last frame
+    glm::uvec2 size           = resolution();
+    std::vector<float>& image = upscaleImages[upscaleComparePhase];
+    image.resize(std::size_t(size.x) * size.y * 4);
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    graph.previous("taa").bind();
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, image.data());
+
+    upscaleCompareFrame = 0;
+    if (++upscaleComparePhase == 1)
+    {
+        // the scaled phase must not start from the converged native history
+        renderScale = upscaleCompareScale;
+        initTaa     = true;
+        return;
+    }
+    upscaleComparePhase = -1;
 
-    glBindImageTexture(2, taa_out->index(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    // peak signal to noise ratio of the displayed rgb values
+    double error = 0.0;
+    for (std::size_t i = 0; i < image.size(); ++i)
+    {
+        if (i % 4 != 3)
+        {
+            double d = glm::clamp(double(upscaleImages[0][i]), 0.0, 1.0) - glm::clamp(double(image[i]), 0.0, 1.0);
+            error += d * d;
+        }
+    }
+    error /= double(image.size()) * 3.0 / 4.0;
+    upscalePsnr = error > 0.0 ? 10.0 * std::log10(1.0 / error) : INFINITY;
+
+    glm::uvec2 scaled = renderResolution();
+    std::cout << std::fixed << std::setprecision(3) << "native " << size.x << "x" << size.y << std::setw(8)
+              << upscaleTimings[0].mean() << " ms" << std::endl
+              << "scaled " << scaled.x << "x" << scaled.y << std::setw(8) << upscaleTimings[1].mean() << " ms, psnr "
+              << std::setprecision(2) << upscalePsnr << " dB" << std::endl;
+}
 
-    glDispatchCompute(call_x, call_y, 1);
-    glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+void Assignment01::advanceLodComparison()
+{
+    if (lodComparePhase < 0)
+    {
+        return;
+    }
+    // triangles of this frame's batch
+    if (lodCompareFrame > LOD_SETTLE_FRAMES)
+    {
+        lodTriangles[lodComparePhase] += currentScene().batch.triangleCount();
+    }
+    if (++lodCompareFrame < LOD_COMPARE_FRAMES)
+    {
+        return;
+    }
+    lodCompareFrame = 0;
+    if (++lodComparePhase == 1)
+    {
+        return;
+    }
+    lodComparePhase = -1;
+
+    unsigned const frames = LOD_COMPARE_FRAMES - LOD_SETTLE_FRAMES - 1;
+    std::cout << std::fixed << std::setprecision(3) << "full meshes " << std::setw(9) << lodTriangles[0] / frames
+              << " triangles" << std::setw(8) << lodTimings[0].mean() << " ms" << std::endl
+              << "lod " << std::setprecision(1) << std::setw(4) << lodPixelError << " px " << std::setw(9)
+              << lodTriangles[1] / frames << " triangles" << std::setprecision(3) << std::setw(8)
+              << lodTimings[1].mean() << " ms" << std::endl;
+}
 
-    glUseProgram(0);
+glm::uvec2 Assignment01::renderResolution() const
+{
+    return renderResolution(currentScene().renderScale);
 }
 
+glm::uvec2 Assignment01::renderResolution(float scale) const
+{
+    return glm::max(glm::uvec2(glm::round(glm::fvec2(resolution()) * scale)), glm::uvec2(1));
+}
 
 Assignment01::Assignment01(std::string const& resource_path)
     : Application{resource_path},
-      teaPot{m_resource_path + "/data/teapot.obj"},
-      plane{0.f, 12.f},
-      color_buffer{resolution(), GL_RGBA32F},
-      depth_buffer{resolution(), GL_DEPTH_COMPONENT32},
-      taa_in{new Tex(resolution(), GL_RGBA32F)},
-      taa_out{new Tex(resolution(), GL_RGBA32F)},
-      lightDir{glm::normalize(glm::fvec3(9.f, -15.f, -10.f))}
+      arena{},
+      teaPot{m_resource_path + "/data/teapot.obj", &arena},
+      plane{0.f, 12.f, &arena},
+      sceneInstances{},
+      visibility{},
+      graph{},
+      taaBlock{},
+      taaReference{},
+      taaValidation{},
+      lightDir{glm::normalize(glm::fvec3(9.f, -15.f, -10.f))},
+      jitter{0.0f},
+      quad_tex{},
+      quad_zoom{},
+      quad_res{}
 {
-    initializeObjects();
     initializeShaderPrograms();
+
+    // settings a recorded flythrough is replayed with
+    recordSimulationParameter("rotateCam", rotateCam);
+    recordSimulationParameter("degreesPerSecond", degreesPerSecond);
+    recordSimulationParameter("freeze", freeze);
+    recordParameter("zoom", zoom);
+    recordParameter("useTaa", useTaa);
+    recordParameter("useReprojection", useReprojection);
+    recordParameter("doFilter", doFilter);
+    recordParameter("doClamp", doClamp);
+    recordParameter("doDivide2", doDivide2);
+    recordParameter("doDynamicFeedback", doDynamicFeedback);
+    recordParameter("maxFeedback", maxFeedback);
+    recordParameter("taaKernel", taaKernel);
+    recordParameter("taaFormat", taaFormat);
+    recordSimulationParameter("renderScale", renderScale);
+    recordSimulationParameter("cullMode", cullMode);
+    recordSimulationParameter("crowdSize", crowdSize);
+    recordSimulationParameter("useLod", useLod);
+    recordSimulationParameter("lodPixelError", lodPixelError);
 }
 
 // load shader programs
@@ -236,26 +556,15 @@ void Assignment01::initializeShaderPrograms()
     initializeShader("quad", {{GL_VERTEX_SHADER, m_resource_path + "/shader/quad.vs.glsl"},
                               {GL_FRAGMENT_SHADER, m_resource_path + "/shader/quad.fs.glsl"}});
     initializeShader("taa", {{GL_COMPUTE_SHADER, m_resource_path + "/shader/taa.cs.glsl"}});
-}
+    initializeShader("taaTiled", {{GL_COMPUTE_SHADER, m_resource_path + "/shader/taa_tiled.cs.glsl"}});
 
-void Assignment01::initializeObjects()
-{
-    fbo.bind();
-    fbo.addTextureAsColorbuffer(color_buffer);
-    fbo.addTextureAsDepthbuffer(depth_buffer);
-    fbo.check();
-    fbo.unbind();
-}
+    checkUniformBlock<CameraBlock>("scene", "Camera");
+    checkUniformBlock<TaaBlock>("taa", "TaaParameters");
+    checkUniformBlock<TaaBlock>("taaTiled", "TaaParameters");
 
-void Assignment01::resize()
-{
-    initTaa      = true;
-    fbo          = Fbo{};
-    color_buffer = Tex{resolution(), GL_RGBA32F};
-    depth_buffer = Tex{resolution(), GL_DEPTH_COMPONENT32};
-    taa_in.reset(new Tex{resolution(), GL_RGBA32F});
-    taa_out.reset(new Tex{resolution(), GL_RGBA32F});
-    initializeObjects();
+    quad_tex  = uniformHandle<int>("quad", "tex");
+    quad_zoom = uniformHandle<int>("quad", "zoom");
+    quad_res  = uniformHandle<glm::uvec2>("quad", "res");
 }
 
 void Assignment01::imgui()
@@ -270,6 +579,31 @@ void Assignment01::imgui()
             ImGui::Direction("lightDir", lightDir);
         }
 
+        ImGui::Text("%zu instances in one draw", currentScene().batch.instanceCount());
+        ImGui::Combo("culling", &cullMode, "off\0frustum\0frustum bvh\0");
+        ImGui::SliderInt("crowd", &crowdSize, 0, 4096, "%d", ImGuiSliderFlags_Logarithmic);
+        ImGui::Text("%zu visible, %zu culled", visibility.visibleCount(), visibility.culledCount());
+        ImGui::Checkbox("lod", &useLod);
+        if (useLod)
+        {
+            ImGui::SliderFloat("pixel error", &lodPixelError, 0.25f, 16.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+        }
+        ImGui::Text("%zu triangles", currentScene().batch.triangleCount());
+        if (ImGui::Button(lodComparePhase < 0 ? "compare with full meshes" : "comparing..."))
+        {
+            lodTimings[0]   = TaaTiming{};
+            lodTimings[1]   = TaaTiming{};
+            lodTriangles[0] = 0;
+            lodTriangles[1] = 0;
+            lodComparePhase = 0;
+            lodCompareFrame = 0;
+        }
+        if (cullMode == Visibility::BVH)
+        {
+            ImGui::Text("%zu nodes, %zu instances tested", visibility.nodeTests(), visibility.instanceTests());
+        }
+        ImGui::Text("%zu targets, %zu allocated", graph.pool().size(), graph.pool().allocations());
+        ImGui::Text("%zu framebuffers, %u barriers", graph.framebuffers(), graph.barriers());
         ImGui::Checkbox("rotateCam", &rotateCam);
         if (rotateCam)
         {
@@ -289,6 +623,71 @@ void Assignment01::imgui()
             ImGui::Checkbox("doDynamicFeedback", &doDynamicFeedback);
             ImGui::SliderFloat("maxFeedback", &maxFeedback, 0, 1);
             ImGui::SliderInt("samples", (int*)&samples, 1, 64);
+            if (ImGui::CollapsingHeader("render scale"))
+            {
+                // reduced scales always resolve with the tiled kernel
+                ImGui::SliderFloat("renderScale", &renderScale, 0.5f, 1.0f, "%.2f");
+                glm::uvec2 size = renderResolution(renderScale);
+                ImGui::Text("rendering %ux%u", size.x, size.y);
+                ImGui::SliderFloat("compared scale", &upscaleCompareScale, 0.5f, 1.0f, "%.2f");
+                if (ImGui::Button(upscaleComparePhase < 0 ? "compare with native" : "comparing..."))
+                {
+                    upscaleTimings[0]   = TaaTiming{};
+                    upscaleTimings[1]   = TaaTiming{};
+                    upscaleComparePhase = 0;
+                    upscaleCompareFrame = 0;
+                    renderScale         = 1.0f;
+                    useTaa              = true;
+                }
+                ImGui::Text("native %6.3f ms", upscaleTimings[0].mean());
+                ImGui::Text("scaled %6.3f ms", upscaleTimings[1].mean());
+                ImGui::Text("psnr   %6.2f dB", upscalePsnr);
+            }
+            if (ImGui::CollapsingHeader("taa variant"))
+            {
+                // the render graph reallocates targets whose format changed
+                ImGui::Combo("kernel", &taaKernel, TAA_KERNEL_NAMES, TAA_KERNEL_COUNT);
+                ImGui::Combo("format", &taaFormat, TAA_FORMAT_NAMES, TAA_FORMAT_COUNT);
+                if (ImGui::Button(taaCompareVariant < 0 ? "compare all" : "comparing..."))
+                {
+                    for (auto& kernel : taaTimings)
+                    {
+                        for (auto& timing : kernel)
+                        {
+                            timing = TaaTiming{};
+                        }
+                    }
+                    taaCompareVariant = 0;
+                    taaCompareFrame   = 0;
+                    taaKernel         = 0;
+                    taaFormat         = 0;
+                }
+                // gpu time and texture bytes read and written per pixel
+                for (int kernel = 0; kernel < TAA_KERNEL_COUNT; ++kernel)
+                {
+                    for (int format = 0; format < TAA_FORMAT_COUNT; ++format)
+                    {
+                        float bytes = (TAA_COLOR_FETCHES[kernel] + 2.0f) * float(TAA_FORMAT_BYTES[format]) + 4.0f;
+                        ImGui::Text("%-9s %-10s %6.3f ms %5.1f B", TAA_KERNEL_NAMES[kernel], TAA_FORMAT_NAMES[format],
+                                    taaTimings[kernel][format].mean(), bytes);
+                    }
+                }
+                // resolves the next frame's inputs on the cpu and compares
+                if (ImGui::Button("check on cpu"))
+                {
+                    taaValidate = true;
+                }
+                ImGui::Text("%zu of %zu off, max %.2e", taaValidation.failed, taaValidation.compared,
+                            taaValidation.max_error);
+                // read back without stalling, written by a worker a few frames later
+                if (ImGui::Button("capture output"))
+                {
+                    taaCapture = true;
+                }
+                ImGui::SameLine();
+                ImGui::Checkbox("every frame", &taaCaptureContinuous);
+                ImGui::Text("%zu captured, %zu dropped", frameCapture().captured(), frameCapture().dropped());
+            }
         }
     }
     ImGui::End();
@@ -296,6 +695,19 @@ void Assignment01::imgui()
 // exe entry point
 int main(int argc, char* argv[])
 {
+    // cpu resolve throughput, runs without a gpu or display
+    const std::string benchmark_option = "--taa-cpu-benchmark";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg.compare(0, benchmark_option.size(), benchmark_option) == 0)
+        {
+            return benchmarkTaaReference(arg.size() > benchmark_option.size() ? arg.substr(benchmark_option.size() + 1)
+                                                                              : "1920x1080",
+                                         std::cout);
+        }
+    }
+    Application::setLaunchOptions(read_launch_options(argc, argv));
     std::string resource_path = read_resource_path(argc, argv);
     Assignment01 application{resource_path};
     application.run(30);  // max fps
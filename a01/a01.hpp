@@ -1,12 +1,59 @@
 #pragma once
 
 #include "application.hpp"
+#include "culling.hpp"
 #include "helper.hpp"
 #include "models.hpp"
+#include "render_graph.hpp"
+#include "taa_reference.hpp"
 
 #include <array>
-#include <glm/glm.hpp>
+#include <cstdint>
 #include <memory>
+#include <glm/glm.hpp>
+#include <vector>
+
+// uniform buffer binding points, match the layout qualifiers in the shaders
+enum BlockBinding : GLuint
+{
+    TAA_BLOCK    = 0,
+    CAMERA_BLOCK = 1,
+};
+
+// std140 blocks, bools are 4 byte uints and vec3 are padded to vec4
+struct CameraBlock
+{
+    glm::fmat4 viewMatrix;
+    glm::fmat4 projMatrix;
+    glm::fvec4 lightDir;
+};
+
+// resolve kernels, taa.cs.glsl fetches each 3x3 neighborhood from the frame,
+// taa_tiled.cs.glsl stages tiles in shared memory
+enum TaaKernel
+{
+    TAA_REFERENCE,
+    TAA_TILED,
+    TAA_KERNEL_COUNT,
+};
+
+// precision of the scene color and taa history, depth always comes from the depth attachment
+enum TaaFormat
+{
+    TAA_RGBA32F,
+    TAA_RGBA16F,
+    TAA_R11G11B10F,
+    TAA_FORMAT_COUNT,
+};
+
+// mean gpu time of one taa variant, render scale or lod setting
+struct TaaTiming
+{
+    double total    = 0.0;
+    unsigned frames = 0;
+
+    double mean() const { return frames ? total / frames : 0.0; }
+};
 
 class Assignment01 : public Application
 {
@@ -22,38 +69,119 @@ class Assignment01 : public Application
     void update(float dt) override;
 
    protected:
+    // scene of one frame, built on the simulation thread and only read by the render passes
+    struct SceneFrame : SceneSnapshot
+    {
+        SceneFrame() : batch{} {}
+
+        DrawBatch batch;
+        // parameters of the simulated frame the render passes depend on
+        float renderScale = 1.0f;
+        bool freeze       = false;
+    };
+
     // common methods
     void initializeShaderPrograms();
-    void initializeObjects();
-    void resize() override;
 
     // special methods
-    void renderScene() const;
+    // fill sceneInstances and their bounds, called when the crowd size changes
+    void buildInstances();
+    // cull and batch the instances for the view of the simulated frame
+    std::shared_ptr<SceneSnapshot> buildScene(FrameSnapshot const& frame) override;
+    SceneFrame& currentScene() const;
+    void renderScene();
     void taaPass();
+    // gpu time of the taa variant in the latest resolved frame
+    void collectTaaTimings();
+    // run every variant for a number of frames and print their timings
+    void advanceTaaComparison();
+    // run native and reduced resolution for a number of frames, print frame times and image difference
+    void advanceUpscaleComparison();
+    // run full meshes and selected levels of detail for a number of frames, print triangles and frame times
+    void advanceLodComparison();
+    // resolution the scene is rendered at before taa reconstructs the output resolution
+    glm::uvec2 renderResolution() const;
+    glm::uvec2 renderResolution(float scale) const;
     void jitterAndWeight();
+    // queue the taa output for a float image of the current frame in the capture directory
+    void captureTaa(RenderGraph::Resource output);
+    // resolve the frame's taa inputs on the cpu and compare with the gpu result, called in the taa pass
+    void validateTaa(RenderGraph::Resource color, RenderGraph::Resource depth, RenderGraph::History const& history);
     void camRotation();
 
-    // render objects
+    // model and instance data of one object in the scene, the scene is static
+    struct SceneInstance
+    {
+        simpleModel const* model;
+        InstanceData data;
+    };
+
+    // render objects, scene geometry shares one arena
+    MeshArena arena;
     simpleQuad quad;
     simpleModel teaPot;
     groundPlane plane;
 
-    // frame buffer object
-    Fbo fbo;
+    // instances are culled against the camera before they are batched
+    std::vector<SceneInstance> sceneInstances;
+    Visibility visibility;
+    int cullMode  = Visibility::LINEAR;
+    int crowdSize = 0;
+    // crowd size sceneInstances were built for, -1 before the first frame
+    int builtCrowdSize = -1;
+    // levels of detail are picked per instance by the projected size of their error
+    bool useLod         = true;
+    float lodPixelError = 1.0f;
+    // full meshes and selected levels during a lod comparison
+    TaaTiming lodTimings[2];
+    std::size_t lodTriangles[2] = {0, 0};
+    // 0 full meshes, 1 selected levels, -1 otherwise
+    int lodComparePhase      = -1;
+    unsigned lodCompareFrame = 0;
 
-    // textures
-    Tex color_buffer;
-    Tex depth_buffer;
-    std::unique_ptr<Tex> taa_in;
-    std::unique_ptr<Tex> taa_out;
+    // passes of each frame, owns the render targets and the taa history
+    RenderGraph graph;
+
+    // taa variant
+    int taaKernel = TAA_TILED;
+    int taaFormat = TAA_RGBA16F;
+    TaaTiming taaTimings[TAA_KERNEL_COUNT][TAA_FORMAT_COUNT];
+    std::uint64_t taaTimingFrame = 0;
+    // variant index during a comparison, -1 otherwise
+    int taaCompareVariant   = -1;
+    unsigned taaCompareFrame = 0;
+    // fraction of the output resolution the scene is rendered at, the tiled kernel upsamples
+    float renderScale = 1.0f;
+    // native and scaled frame time and resolved image during an upscale comparison
+    TaaTiming upscaleTimings[2];
+    std::vector<float> upscaleImages[2];
+    float upscaleCompareScale = 0.5f;
+    double upscalePsnr        = 0.0;
+    // 0 native, 1 scaled, -1 otherwise
+    int upscaleComparePhase    = -1;
+    unsigned upscaleCompareFrame = 0;
+    // parameters of the last taa dispatch, a cpu check of the next frame is requested by the button
+    TaaBlock taaBlock;
+    bool taaValidate = false;
+    std::unique_ptr<TaaReference> taaReference;
+    TaaDifference taaValidation;
+    // taa output written as float images by the frame capture, once or every frame
+    bool taaCapture           = false;
+    bool taaCaptureContinuous = false;
 
     glm::fvec3 lightDir;
     glm::fmat4 jittProjMatrix;
+    // sample position of the current frame relative to its pixel centers, in its pixels
+    glm::fvec2 jitter;
     glm::fmat4 prevViewMatrix;
 
     Timer timer;
     float degreesPerSecond = 20;
 
+    Uniform<int> quad_tex;
+    Uniform<int> quad_zoom;
+    Uniform<glm::uvec2> quad_res;
+
     std::array<float, 9> weights;
     float maxFeedback = 0.99f;
     unsigned samples  = 64;
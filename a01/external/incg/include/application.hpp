@@ -2,9 +2,24 @@
 #define APPLICATION_HPP
 
 #include <glbinding/gl/types.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <map>
-
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "file_watcher.hpp"
+#include "frame_capture.hpp"
+#include "frame_pipeline.hpp"
+#include "frame_recording.hpp"
+#include "gl_state.hpp"
+#include "profiler.hpp"
 #include "shader_loader.hpp"
+#include "texture_streamer.hpp"
+#include "uniform_buffer.hpp"
+#include "uniform_cache.hpp"
 #include <glm/gtc/type_precision.hpp>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
@@ -22,6 +37,38 @@ struct GLFWwindow;
 struct CTwBar;
 typedef struct CTwBar TwBar;
 
+// options given on the command line, applied when the application is constructed
+struct LaunchOptions
+{
+    // render offscreen into a framebuffer object, no window or display required
+    bool headless = false;
+    // render a fixed number of frames and exit, 0 runs until the window is closed
+    unsigned frames = 0;
+    // frames rendered before timings are recorded
+    unsigned warmup = 10;
+    glm::uvec2 resolution{WIDTH, HEIGHT};
+    // file for per-frame timings, .json or .csv
+    std::string report{};
+    // file for the profiler history in chrome://tracing format, written on exit
+    std::string trace{};
+    // directory of cached program binaries, empty uses .shader_cache in the resource path, off disables
+    std::string shader_cache{};
+    // snapshots the simulation runs ahead of rendering and frames the cpu runs ahead of the gpu,
+    // fewer lower input latency, more hide stalls
+    unsigned frames_in_flight = 3;
+    // file the camera and recorded parameters of every frame are written to on exit
+    std::string record{};
+    // recording to play back with a fixed time step instead of taking input, implies --frames
+    // with its length, warmup frames hold its first frame
+    std::string replay{};
+    // directory each measured frame is written to as frame_NNNNN.png, without the interface
+    std::string capture{};
+    // directory of frames written by --capture to compare each measured frame against
+    std::string golden{};
+    // largest channel difference of a pixel still matching its golden image
+    float golden_tolerance = 2.0f / 255.0f;
+};
+
 class Application
 {
    public:
@@ -40,11 +87,16 @@ class Application
 
     virtual void imgui() = 0;
 
+    // advance the simulation by the real time since the last call, runs on the simulation thread
+    // alongside render(), holding simulationLock() like buildScene()
     virtual void update(float dt) = 0;
 
 
     void run(int max_fps = 60);
 
+    // must be called before construction to take effect
+    static void setLaunchOptions(LaunchOptions const& options);
+
     void imGui_plotFPS();
 
     void updateCamera();
@@ -61,6 +113,7 @@ class Application
     // handle resizing
     void resizeCallback(int width, int height);
 
+    // rebuild every program in the background, each keeps running until its replacement links
     void updateShaderPrograms();
 
    protected:
@@ -69,10 +122,24 @@ class Application
 
     uint32_t shader(std::string const& name) const;
     void initializeShader(std::string const& name, std::map<GLenum, std::string> const& files, bool binary = false);
+    // interface of the current program, updated on reload
+    shader_loader::Reflection const& shaderInfo(std::string const& name) const;
 
-    // get uniform location, throwing exception if name describes no active uniform variable
+    // get cached uniform location, -1 if name describes no active uniform variable
     GLint glGetUniformLocation(GLuint, const GLchar*) const;
 
+    // typed uniform handle which stays valid when the program is reloaded
+    template <typename T>
+    Uniform<T> uniformHandle(std::string const& program, std::string const& name);
+    // assign binding point to a block declared without binding qualifier, kept on reload
+    void bindUniformBlock(std::string const& program, std::string const& block, GLuint binding);
+    // upload std140 block through the per-frame ring buffer and bind it
+    template <typename T>
+    void uniformBlock(GLuint binding, T const& block) const;
+    // warn if host struct T is smaller than the block declared in the program
+    template <typename T>
+    void checkUniformBlock(std::string const& program, std::string const& block) const;
+
     // upload uniform by name wrapper function
     template <typename T>
     void uniform(std::string const& program, const std::string& name, T const& value) const;
@@ -80,6 +147,32 @@ class Application
     template <typename T>
     void uniform(uint32_t program, const std::string& name, T const& value) const;
 
+    // cpu and gpu timing of the enclosing scope, shown in the profiler view
+    ProfileScope profile(char const* name) const;
+    Profiler& profiler() const;
+    // background texture loading, advanced once per frame before render()
+    TextureStreamer& textureStreamer() const;
+    // asynchronous readback of frames and textures, advanced once per frame after render()
+    FrameCapture& frameCapture() const;
+    // directory of --capture, the resource path without it
+    std::string captureDirectory() const;
+    // save the value with each frame of a recording and restore it on replay, call in the constructor
+    // render parameters are replayed when their frame is taken for rendering, simulation parameters
+    // when update() and buildScene() step it
+    template <typename T>
+    void recordParameter(std::string const& name, T& value);
+    template <typename T>
+    void recordSimulationParameter(std::string const& name, T& value);
+
+    // scene state of a frame, built on the simulation thread after update() and handed to render()
+    // through frame().scene, read only what the snapshot or simulationLock() guards
+    virtual std::shared_ptr<SceneSnapshot> buildScene(FrameSnapshot const& frame);
+    // guards state shared by the simulation and the render thread, the step holds it while it runs,
+    // the render thread while it polls input, runs imgui() and applies recorded parameters
+    std::unique_lock<std::mutex> simulationLock() const;
+
+    // frame being rendered, as taken from the simulation thread
+    FrameSnapshot const& frame() const;
     glm::fmat4 const& viewMatrix() const;
     glm::fmat4 const& projectionMatrix() const;
     glm::uvec2 const& resolution() const;
@@ -90,9 +183,38 @@ class Application
     float last_frame_time = 0;
 
    private:
-    // shader storage
-    std::map<std::string, uint32_t> m_shader_handles{};
+    // forward glfw input events to this instance
+    void setupCallbacks();
+    // advance imgui frame and draw the interface on top of the rendered frame
+    void renderImgui(float delta_time);
+    // reflect current program and refresh cached uniform locations
+    void updateUniforms(std::string const& name) const;
+    // start building a program and watch the files it depends on
+    void beginShader(std::string const& name);
+    // wait for a program of the initial batch, reloads never wait
+    void finishShader(std::string const& name) const;
+    // rebuild programs depending on changed files, swap in reloads that have linked
+    void pollShaderPrograms();
+    // update() and the snapshot of its result, called on the simulation thread
+    FrameSnapshot simulate(FrameSnapshot const& previous, float dt);
+    // frame of the recording replayed for the frame index, warmup frames hold its first frame
+    std::size_t recordedFrame(std::uint64_t index) const;
+    // append gpu frame time to the plotted history
+    void updateFrameTimes(float frame_time);
+    // write or compare the rendered frame for --capture and --golden
+    void captureFrame(unsigned index);
+
+    // shader storage, handles are 0 until the initial build is finished on first use
+    mutable std::map<std::string, uint32_t> m_shader_handles{};
     std::map<std::string, std::map<GLenum, std::string>> m_shader_files{};
+    std::map<std::string, std::unique_ptr<ProgramUniforms>> m_shader_uniforms{};
+    mutable std::unordered_map<GLuint, ProgramUniforms*> m_uniforms_by_handle{};
+    // programs the driver is still compiling
+    mutable std::map<std::string, shader_loader::PendingProgram> m_pending_shaders{};
+    // files each program was expanded from, a change rebuilds only the programs using it
+    std::map<std::string, std::vector<std::string>> m_shader_dependencies{};
+    std::unique_ptr<FileWatcher> m_file_watcher;
+    std::map<std::string, std::map<std::string, GLuint>> m_block_bindings{};
     // mouse buttons
     bool m_pressed_right;
     bool m_pressed_middle;
@@ -103,7 +225,32 @@ class Application
     glm::fmat4 m_viewMatrix;
     glm::fmat4 m_projMatrix;
     glm::uvec2 m_resolution;
+    // null when running headless
     GLFWwindow* window;
+    static LaunchOptions s_launch_options;
+    std::unique_ptr<Profiler> m_profiler;
+    std::unique_ptr<UniformRing> m_uniform_ring;
+    std::unique_ptr<TextureStreamer> m_texture_streamer;
+    std::unique_ptr<FrameCapture> m_frame_capture;
+    // results of --golden, updated by the capture workers
+    struct GoldenResults
+    {
+        std::mutex mutex;
+        unsigned compared = 0;
+        unsigned failed   = 0;
+        float max_difference = 0.0f;
+    } m_golden;
+    // set by --record or --replay
+    std::unique_ptr<FrameRecording> m_recording;
+    // simulation state of the frame being rendered
+    FrameSnapshot m_frame;
+    mutable std::mutex m_simulation_mutex;
+    // state changes of the last frame passed on to and filtered by gl_state
+    gl_state::Counters m_state_calls;
+    // result of the last trace export from the interface
+    std::string m_trace_status{};
+    // construction start, startup time is reported when the first frame begins
+    std::chrono::steady_clock::time_point m_start_time;
 
     int last_frame_times_i = 0;
     int last_frame_times_N = 120;
@@ -117,7 +264,7 @@ class Application
 template <typename T>
 void Application::uniform(std::string const& program, const std::string& name, T const& value) const
 {
-    int handle = m_shader_handles.at(program);
+    int handle = shader(program);
     uniform(handle, name, value);
 }
 
@@ -128,17 +275,64 @@ void Application::uniform(uint32_t program, const std::string& name, T const& va
     glUniform(loc, value);
 }
 
+template <typename T>
+Uniform<T> Application::uniformHandle(std::string const& program, std::string const& name)
+{
+    return Uniform<T>{*m_shader_uniforms.at(program), name};
+}
+
+template <typename T>
+void Application::recordParameter(std::string const& name, T& value)
+{
+    if (m_recording)
+    {
+        m_recording->bind(name, value, FrameRecording::RENDER);
+    }
+}
+
+template <typename T>
+void Application::recordSimulationParameter(std::string const& name, T& value)
+{
+    if (m_recording)
+    {
+        m_recording->bind(name, value, FrameRecording::SIMULATION);
+    }
+}
+
+template <typename T>
+void Application::uniformBlock(GLuint binding, T const& block) const
+{
+    m_uniform_ring->bind(binding, block);
+}
+
+template <typename T>
+void Application::checkUniformBlock(std::string const& program, std::string const& block) const
+{
+    auto const& blocks = shaderInfo(program).blocks;
+    auto info          = blocks.find(block);
+    if (info != blocks.end() && std::size_t(info->second.data_size) > sizeof(T))
+    {
+        std::cerr << "Uniform block size mismatch: " << program << "::" << block << " is " << info->second.data_size
+                  << " bytes, host struct " << sizeof(T) << std::endl;
+    }
+}
+
 #include "window_handler.hpp"
 
 // dont load gl bindings from glfw
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+inline bool is_launch_option(char const* arg)
+{
+    return arg[0] == '-' && arg[1] == '-';
+}
+
 inline std::string read_resource_path(int argc, char* argv[])
 {
     std::string resource_path{};
     // first argument is resource path
-    if (argc > 1)
+    if (argc > 1 && !is_launch_option(argv[1]))
     {
         resource_path = argv[1];
     }
@@ -153,5 +347,95 @@ inline std::string read_resource_path(int argc, char* argv[])
     return resource_path;
 }
 
+// parse options of the form --headless --frames=N --warmup=N --size=WxH --report=file --trace=file
+// --shader-cache=directory|off --frames-in-flight=N --record=file --replay=file --capture=directory
+// --golden=directory --golden-tolerance=X
+inline LaunchOptions read_launch_options(int argc, char* argv[])
+{
+    LaunchOptions options{};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (!is_launch_option(argv[i]))
+        {
+            continue;
+        }
+        std::string::size_type split = arg.find('=');
+        std::string name             = arg.substr(2, split == std::string::npos ? std::string::npos : split - 2);
+        std::string value            = split == std::string::npos ? std::string{} : arg.substr(split + 1);
+
+        if (name == "headless")
+        {
+            options.headless = true;
+        }
+        else if (name == "frames")
+        {
+            options.frames = unsigned(std::stoul(value));
+        }
+        else if (name == "warmup")
+        {
+            options.warmup = unsigned(std::stoul(value));
+        }
+        else if (name == "size")
+        {
+            std::string::size_type x = value.find('x');
+            if (x == std::string::npos)
+            {
+                throw std::invalid_argument("--size expects WIDTHxHEIGHT, got " + value);
+            }
+            options.resolution = glm::uvec2{std::stoul(value.substr(0, x)), std::stoul(value.substr(x + 1))};
+        }
+        else if (name == "report")
+        {
+            options.report = value;
+        }
+        else if (name == "trace")
+        {
+            options.trace = value;
+        }
+        else if (name == "shader-cache")
+        {
+            options.shader_cache = value;
+        }
+        else if (name == "frames-in-flight")
+        {
+            options.frames_in_flight = std::max(1u, unsigned(std::stoul(value)));
+        }
+        else if (name == "record")
+        {
+            options.record = value;
+        }
+        else if (name == "replay")
+        {
+            options.replay = value;
+        }
+        else if (name == "capture")
+        {
+            options.capture = value;
+        }
+        else if (name == "golden")
+        {
+            options.golden = value;
+        }
+        else if (name == "golden-tolerance")
+        {
+            options.golden_tolerance = std::stof(value);
+        }
+        else
+        {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    if (options.headless && options.frames == 0 && options.replay.empty())
+    {
+        throw std::invalid_argument("--headless requires --frames=N or --replay=file");
+    }
+    if (!options.record.empty() && !options.replay.empty())
+    {
+        throw std::invalid_argument("--record and --replay exclude each other");
+    }
+    return options;
+}
+
 
 #endif
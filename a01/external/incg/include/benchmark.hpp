@@ -0,0 +1,47 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/type_precision.hpp>
+
+// summary statistics of a series of frame times in milliseconds
+struct TimingSummary
+{
+    float min  = 0;
+    float mean = 0;
+    float p50  = 0;
+    float p99  = 0;
+
+    static TimingSummary of(std::vector<float> values);
+};
+
+// per-frame cpu and gpu timings recorded in benchmark mode
+class FrameTimings
+{
+   public:
+    FrameTimings() = default;
+
+    // gpu results arrive frames later, so both are recorded by frame number
+    void recordCpu(std::size_t frame, float ms);
+    void recordGpu(std::size_t frame, float ms);
+    std::size_t size() const;
+
+    TimingSummary cpu() const;
+    TimingSummary gpu() const;
+
+    // write samples and summary, format is chosen by extension (.json, otherwise csv)
+    void write(std::string const& path, glm::uvec2 const& resolution) const;
+    void print(std::ostream& stream) const;
+
+   private:
+    void writeCsv(std::ostream& stream) const;
+    void writeJson(std::ostream& stream, glm::uvec2 const& resolution) const;
+
+    std::vector<float> m_cpu{};
+    std::vector<float> m_gpu{};
+};
+
+#endif
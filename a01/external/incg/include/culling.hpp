@@ -0,0 +1,102 @@
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// axis aligned box and a sphere around it, the sphere is the cheaper test, the box the tighter
+struct Bounds
+{
+    glm::fvec3 min{0.0f};
+    glm::fvec3 max{0.0f};
+    glm::fvec3 center{0.0f};
+    float radius = 0.0f;
+};
+// bounds of positions spaced stride bytes apart, the sphere is centered on the box
+Bounds compute_bounds(void const* positions, std::size_t count, std::size_t stride = sizeof(glm::fvec3));
+Bounds compute_bounds(std::vector<glm::fvec3> const& positions);
+// bounds of the transformed box, the sphere grows with the largest axis scale
+Bounds transform_bounds(Bounds const& bounds, glm::fmat4 const& matrix);
+
+// planes of a view frustum as ax + by + cz + d >= 0 inside, normalized
+struct Frustum
+{
+    glm::fvec4 planes[6];
+};
+// from projection * view, or projection * view * model for model space tests
+Frustum extract_frustum(glm::fmat4 const& view_projection);
+// conservative, boxes outside near a frustum corner may still pass
+bool intersects(Frustum const& frustum, Bounds const& bounds);
+
+// world bounds of the instances of a frame, culled together against the camera
+// spheres are tested four at a time with sse and the survivors against their boxes, with the
+// bvh nodes are tested first and whole subtrees inside the frustum skip the instance tests
+class Visibility
+{
+   public:
+    enum Mode
+    {
+        // every instance is visible
+        OFF,
+        // every instance is tested
+        LINEAR,
+        // a bvh over the instances is built on the next cull after instances were added
+        BVH,
+    };
+
+    explicit Visibility(Mode mode = LINEAR);
+
+    void clear();
+    // index of the instance, in the order added
+    std::uint32_t add(Bounds const& world);
+    void cull(Frustum const& frustum);
+
+    bool visible(std::uint32_t instance) const { return m_visible[instance] != 0; }
+    Bounds const& bounds(std::uint32_t instance) const { return m_bounds[instance]; }
+    std::vector<std::uint32_t> const& visibleInstances() const { return m_visible_list; }
+
+    void setMode(Mode mode);
+    Mode mode() const { return m_mode; }
+
+    std::size_t size() const { return m_bounds.size(); }
+    std::size_t visibleCount() const { return m_visible_list.size(); }
+    std::size_t culledCount() const { return m_bounds.size() - m_visible_list.size(); }
+    // bvh nodes and instances tested by the last cull
+    std::size_t nodeTests() const { return m_node_tests; }
+    std::size_t instanceTests() const { return m_instance_tests; }
+
+   private:
+    struct Node
+    {
+        glm::fvec3 min;
+        glm::fvec3 max;
+        // children for inner nodes, a range of m_order for leaves
+        std::uint32_t first;
+        std::uint32_t count;
+        bool leaf;
+    };
+
+    // test count instances listed in order, or the first count instances without order
+    void cullRange(Frustum const& frustum, std::uint32_t const* order, std::size_t count);
+    void cullNode(Frustum const& frustum, std::uint32_t node, unsigned planes);
+    void markVisible(std::uint32_t instance);
+    // fill node index with instances first to first + count of m_order
+    void build(std::uint32_t index, std::uint32_t first, std::uint32_t count);
+
+    Mode m_mode;
+    std::vector<Bounds> m_bounds;
+    // sphere center x, y, z and radius as separate streams for the sse test
+    std::vector<float> m_spheres[4];
+    std::vector<std::uint8_t> m_visible;
+    std::vector<std::uint32_t> m_visible_list;
+    std::vector<Node> m_nodes;
+    std::vector<std::uint32_t> m_order;
+    bool m_bvh_dirty;
+    std::size_t m_node_tests;
+    std::size_t m_instance_tests;
+};
+
+#endif
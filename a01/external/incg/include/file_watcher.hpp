@@ -0,0 +1,44 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// collects files changed on disk from a background thread, with inotify on linux and by
+// polling write times elsewhere, so the render loop never touches the file system for it
+class FileWatcher
+{
+   public:
+    FileWatcher();
+    FileWatcher(FileWatcher const&) = delete;
+    FileWatcher& operator=(FileWatcher const&) = delete;
+    ~FileWatcher();
+
+    // paths are reported exactly as given here
+    void watch(std::string const& path);
+    // files changed since the last call, each reported once
+    std::vector<std::string> takeChanged();
+
+   private:
+    void run();
+
+    std::mutex m_mutex;
+    std::set<std::string> m_changed;
+#ifdef __linux__
+    int m_inotify;
+    // watched paths by directory watch and file name, editors often replace files by renaming
+    // so the directory is watched rather than the file
+    std::map<int, std::map<std::string, std::set<std::string>>> m_watches;
+#else
+    std::map<std::string, long> m_write_times;
+#endif
+    std::atomic<bool> m_stop;
+    std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <cstddef>
+// use gl definitions from glbinding
+using namespace gl;
+
+// shadow of the bindings and enables of the context, calls that would not change anything are
+// not passed on to the driver
+// state changed past these functions (imgui restores what it changes) must be followed by
+// invalidate(), names must be forgotten before they are deleted because gl may hand them out again
+namespace gl_state
+{
+struct Counters
+{
+    // calls passed on to the driver
+    std::size_t issued = 0;
+    // calls dropped because the state was already set
+    std::size_t filtered = 0;
+};
+
+void use_program(GLuint program);
+void bind_vertex_array(GLuint vertex_array);
+// GL_FRAMEBUFFER sets the draw and the read binding
+void bind_framebuffer(GLenum target, GLuint framebuffer);
+
+// select the unit later bind_texture(target, texture) calls bind to
+void active_texture(GLuint unit);
+// bind to the active unit, as glBindTexture
+void bind_texture(GLenum target, GLuint texture);
+// bind to a unit, switches the active unit only if the binding changes
+void bind_texture(GLuint unit, GLenum target, GLuint texture);
+void bind_sampler(GLuint unit, GLuint sampler);
+void bind_image_texture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access,
+                        GLenum format);
+
+// glEnable or glDisable
+void set_enabled(GLenum capability, bool enabled);
+// comparison of the depth test, as glDepthFunc
+void depth_func(GLenum func);
+
+void forget_program(GLuint program);
+void forget_vertex_array(GLuint vertex_array);
+void forget_framebuffer(GLuint framebuffer);
+void forget_texture(GLuint texture);
+// assume nothing about the current state, the next call of each kind is issued
+void invalidate();
+
+Counters const& counters();
+void reset_counters();
+}  // namespace gl_state
+
+#endif
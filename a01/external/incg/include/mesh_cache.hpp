@@ -0,0 +1,110 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/type_precision.hpp>
+
+#include "mapped_file.hpp"
+#include "mesh_simplify.hpp"
+#include "obj_loader.hpp"
+
+// binary mesh format written on the first load of an obj file
+// welded, cache ordered and interleaved so it can be uploaded without parsing
+namespace mesh_cache
+{
+// storage of the normal following the float position in each vertex
+enum NormalEncoding : std::uint32_t
+{
+    // 3 x float32, 24 byte vertices
+    NORMAL_FLOAT = 0,
+    // 4 x float16 with padding, 20 byte vertices
+    NORMAL_HALF = 1,
+    // 2 x snorm16 octahedral mapping, 16 byte vertices, needs decoding
+    NORMAL_OCTAHEDRAL = 2,
+};
+
+static const std::uint32_t VERSION = 2;
+
+// little endian file header followed by the lod table, vertex and index data follow contiguously
+struct Header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t normal_encoding;
+    std::uint32_t vertex_stride;
+    std::uint32_t vertex_count;
+    // indices of all levels of detail
+    std::uint32_t index_count;
+    // 2 if all indices fit into 16 bit, otherwise 4
+    std::uint32_t index_size;
+    // entries of the mesh_simplify::Lod table after the header, at least the full mesh
+    std::uint32_t lod_count;
+    // size and modification time of the obj the cache was built from
+    std::uint64_t source_size;
+    std::int64_t source_time;
+    // byte offsets from the start of the file
+    std::uint64_t vertex_offset;
+    std::uint64_t index_offset;
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+// validated view of a cache, either memory mapped or held in memory
+class File
+{
+   public:
+    // map existing cache, throws std::runtime_error if it is truncated or of another version
+    explicit File(std::string const& path);
+    // take ownership of an image produced by build
+    explicit File(std::vector<char> image);
+    File(File&&) = default;
+    File& operator=(File&&) = default;
+
+    Header const& header() const { return *reinterpret_cast<Header const*>(m_data); }
+    char const* vertices() const { return m_data + header().vertex_offset; }
+    char const* indices() const { return m_data + header().index_offset; }
+    // vertex and index data in one range, offsets relative to payload()
+    char const* payload() const { return vertices(); }
+    std::size_t payloadSize() const { return m_size - std::size_t(header().vertex_offset); }
+    std::size_t indexOffset() const { return std::size_t(header().index_offset - header().vertex_offset); }
+    // level 0 is the full mesh, ranges are relative to indices()
+    std::vector<mesh_simplify::Lod> lods() const;
+
+    // decode into separate float streams and the 32 bit indices of all levels
+    void unpack(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals,
+                std::vector<std::uint32_t>& indices) const;
+    // throws std::runtime_error if the file cannot be written
+    void write(std::string const& path) const;
+
+   private:
+    void validate(std::string const& name) const;
+
+    std::unique_ptr<MappedFile> m_mapped;
+    std::vector<char> m_image;
+    char const* m_data;
+    std::size_t m_size;
+};
+
+// reorder triangles for the post transform vertex cache (Forsyth)
+std::vector<std::uint32_t> optimize_vertex_cache(std::vector<std::uint32_t> const& indices,
+                                                 std::size_t vertex_count);
+// average number of vertex shader invocations per triangle for a fifo cache
+float acmr(std::vector<std::uint32_t> const& indices, std::size_t cache_size = 16);
+
+// weld, reorder for cache and fetch locality, simplify into levels of detail and pack into a file image
+std::vector<char> build(obj_loader::Mesh const& mesh, NormalEncoding encoding = NORMAL_HALF,
+                        std::uint64_t source_size = 0, std::int64_t source_time = 0);
+
+// cache file belonging to an obj file
+std::string cache_path(std::string const& obj_path);
+// map the cache of an obj file, rebuilding it if missing or outdated
+// the cache is only kept in memory if it cannot be written next to the obj
+File load(std::string const& obj_path, NormalEncoding encoding = NORMAL_HALF);
+}  // namespace mesh_cache
+
+#endif
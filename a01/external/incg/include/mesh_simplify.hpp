@@ -0,0 +1,44 @@
+#ifndef MESH_SIMPLIFY_HPP
+#define MESH_SIMPLIFY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "culling.hpp"
+
+// quadric error edge collapse, every collapse moves a vertex onto a neighbour so all levels of
+// detail index the vertices of the full mesh and share its vertex buffer
+namespace mesh_simplify
+{
+// one level of detail inside the indices of all levels stored back to back
+struct Lod
+{
+    std::uint32_t first_index;
+    std::uint32_t index_count;
+    // largest collapse error as a fraction of the bounding radius of the mesh
+    float error;
+    std::uint32_t reserved;
+};
+
+// collapse edges until at most target_index_count indices are left or the next collapse would
+// exceed max_error, vertices on open borders and on normal seams stay in place
+std::vector<std::uint32_t> simplify(std::vector<glm::vec3> const& positions, std::vector<std::uint32_t> const& indices,
+                                    std::size_t target_index_count, float max_error = 1.0f, float* error = nullptr);
+
+// level 0 is the mesh itself, each further level has about half the triangles of the previous one
+// until min_triangles or until the mesh cannot be reduced further
+// returns the indices of all levels back to back, lods receives their ranges
+std::vector<std::uint32_t> build_lods(std::vector<glm::vec3> const& positions, std::vector<std::uint32_t> const& indices,
+                                      std::vector<Lod>& lods, std::size_t max_lods = 6,
+                                      std::size_t min_triangles = 256);
+
+// coarsest level whose error covers at most pixel_error pixels for an instance with the given
+// world bounds, levels closer than their bounding sphere radius always use level 0
+std::size_t select_lod(std::vector<Lod> const& lods, Bounds const& world, glm::fmat4 const& view,
+                       glm::fmat4 const& projection, float viewport_height, float pixel_error);
+}  // namespace mesh_simplify
+
+#endif
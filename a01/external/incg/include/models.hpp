@@ -3,8 +3,14 @@
 #include <string>
 #include <vector>
 
+#include <glbinding/gl/enum.h>
 #include <glm/gtc/type_precision.hpp>
 
+#include "culling.hpp"
+#include "mesh_arena.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_simplify.hpp"
+
 // Screen Space Quad
 class simpleQuad {
 public:
@@ -35,29 +41,76 @@ protected:
   GLuint vao = 0;
 };
 
+// triangle covering the viewport, vertices are generated from gl_VertexID
+// in the shader so only an empty vao is needed
+class fullscreenTriangle {
+public:
+  fullscreenTriangle();
+  ~fullscreenTriangle();
+  fullscreenTriangle(const fullscreenTriangle&) = delete;
+  void draw() const;
+  GLuint vertexArray() const { return vao; }
+
+protected:
+  GLuint vao = 0;
+};
+
 // very simple geometry
+// with an arena the geometry is suballocated from its shared buffers instead
+// of owning a vao
 class simpleModel {
 public:
-  simpleModel(std::string const &fileName);
+  // obj files are loaded through their binary mesh cache, built on first use
+  simpleModel(std::string const &fileName, MeshArena *arena = nullptr);
   ~simpleModel();
   simpleModel(const simpleModel&) = delete;
-  void draw() const;
+  void draw() const { draw(0); }
+  void draw(size_t lod) const;
+  // vao draw() binds, the arena's when suballocated
+  GLuint vertexArray() const { return arena ? arena->vertexArray() : vao; }
+
+  // range of the full mesh inside the arena, empty without arena
+  MeshRange const &mesh() const { return range; }
+  MeshRange mesh(size_t lod) const;
+  // model space bounds, computed when the geometry is uploaded
+  Bounds const &bounds() const { return bounding; }
+
+  // levels of detail share the vertices, level 0 is the full mesh
+  size_t lodCount() const { return lods.size(); }
+  size_t triangleCount(size_t lod = 0) const {
+    return lods[lod].index_count / 3;
+  }
+  // coarsest level within pixel_error pixels for an instance with the given
+  // world bounds
+  size_t selectLod(Bounds const &world, glm::fmat4 const &view,
+                   glm::fmat4 const &projection, float viewport_height,
+                   float pixel_error) const;
 
 protected:
-  simpleModel();
+  simpleModel(MeshArena *arena = nullptr);
   void upload();
+  // interleaved vertices and indices in one buffer straight from the cache
+  void upload(mesh_cache::File const &mesh);
+  // indices of all levels back to back, levels are built on upload if unset
   std::vector<uint32_t> indices;
+  std::vector<mesh_simplify::Lod> lods;
   std::vector<glm::vec3> vertices;
   std::vector<glm::vec3> normals;
-  uint32_t vbo[3];
+  uint32_t vbo[3] = {0, 0, 0};
   GLuint vao = 0;
+  GLenum index_type = GL_UNSIGNED_INT;
+  size_t index_offset = 0;
+  MeshArena *arena = nullptr;
+  MeshRange range;
+  Bounds bounding;
 };
 
 class groundPlane : public simpleModel {
 public:
-  groundPlane(const float height, const float width);
   groundPlane(const float height, const float width,
-              const unsigned int resolution);
+              MeshArena *arena = nullptr);
+  groundPlane(const float height, const float width,
+              const unsigned int resolution, MeshArena *arena = nullptr);
   groundPlane(const groundPlane&) = delete;
 };
 
@@ -73,6 +126,7 @@ public:
   ~solidSphere();
   solidSphere(const solidSphere&) = delete;
   void draw() const;
+  Bounds const &bounds() const { return bounding; }
 
 protected:
   void upload();
@@ -81,4 +135,5 @@ protected:
   std::vector<glm::vec3> vertices;
   uint32_t vbo[3];
   GLuint vao = 0;
+  Bounds bounding;
 };
@@ -0,0 +1,114 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+// timing of one scope within a frame, times in ms relative to the profiler start
+struct ProfileMarker
+{
+    // must outlive the profiler, usually a string literal
+    char const* name;
+    int depth;
+    double cpu_begin;
+    double cpu_end;
+    double gpu_begin;
+    double gpu_end;
+
+    double cpu() const { return cpu_end - cpu_begin; }
+    double gpu() const { return gpu_end - gpu_begin; }
+};
+
+// all markers of a frame in the order they were opened, first marker spans the whole frame
+struct FrameProfile
+{
+    std::uint64_t index = 0;
+    std::vector<ProfileMarker> markers{};
+
+    double cpu() const { return markers.empty() ? 0.0 : markers.front().cpu(); }
+    double gpu() const { return markers.empty() ? 0.0 : markers.front().gpu(); }
+};
+
+// hierarchical cpu and gpu profiler
+// gpu timestamps go into a ring of query sets which are read back frames later without blocking
+class Profiler
+{
+   public:
+    Profiler(unsigned frames_in_flight = 4, std::size_t history_size = 300);
+    Profiler(Profiler const&) = delete;
+    Profiler& operator=(Profiler const&) = delete;
+    ~Profiler();
+
+    // collect finished frames and open root marker of a new frame
+    void beginFrame();
+    void endFrame();
+
+    // open and close nested markers, prefer ProfileScope
+    void push(char const* name);
+    void pop();
+
+    // frames resolved since the last call, oldest first
+    std::vector<FrameProfile> takeResolved();
+    // most recent frame with gpu results
+    FrameProfile const& latest() const;
+    // frames whose queries were still pending when their slot was reused
+    std::uint64_t droppedFrames() const;
+
+    // wait for all pending queries, only meant for shutdown
+    void flush();
+
+    // tree and flame graph of the latest frame
+    void imgui();
+    // write resolved history in chrome://tracing format
+    void writeChromeTrace(std::string const& path) const;
+
+   private:
+    struct Slot
+    {
+        FrameProfile frame{};
+        // begin and end timestamp query per marker
+        std::vector<GLuint> queries{};
+        bool pending = false;
+    };
+
+    double cpuNow() const;
+    GLuint timestamp(Slot& slot, std::size_t index);
+    bool tryResolve(Slot& slot, bool wait);
+
+    std::vector<Slot> m_slots;
+    std::size_t m_current;
+    std::uint64_t m_frame_index;
+    std::uint64_t m_dropped;
+    std::vector<std::size_t> m_open;
+
+    std::deque<FrameProfile> m_history;
+    std::size_t m_history_size;
+    std::vector<FrameProfile> m_resolved;
+    FrameProfile m_latest;
+
+    std::chrono::steady_clock::time_point m_cpu_epoch;
+    GLint64 m_gpu_epoch;
+};
+
+// marks cpu and gpu time of the enclosing scope
+class ProfileScope
+{
+   public:
+    ProfileScope(Profiler& profiler, char const* name);
+    ProfileScope(ProfileScope&& rhs);
+    ProfileScope(ProfileScope const&) = delete;
+    ProfileScope& operator=(ProfileScope const&) = delete;
+    ~ProfileScope();
+
+   private:
+    Profiler* m_profiler;
+};
+
+#endif
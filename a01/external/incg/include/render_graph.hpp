@@ -0,0 +1,175 @@
+#ifndef RENDER_GRAPH_HPP
+#define RENDER_GRAPH_HPP
+
+#include <glbinding/gl/types.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include "helper.hpp"
+
+// size and format of a render target
+struct TextureDesc
+{
+    glm::uvec2 dimensions;
+    GLenum internal_format;
+};
+bool operator==(TextureDesc const& lhs, TextureDesc const& rhs);
+bool operator!=(TextureDesc const& lhs, TextureDesc const& rhs);
+
+// render targets keyed by size and format, released textures are handed out again instead
+// of allocating, so sizes used before (toggles, restoring a window) cost nothing
+// textures idle for a number of frames are deleted, which bounds memory while resizing
+class TexturePool
+{
+   public:
+    explicit TexturePool(unsigned retire_frames = 8);
+    TexturePool(TexturePool const&) = delete;
+    TexturePool& operator=(TexturePool const&) = delete;
+
+    Tex& acquire(TextureDesc const& desc);
+    void release(Tex const& texture);
+    // advance the frame, returns the names of the deleted textures
+    std::vector<GLuint> endFrame();
+
+    // textures alive, in use or idle
+    std::size_t size() const;
+    // textures created since construction
+    std::size_t allocations() const;
+
+   private:
+    struct Entry
+    {
+        std::unique_ptr<Tex> texture;
+        TextureDesc desc;
+        bool in_use;
+        std::uint64_t last_use;
+    };
+    std::vector<Entry> m_entries;
+    unsigned m_retire_frames;
+    std::uint64_t m_frame;
+    std::size_t m_allocations;
+};
+
+// passes of one frame with their declared texture accesses
+// before a pass runs its textures are bound, its framebuffer attached and the memory barriers
+// its reads need after earlier image writes are issued
+// transient textures are taken from the pool at their first use and handed back after their
+// last, so textures of passes that do not overlap share memory
+class RenderGraph
+{
+   public:
+    // texture of the frame being built
+    struct Resource
+    {
+        unsigned index;
+    };
+    // last frame's value and this frame's target of a ping pong pair
+    struct History
+    {
+        Resource previous;
+        Resource current;
+        // newly allocated, previous holds no data
+        bool reset;
+    };
+
+    class PassBuilder
+    {
+       public:
+        // bound to the texture unit while the pass runs
+        PassBuilder& sample(Resource texture, GLuint unit);
+        // bound to the image unit with the format of the texture
+        PassBuilder& image(Resource texture, GLuint unit, GLenum access);
+        // render targets, the pass runs with their framebuffer bound and the viewport covering them
+        PassBuilder& color(Resource texture);
+        PassBuilder& depth(Resource texture);
+
+       private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, std::size_t pass);
+        RenderGraph& m_graph;
+        std::size_t m_pass;
+    };
+
+    explicit RenderGraph(unsigned retire_frames = 8);
+    RenderGraph(RenderGraph const&) = delete;
+    RenderGraph& operator=(RenderGraph const&) = delete;
+
+    // texture living from its first to its last use within the frame
+    Resource transient(TextureDesc const& desc);
+    // ping pong pair swapped after every frame, reallocated and reset when the desc changes
+    History history(std::string const& name, TextureDesc const& desc);
+    // passes run in the order they are added, without render targets into the default framebuffer
+    PassBuilder addPass(std::string const& name, std::function<void()> const& run);
+
+    // run the passes, output is the default framebuffer size
+    void execute(glm::uvec2 const& output);
+    // texture behind a resource, valid while the passes declaring it run
+    Tex const& texture(Resource resource) const;
+    // value a history held at the end of the last frame
+    Tex const& previous(std::string const& name) const;
+
+    TexturePool const& pool() const;
+    // framebuffers and memory barriers of the last frame
+    std::size_t framebuffers() const;
+    unsigned barriers() const;
+
+   private:
+    enum Access
+    {
+        SAMPLE,
+        IMAGE,
+        COLOR,
+        DEPTH,
+    };
+    struct Use
+    {
+        unsigned resource;
+        Access access;
+        GLuint unit;
+        GLenum image_access;
+    };
+    struct Pass
+    {
+        std::string name;
+        std::function<void()> run;
+        std::vector<Use> uses;
+    };
+    struct Entry
+    {
+        TextureDesc desc;
+        Tex* texture;
+        bool transient;
+    };
+    struct HistoryPair
+    {
+        TextureDesc desc;
+        Tex* textures[2];
+        unsigned current;
+        // only pairs requested in a frame swap after it
+        std::uint64_t last_use;
+    };
+
+    void use(std::size_t pass, Resource resource, Access access, GLuint unit, GLenum image_access);
+    void prepare(Pass const& pass, glm::uvec2 const& output);
+
+    TexturePool m_pool;
+    std::vector<Pass> m_passes;
+    std::vector<Entry> m_resources;
+    std::map<std::string, HistoryPair> m_histories;
+    // keyed by the names of the attached textures, depth last
+    std::map<std::vector<GLuint>, Fbo> m_framebuffers;
+    // barrier bits still owed to each texture written through an image unit
+    std::map<GLuint, unsigned> m_pending;
+    std::uint64_t m_frame;
+    unsigned m_barriers;
+};
+
+#endif
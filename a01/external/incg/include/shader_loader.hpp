@@ -2,20 +2,85 @@
 #define SHADER_LOADER_HPP
 
 #include <glbinding/gl/enum.h>
+#include <glbinding/gl/types.h>
+#include <glm/gtc/type_precision.hpp>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 using namespace gl;
 
 namespace shader_loader
 {
+// active uniform outside of blocks
+struct UniformInfo
+{
+    GLint location;
+    GLenum type;
+    // number of array elements, 1 for non-arrays
+    GLint size;
+};
+// active uniform block
+struct BlockInfo
+{
+    GLuint index;
+    GLuint binding;
+    GLint data_size;
+};
+// interface of a linked program, queried once after linking
+struct Reflection
+{
+    // arrays are found with and without the [0] suffix
+    std::unordered_map<std::string, UniformInfo> uniforms{};
+    std::unordered_map<std::string, BlockInfo> blocks{};
+    // zero unless the program has a compute stage
+    glm::ivec3 work_group_size{0};
+};
+Reflection reflect(unsigned program, bool compute);
+
 // compile shader
 unsigned shader(std::string const& file_path, GLenum shader_type, bool binary = false);
 // create program from given list of stages
 unsigned program(std::map<GLenum, std::string> const&, bool binary = false);
 unsigned program_binary(std::string const& file);
 
+// program handed to the driver without waiting for it
+struct PendingProgram
+{
+    GLuint program = 0;
+    std::vector<GLuint> shaders{};
+    // source file of each shader
+    std::vector<std::string> stage_files{};
+    // every file the sources were expanded from, includes too
+    std::vector<std::string> files{};
+    std::string cache_path{};
+    bool cached = false;
+};
+// start compiling and linking the stages, cached binaries are loaded right away
+PendingProgram begin_program(std::map<GLenum, std::string> const& stages);
+// the driver has finished, finish() will not block
+bool ready(PendingProgram const& pending);
+// linked program, throws with the logs like program() when compiling or linking failed
+unsigned finish(PendingProgram& pending);
+// drop a build that is no longer wanted, the driver may still be working on it
+void cancel(PendingProgram& pending);
+// let the driver compile on its own threads, false if it does not support
+// GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile
+bool enable_parallel_compile();
+// forget the expanded text of every file including this one, it changed on disk
+void invalidate(std::string const& file);
 
-bool RequireReload();
+// directory of linked program binaries, keyed by the preprocessed sources and the driver
+// programs found there are loaded with glProgramBinary instead of compiling, empty disables it
+void set_binary_cache(std::string const& directory);
+// programs built since startup and the time the calling thread spent on them
+struct BuildStats
+{
+    unsigned cached     = 0;
+    unsigned compiled   = 0;
+    double milliseconds = 0.0;
+};
+BuildStats const& build_stats();
 }  // namespace shader_loader
 
 #endif
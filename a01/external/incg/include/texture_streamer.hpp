@@ -0,0 +1,84 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/types.h>
+#include <glm/gtc/type_precision.hpp>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include "helper.hpp"
+#include "thread_pool.hpp"
+
+struct TextureRequest;
+
+// texture loaded by TextureStreamer, binds a placeholder until it is resident
+class StreamedTexture
+{
+   public:
+    // empty handle, binds no texture
+    StreamedTexture() = default;
+
+    void bind() const;
+    // texture bind() binds, the placeholder until resident
+    GLuint index() const;
+    // uploaded and mipmapped, bind() uses the loaded texture
+    bool resident() const;
+    // file could not be loaded, the placeholder stays bound
+    bool failed() const;
+    // zero until decoded
+    glm::uvec2 dimensions() const;
+
+   private:
+    friend class TextureStreamer;
+    explicit StreamedTexture(std::shared_ptr<TextureRequest> request);
+
+    std::shared_ptr<TextureRequest> m_request{};
+};
+
+// decodes png files and filters their mipmaps on worker threads, then uploads them
+// through pixel buffer objects a few rows per frame, so loading never stalls rendering
+class TextureStreamer
+{
+   public:
+    // bytes_per_frame bounds the pixel data staged per frame, threads = 0 picks a default
+    TextureStreamer(std::size_t bytes_per_frame = 8u << 20, unsigned threads = 0);
+    TextureStreamer(TextureStreamer const&) = delete;
+    TextureStreamer& operator=(TextureStreamer const&) = delete;
+    ~TextureStreamer();
+
+    // queue file for decoding and return immediately
+    StreamedTexture load(std::string const& filename, GLenum wrap_mode = GL_REPEAT);
+    // advance uploads, call once per frame on the render thread
+    void update();
+    // requests neither resident nor failed
+    std::size_t pending() const { return m_pending.size(); }
+
+   private:
+    // ring of staging buffers, reused once the gpu consumed them
+    struct Staging
+    {
+        GLuint buffer = 0;
+        std::size_t size = 0;
+        GLsync fence = nullptr;
+    };
+    static const unsigned STAGING_BUFFERS = 3;
+
+    // copy rows of the current and following mip levels into the next free staging buffer
+    // and upload them, false if none is free
+    bool uploadRows(TextureRequest& request, std::size_t& budget);
+
+    std::size_t m_bytes_per_frame;
+    Staging m_staging[STAGING_BUFFERS];
+    unsigned m_next_staging;
+    Tex m_placeholder;
+    std::vector<std::shared_ptr<TextureRequest>> m_pending;
+    // declared last so workers are joined before anything they touch is destroyed
+    ThreadPool m_pool;
+};
+
+#endif
@@ -0,0 +1,401 @@
+#include "culling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define CULLING_SSE 1
+#    include <emmintrin.h>
+#endif
+
+namespace
+{
+// instances per bvh leaf, a leaf is tested like a short linear range
+const std::uint32_t LEAF_SIZE = 8;
+const unsigned ALL_PLANES     = (1u << 6) - 1;
+
+float distance(glm::fvec4 const& plane, glm::fvec3 const& point)
+{
+    return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+}
+
+// -1 outside of the plane, 1 inside, 0 crossing it
+int classify(glm::fvec4 const& plane, glm::fvec3 const& min, glm::fvec3 const& max)
+{
+    // the corners farthest along and against the plane normal
+    glm::fvec3 positive{plane.x >= 0.0f ? max.x : min.x, plane.y >= 0.0f ? max.y : min.y,
+                        plane.z >= 0.0f ? max.z : min.z};
+    if (distance(plane, positive) < 0.0f)
+    {
+        return -1;
+    }
+    glm::fvec3 negative{plane.x >= 0.0f ? min.x : max.x, plane.y >= 0.0f ? min.y : max.y,
+                        plane.z >= 0.0f ? min.z : max.z};
+    return distance(plane, negative) >= 0.0f ? 1 : 0;
+}
+
+bool sphereInside(Frustum const& frustum, glm::fvec3 const& center, float radius)
+{
+    for (glm::fvec4 const& plane : frustum.planes)
+    {
+        if (distance(plane, center) < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool boxInside(Frustum const& frustum, Bounds const& bounds)
+{
+    for (glm::fvec4 const& plane : frustum.planes)
+    {
+        if (classify(plane, bounds.min, bounds.max) < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef CULLING_SSE
+// bit i set where sphere i is not outside of any plane
+int spheresInside(Frustum const& frustum, __m128 x, __m128 y, __m128 z, __m128 radius)
+{
+    __m128 inside       = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 const negate = _mm_sub_ps(_mm_setzero_ps(), radius);
+    for (glm::fvec4 const& plane : frustum.planes)
+    {
+        __m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+        d        = _mm_add_ps(d, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+        d        = _mm_add_ps(d, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+        inside   = _mm_and_ps(inside, _mm_cmpge_ps(d, negate));
+    }
+    return _mm_movemask_ps(inside);
+}
+#endif
+}  // namespace
+
+Bounds compute_bounds(void const* positions, std::size_t count, std::size_t stride)
+{
+    Bounds bounds{};
+    if (count == 0)
+    {
+        return bounds;
+    }
+    unsigned char const* bytes = static_cast<unsigned char const*>(positions);
+    glm::fvec3 min{std::numeric_limits<float>::max()};
+    glm::fvec3 max{-std::numeric_limits<float>::max()};
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::fvec3 position;
+        std::memcpy(&position, bytes + i * stride, sizeof(position));
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    bounds.min    = min;
+    bounds.max    = max;
+    bounds.center = (min + max) * 0.5f;
+    // tighter than half the diagonal for most meshes
+    float radius2 = 0.0f;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::fvec3 position;
+        std::memcpy(&position, bytes + i * stride, sizeof(position));
+        glm::fvec3 offset = position - bounds.center;
+        radius2           = std::max(radius2, glm::dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(radius2);
+    return bounds;
+}
+
+Bounds compute_bounds(std::vector<glm::fvec3> const& positions)
+{
+    return compute_bounds(positions.data(), positions.size());
+}
+
+Bounds transform_bounds(Bounds const& bounds, glm::fmat4 const& matrix)
+{
+    // each output axis extends by the absolute contribution of each input axis
+    Bounds result{};
+    glm::fvec3 const translation{matrix[3]};
+    result.min = translation;
+    result.max = translation;
+    for (int column = 0; column < 3; ++column)
+    {
+        for (int row = 0; row < 3; ++row)
+        {
+            float a = matrix[column][row] * bounds.min[column];
+            float b = matrix[column][row] * bounds.max[column];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    result.center = glm::fvec3{matrix * glm::fvec4{bounds.center, 1.0f}};
+    float scale2  = std::max(glm::dot(glm::fvec3{matrix[0]}, glm::fvec3{matrix[0]}),
+                            std::max(glm::dot(glm::fvec3{matrix[1]}, glm::fvec3{matrix[1]}),
+                                     glm::dot(glm::fvec3{matrix[2]}, glm::fvec3{matrix[2]})));
+    result.radius = bounds.radius * std::sqrt(scale2);
+    return result;
+}
+
+Frustum extract_frustum(glm::fmat4 const& view_projection)
+{
+    // rows of the matrix, glm is column major
+    glm::fvec4 const row0{view_projection[0][0], view_projection[1][0], view_projection[2][0],
+                          view_projection[3][0]};
+    glm::fvec4 const row1{view_projection[0][1], view_projection[1][1], view_projection[2][1],
+                          view_projection[3][1]};
+    glm::fvec4 const row2{view_projection[0][2], view_projection[1][2], view_projection[2][2],
+                          view_projection[3][2]};
+    glm::fvec4 const row3{view_projection[0][3], view_projection[1][3], view_projection[2][3],
+                          view_projection[3][3]};
+    Frustum frustum{};
+    // left, right, bottom, top, near and far for clip space z from -w to w
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+    for (glm::fvec4& plane : frustum.planes)
+    {
+        float length = glm::length(glm::fvec3{plane});
+        if (length > 0.0f)
+        {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+bool intersects(Frustum const& frustum, Bounds const& bounds)
+{
+    return sphereInside(frustum, bounds.center, bounds.radius) && boxInside(frustum, bounds);
+}
+
+Visibility::Visibility(Mode mode)
+    : m_mode{mode},
+      m_bounds{},
+      m_spheres{},
+      m_visible{},
+      m_visible_list{},
+      m_nodes{},
+      m_order{},
+      m_bvh_dirty{true},
+      m_node_tests{0},
+      m_instance_tests{0}
+{
+}
+
+void Visibility::clear()
+{
+    m_bounds.clear();
+    for (std::vector<float>& stream : m_spheres)
+    {
+        stream.clear();
+    }
+    m_visible.clear();
+    m_visible_list.clear();
+    m_bvh_dirty = true;
+}
+
+std::uint32_t Visibility::add(Bounds const& world)
+{
+    std::uint32_t const instance = static_cast<std::uint32_t>(m_bounds.size());
+    m_bounds.push_back(world);
+    m_spheres[0].push_back(world.center.x);
+    m_spheres[1].push_back(world.center.y);
+    m_spheres[2].push_back(world.center.z);
+    m_spheres[3].push_back(world.radius);
+    m_visible.push_back(1);
+    m_bvh_dirty = true;
+    return instance;
+}
+
+void Visibility::setMode(Mode mode)
+{
+    m_mode = mode;
+}
+
+void Visibility::cull(Frustum const& frustum)
+{
+    m_visible_list.clear();
+    m_node_tests     = 0;
+    m_instance_tests = 0;
+    if (m_mode == OFF)
+    {
+        for (std::uint32_t i = 0; i < m_bounds.size(); ++i)
+        {
+            m_visible[i] = 1;
+            m_visible_list.push_back(i);
+        }
+        return;
+    }
+    std::fill(m_visible.begin(), m_visible.end(), std::uint8_t{0});
+    if (m_mode == LINEAR || m_bounds.size() <= LEAF_SIZE)
+    {
+        cullRange(frustum, nullptr, m_bounds.size());
+    }
+    else
+    {
+        if (m_bvh_dirty)
+        {
+            m_nodes.assign(1, Node{});
+            m_order.resize(m_bounds.size());
+            for (std::uint32_t i = 0; i < m_order.size(); ++i)
+            {
+                m_order[i] = i;
+            }
+            build(0, 0, static_cast<std::uint32_t>(m_order.size()));
+            m_bvh_dirty = false;
+        }
+        cullNode(frustum, 0, ALL_PLANES);
+        // nodes are visited front to back of m_order, sorting keeps the list in instance order
+        std::sort(m_visible_list.begin(), m_visible_list.end());
+    }
+}
+
+void Visibility::markVisible(std::uint32_t instance)
+{
+    m_visible[instance] = 1;
+    m_visible_list.push_back(instance);
+}
+
+void Visibility::cullRange(Frustum const& frustum, std::uint32_t const* order, std::size_t count)
+{
+    m_instance_tests += count;
+    std::size_t i = 0;
+#ifdef CULLING_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x, y, z, radius;
+        if (order)
+        {
+            std::uint32_t const* o = order + i;
+            x      = _mm_setr_ps(m_spheres[0][o[0]], m_spheres[0][o[1]], m_spheres[0][o[2]], m_spheres[0][o[3]]);
+            y      = _mm_setr_ps(m_spheres[1][o[0]], m_spheres[1][o[1]], m_spheres[1][o[2]], m_spheres[1][o[3]]);
+            z      = _mm_setr_ps(m_spheres[2][o[0]], m_spheres[2][o[1]], m_spheres[2][o[2]], m_spheres[2][o[3]]);
+            radius = _mm_setr_ps(m_spheres[3][o[0]], m_spheres[3][o[1]], m_spheres[3][o[2]], m_spheres[3][o[3]]);
+        }
+        else
+        {
+            x      = _mm_loadu_ps(&m_spheres[0][i]);
+            y      = _mm_loadu_ps(&m_spheres[1][i]);
+            z      = _mm_loadu_ps(&m_spheres[2][i]);
+            radius = _mm_loadu_ps(&m_spheres[3][i]);
+        }
+        int inside = spheresInside(frustum, x, y, z, radius);
+        for (std::size_t lane = 0; inside != 0; ++lane, inside >>= 1)
+        {
+            std::uint32_t const instance = order ? order[i + lane] : static_cast<std::uint32_t>(i + lane);
+            // spheres of elongated meshes reach far beyond the box
+            if ((inside & 1) && boxInside(frustum, m_bounds[instance]))
+            {
+                markVisible(instance);
+            }
+        }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        std::uint32_t const instance = order ? order[i] : static_cast<std::uint32_t>(i);
+        if (intersects(frustum, m_bounds[instance]))
+        {
+            markVisible(instance);
+        }
+    }
+}
+
+void Visibility::cullNode(Frustum const& frustum, std::uint32_t index, unsigned planes)
+{
+    Node const& node = m_nodes[index];
+    ++m_node_tests;
+    // planes the box is fully inside of are skipped further down
+    for (unsigned plane = 0; plane < 6; ++plane)
+    {
+        if (!(planes & (1u << plane)))
+        {
+            continue;
+        }
+        int side = classify(frustum.planes[plane], node.min, node.max);
+        if (side < 0)
+        {
+            return;
+        }
+        if (side > 0)
+        {
+            planes &= ~(1u << plane);
+        }
+    }
+    if (planes == 0 || node.leaf)
+    {
+        if (planes == 0)
+        {
+            // whole subtree inside, leaves are a contiguous range of m_order
+            std::uint32_t first = index;
+            while (!m_nodes[first].leaf)
+            {
+                first = m_nodes[first].first;
+            }
+            std::uint32_t last = index;
+            while (!m_nodes[last].leaf)
+            {
+                last = m_nodes[last].first + 1;
+            }
+            for (std::uint32_t i = m_nodes[first].first; i < m_nodes[last].first + m_nodes[last].count; ++i)
+            {
+                markVisible(m_order[i]);
+            }
+            return;
+        }
+        cullRange(frustum, m_order.data() + node.first, node.count);
+        return;
+    }
+    cullNode(frustum, node.first, planes);
+    cullNode(frustum, node.first + 1, planes);
+}
+
+void Visibility::build(std::uint32_t index, std::uint32_t first, std::uint32_t count)
+{
+    glm::fvec3 min{std::numeric_limits<float>::max()};
+    glm::fvec3 max{-std::numeric_limits<float>::max()};
+    glm::fvec3 center_min = min;
+    glm::fvec3 center_max = max;
+    for (std::uint32_t i = first; i < first + count; ++i)
+    {
+        Bounds const& bounds = m_bounds[m_order[i]];
+        min                  = glm::min(min, bounds.min);
+        max                  = glm::max(max, bounds.max);
+        center_min           = glm::min(center_min, bounds.center);
+        center_max           = glm::max(center_max, bounds.center);
+    }
+    m_nodes[index].min = min;
+    m_nodes[index].max = max;
+    if (count <= LEAF_SIZE)
+    {
+        m_nodes[index].first = first;
+        m_nodes[index].count = count;
+        m_nodes[index].leaf  = true;
+        return;
+    }
+    // median split along the longest extent of the centers
+    glm::fvec3 const extent = center_max - center_min;
+    int axis                = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    std::uint32_t const half = count / 2;
+    std::nth_element(m_order.begin() + first, m_order.begin() + first + half, m_order.begin() + first + count,
+                     [this, axis](std::uint32_t lhs, std::uint32_t rhs) {
+                         return m_bounds[lhs].center[axis] < m_bounds[rhs].center[axis];
+                     });
+    // children are allocated next to each other so one index addresses both
+    std::uint32_t const children = static_cast<std::uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node{});
+    m_nodes.push_back(Node{});
+    build(children, first, half);
+    build(children + 1, first + half, count - half);
+    m_nodes[index].first = children;
+    m_nodes[index].count = 0;
+    m_nodes[index].leaf  = false;
+}
@@ -0,0 +1,149 @@
+#include "file_watcher.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+// how long the thread sleeps before looking at the stop flag again
+const int WAKE_MILLISECONDS = 100;
+
+#ifndef __linux__
+long write_time(std::string const& path)
+{
+    struct stat sb;
+    return stat(path.c_str(), &sb) == 0 ? long(sb.st_mtime) : 0;
+}
+#endif
+}  // namespace
+
+FileWatcher::FileWatcher()
+    : m_mutex{},
+      m_changed{},
+#ifdef __linux__
+      m_inotify{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)},
+      m_watches{},
+#else
+      m_write_times{},
+#endif
+      m_stop{false},
+      m_thread{}
+{
+#ifdef __linux__
+    if (m_inotify < 0)
+    {
+        std::cerr << "FileWatcher: inotify unavailable, files are not watched" << std::endl;
+        return;
+    }
+#endif
+    m_thread = std::thread{&FileWatcher::run, this};
+}
+
+FileWatcher::~FileWatcher()
+{
+    m_stop = true;
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+#ifdef __linux__
+    if (m_inotify >= 0)
+    {
+        close(m_inotify);
+    }
+#endif
+}
+
+void FileWatcher::watch(std::string const& path)
+{
+    std::string::size_type slash = path.find_last_of("/\\");
+    std::string directory        = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    std::string name             = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+#ifdef __linux__
+    if (m_inotify < 0)
+    {
+        return;
+    }
+    // the same directory under another spelling yields the same watch
+    int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch < 0)
+    {
+        std::cerr << "FileWatcher: cannot watch " << directory << std::endl;
+        return;
+    }
+    m_watches[watch][name].insert(path);
+#else
+    (void)name;
+    if (m_write_times.find(path) == m_write_times.end())
+    {
+        m_write_times[path] = write_time(path);
+    }
+#endif
+}
+
+std::vector<std::string> FileWatcher::takeChanged()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    std::vector<std::string> changed{m_changed.begin(), m_changed.end()};
+    m_changed.clear();
+    return changed;
+}
+
+void FileWatcher::run()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    pollfd descriptor{m_inotify, POLLIN, 0};
+    while (!m_stop)
+    {
+        if (poll(&descriptor, 1, WAKE_MILLISECONDS) <= 0)
+        {
+            continue;
+        }
+        ssize_t length = 0;
+        while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (char* event = buffer; event < buffer + length;)
+            {
+                auto const* info = reinterpret_cast<inotify_event const*>(event);
+                event += sizeof(inotify_event) + info->len;
+                auto directory = m_watches.find(info->wd);
+                if (info->len == 0 || directory == m_watches.end())
+                {
+                    continue;
+                }
+                auto file = directory->second.find(info->name);
+                if (file != directory->second.end())
+                {
+                    m_changed.insert(file->second.begin(), file->second.end());
+                }
+            }
+        }
+    }
+#else
+    while (!m_stop)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(WAKE_MILLISECONDS));
+        std::lock_guard<std::mutex> lock{m_mutex};
+        for (auto& file : m_write_times)
+        {
+            long time = write_time(file.first);
+            if (time != file.second)
+            {
+                file.second = time;
+                m_changed.insert(file.first);
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,427 @@
+#include "frame_capture.hpp"
+
+#include <glbinding/gl/bitfield.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <lodepng.h>
+
+#include "gl_state.hpp"
+
+namespace
+{
+bool has_extension(std::string const& path, std::string const& extension)
+{
+    return path.size() >= extension.size() &&
+           std::equal(extension.rbegin(), extension.rend(), path.rbegin(),
+                      [](char a, char b) { return a == char(std::tolower(b)); });
+}
+
+std::size_t channel_size(GLenum type)
+{
+    return type == GL_FLOAT ? sizeof(float) : 1;
+}
+
+void write_png(std::string const& path, CapturedImage const& image)
+{
+    // png rows run from top to bottom
+    std::vector<unsigned char> rgba(image.channelCount());
+    std::size_t row = std::size_t(image.size.x) * 4;
+    for (std::size_t y = 0; y < image.size.y; ++y)
+    {
+        std::size_t source = (image.size.y - 1 - y) * row;
+        for (std::size_t x = 0; x < row; ++x)
+        {
+            float value       = std::min(std::max(image.channel(source + x), 0.0f), 1.0f);
+            rgba[y * row + x] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+        }
+    }
+    unsigned error = lodepng::encode(path, rgba, image.size.x, image.size.y);
+    if (error)
+    {
+        throw std::runtime_error("LodePNG error - " + std::to_string(error) + ": " + lodepng_error_text(error) +
+                                 " (" + path + ")");
+    }
+}
+
+void write_pfm(std::string const& path, CapturedImage const& image)
+{
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    // negative scale marks little endian, rows run from bottom to top like gl
+    file << "PF\n" << image.size.x << " " << image.size.y << "\n-1.0\n";
+    std::vector<float> rgb(std::size_t(image.size.x) * image.size.y * 3);
+    for (std::size_t pixel = 0; pixel < rgb.size() / 3; ++pixel)
+    {
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            rgb[pixel * 3 + c] = image.channel(pixel * 4 + c);
+        }
+    }
+    file.write(reinterpret_cast<char const*>(rgb.data()), std::streamsize(rgb.size() * sizeof(float)));
+    if (!file)
+    {
+        throw std::runtime_error("Could not write \'" + path + "\'");
+    }
+}
+
+CapturedImage read_png(std::string const& path)
+{
+    std::vector<unsigned char> rgba;
+    unsigned width = 0, height = 0;
+    unsigned error = lodepng::decode(rgba, width, height, path);
+    if (error)
+    {
+        throw std::runtime_error("LodePNG error - " + std::to_string(error) + ": " + lodepng_error_text(error) +
+                                 " (" + path + ")");
+    }
+    CapturedImage image{glm::uvec2{width, height}, GL_UNSIGNED_BYTE, std::vector<unsigned char>(rgba.size())};
+    std::size_t row = std::size_t(width) * 4;
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        std::memcpy(&image.pixels[y * row], &rgba[(height - 1 - y) * row], row);
+    }
+    return image;
+}
+
+CapturedImage read_pfm(std::string const& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    std::string magic;
+    unsigned width = 0, height = 0;
+    float scale    = 0.0f;
+    if (!(file >> magic >> width >> height >> scale) || (magic != "PF" && magic != "Pf") || scale >= 0.0f)
+    {
+        throw std::runtime_error(path + ": not a little endian pfm image");
+    }
+    // a single whitespace character separates the header from the data
+    file.get();
+    std::size_t channels = magic == "PF" ? 3 : 1;
+    std::vector<float> values(std::size_t(width) * height * channels);
+    if (!file.read(reinterpret_cast<char*>(values.data()), std::streamsize(values.size() * sizeof(float))))
+    {
+        throw std::runtime_error(path + ": image truncated");
+    }
+    CapturedImage image{glm::uvec2{width, height}, GL_FLOAT,
+                        std::vector<unsigned char>(std::size_t(width) * height * 4 * sizeof(float))};
+    auto* rgba = reinterpret_cast<float*>(image.pixels.data());
+    for (std::size_t pixel = 0; pixel < std::size_t(width) * height; ++pixel)
+    {
+        for (std::size_t c = 0; c < 3; ++c)
+        {
+            rgba[pixel * 4 + c] = values[pixel * channels + (channels == 3 ? c : 0)];
+        }
+        rgba[pixel * 4 + 3] = 1.0f;
+    }
+    return image;
+}
+}  // namespace
+
+float CapturedImage::channel(std::size_t i) const
+{
+    if (type == GL_FLOAT)
+    {
+        float value;
+        std::memcpy(&value, &pixels[i * sizeof(float)], sizeof(float));
+        return value;
+    }
+    return float(pixels[i]) / 255.0f;
+}
+
+void write_image(std::string const& path, CapturedImage const& image)
+{
+    if (has_extension(path, ".pfm"))
+    {
+        write_pfm(path, image);
+    }
+    else
+    {
+        write_png(path, image);
+    }
+}
+
+CapturedImage read_image(std::string const& path)
+{
+    return has_extension(path, ".pfm") ? read_pfm(path) : read_png(path);
+}
+
+ImageDifference compare_images(CapturedImage const& lhs, CapturedImage const& rhs, float tolerance)
+{
+    if (lhs.size != rhs.size)
+    {
+        throw std::invalid_argument("compare_images: images differ in size");
+    }
+    ImageDifference difference{0.0f, 0};
+    for (std::size_t pixel = 0; pixel < std::size_t(lhs.size.x) * lhs.size.y; ++pixel)
+    {
+        float largest = 0.0f;
+        for (std::size_t c = 0; c < 4; ++c)
+        {
+            largest = std::max(largest, std::abs(lhs.channel(pixel * 4 + c) - rhs.channel(pixel * 4 + c)));
+        }
+        difference.max_difference = std::max(difference.max_difference, largest);
+        difference.pixels_over += largest > tolerance ? 1 : 0;
+    }
+    return difference;
+}
+
+FrameCapture::FrameCapture(unsigned ring_size, unsigned threads)
+    : m_slots{},
+      m_next{0},
+      m_persistent{false},
+      m_framebuffer{0},
+      m_captured{0},
+      m_dropped{0},
+      m_running{0},
+      m_mutex{},
+      m_done{},
+      m_encoders{new ThreadPool{std::max(1u, threads)}},
+      m_copier{new ThreadPool{1}}
+{
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    m_persistent = major > 4 || (major == 4 && minor >= 4);
+    for (unsigned i = 0; i < std::max(2u, ring_size); ++i)
+    {
+        m_slots.emplace_back(new Slot{});
+    }
+}
+
+FrameCapture::~FrameCapture()
+{
+    flush();
+    m_copier.reset();
+    m_encoders.reset();
+    for (auto& slot : m_slots)
+    {
+        if (slot->buffer == 0)
+        {
+            continue;
+        }
+        if (slot->mapping)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &slot->buffer);
+    }
+    if (m_framebuffer != 0)
+    {
+        gl_state::forget_framebuffer(m_framebuffer);
+        glDeleteFramebuffers(1, &m_framebuffer);
+    }
+}
+
+FrameCapture::Slot* FrameCapture::acquire(glm::uvec2 const& size, GLenum type)
+{
+    // slots finish in the order they were filled, if the next one is busy all are
+    Slot& slot = *m_slots[m_next];
+    if (slot.state.load(std::memory_order_acquire) != FREE)
+    {
+        ++m_dropped;
+        return nullptr;
+    }
+    m_next = (m_next + 1) % m_slots.size();
+
+    std::size_t bytes = std::size_t(size.x) * size.y * 4 * channel_size(type);
+    if (slot.capacity < bytes)
+    {
+        // storage of persistent buffers is immutable, grow by replacing the buffer
+        if (slot.buffer != 0)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            if (slot.mapping)
+            {
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                slot.mapping = nullptr;
+            }
+            glDeleteBuffers(1, &slot.buffer);
+        }
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        if (m_persistent)
+        {
+            glBufferStorage(GL_PIXEL_PACK_BUFFER, GLsizeiptr(bytes), nullptr,
+                            GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+            slot.mapping = static_cast<unsigned char*>(glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+        }
+        else
+        {
+            // no persistent mapping before 4.4, the buffer is mapped once its fence has passed
+            glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.capacity = bytes;
+    }
+    return &slot;
+}
+
+bool FrameCapture::read(Slot* slot, GLuint framebuffer, GLenum buffer, glm::uvec2 const& size, GLenum type,
+                        Sink sink)
+{
+    if (!slot)
+    {
+        return false;
+    }
+    GLint previous_buffer = 0, previous_alignment = 0;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &previous_buffer);
+    glGetIntegerv(GL_PACK_ALIGNMENT, &previous_alignment);
+
+    gl_state::bind_framebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // returns right away, the gpu packs into the buffer once the frame is drawn
+    glReadPixels(0, 0, GLsizei(size.x), GLsizei(size.y), GL_RGBA, type, nullptr);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT);
+    slot->size  = size;
+    slot->type  = type;
+    slot->sink  = std::move(sink);
+    slot->state.store(PACKING, std::memory_order_release);
+    ++m_captured;
+
+    glPixelStorei(GL_PACK_ALIGNMENT, previous_alignment);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, GLuint(previous_buffer));
+    return true;
+}
+
+bool FrameCapture::captureFramebuffer(GLuint framebuffer, glm::uvec2 const& size, GLenum type, Sink sink)
+{
+    return read(acquire(size, type), framebuffer, framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0, size, type,
+                std::move(sink));
+}
+
+bool FrameCapture::captureTexture(GLuint texture, glm::uvec2 const& size, GLenum type, Sink sink)
+{
+    Slot* slot = acquire(size, type);
+    if (!slot)
+    {
+        return false;
+    }
+    if (m_framebuffer == 0)
+    {
+        glGenFramebuffers(1, &m_framebuffer);
+    }
+    gl_state::bind_framebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    bool read_texture = read(slot, m_framebuffer, GL_COLOR_ATTACHMENT0, size, type, std::move(sink));
+    // the queued read keeps the texture, detached so the capture does not keep it alive
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    return read_texture;
+}
+
+bool FrameCapture::captureFramebuffer(GLuint framebuffer, glm::uvec2 const& size, std::string const& path)
+{
+    return captureFramebuffer(framebuffer, size, has_extension(path, ".pfm") ? GL_FLOAT : GL_UNSIGNED_BYTE,
+                              [path](CapturedImage& image) { write_image(path, image); });
+}
+
+bool FrameCapture::captureTexture(GLuint texture, glm::uvec2 const& size, std::string const& path)
+{
+    return captureTexture(texture, size, has_extension(path, ".pfm") ? GL_FLOAT : GL_UNSIGNED_BYTE,
+                          [path](CapturedImage& image) { write_image(path, image); });
+}
+
+void FrameCapture::submit(Slot& slot)
+{
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    unsigned char const* pixels = slot.mapping;
+    if (!pixels)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        pixels = static_cast<unsigned char const*>(
+            glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(slot.capacity), GL_MAP_READ_BIT));
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    slot.state.store(COPYING, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        ++m_running;
+    }
+    bool persistent = slot.mapping != nullptr;
+    Slot* target    = &slot;
+    m_copier->submit(
+        [this, target, pixels, persistent]()
+        {
+            std::shared_ptr<CapturedImage> image{new CapturedImage{target->size, target->type, {}}};
+            image->pixels.assign(pixels, pixels + image->channelCount() * channel_size(image->type));
+            Sink sink    = std::move(target->sink);
+            target->sink = nullptr;
+            // the slot can take the next capture while the image is encoded
+            target->state.store(persistent ? FREE : COPIED, std::memory_order_release);
+            m_encoders->submit(
+                [this, image, sink]()
+                {
+                    try
+                    {
+                        sink(*image);
+                    }
+                    catch (std::exception& e)
+                    {
+                        std::cerr << "Frame capture failed: " << e.what() << std::endl;
+                    }
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    --m_running;
+                    m_done.notify_all();
+                });
+        });
+}
+
+void FrameCapture::update()
+{
+    for (auto& pointer : m_slots)
+    {
+        Slot& slot = *pointer;
+        int state  = slot.state.load(std::memory_order_acquire);
+        if (state == COPIED)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            slot.state.store(FREE, std::memory_order_release);
+        }
+        else if (state == PACKING)
+        {
+            GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            {
+                submit(slot);
+            }
+        }
+    }
+}
+
+void FrameCapture::flush()
+{
+    for (auto& pointer : m_slots)
+    {
+        Slot& slot = *pointer;
+        if (slot.state.load(std::memory_order_acquire) == PACKING)
+        {
+            GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            while (result == GL_TIMEOUT_EXPIRED)
+            {
+                result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+            submit(slot);
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_done.wait(lock, [this]() { return m_running == 0; });
+    }
+    // unmap the buffers the workers have copied from
+    update();
+}
@@ -0,0 +1,132 @@
+#include "frame_pipeline.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+// sleeping is trusted up to this far before the deadline, the rest is spun
+const std::chrono::microseconds SPIN_MARGIN{1500};
+}  // namespace
+
+SceneSnapshot::~SceneSnapshot() {}
+
+FramePipeline::FramePipeline(std::function<FrameSnapshot()> step, unsigned capacity)
+    : m_step{std::move(step)},
+      m_capacity{std::max(1u, capacity)},
+      m_mutex{},
+      m_ready{},
+      m_space{},
+      m_queue{},
+      m_stop{false},
+      m_error{},
+      m_thread{}
+{
+    m_thread = std::thread{&FramePipeline::simulate, this};
+}
+
+FramePipeline::~FramePipeline()
+{
+    stop();
+}
+
+void FramePipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_space.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+FrameSnapshot FramePipeline::take()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    if (m_stop)
+    {
+        throw std::logic_error("FramePipeline: frame taken after stop");
+    }
+    m_ready.wait(lock, [this]() { return !m_queue.empty() || m_error; });
+    // snapshots simulated before the failing step are rendered first
+    if (m_queue.empty())
+    {
+        std::exception_ptr error = m_error;
+        m_error                  = nullptr;
+        lock.unlock();
+        m_space.notify_all();
+        std::rethrow_exception(error);
+    }
+    FrameSnapshot snapshot = std::move(m_queue.front());
+    m_queue.pop_front();
+    lock.unlock();
+    m_space.notify_all();
+    return snapshot;
+}
+
+void FramePipeline::simulate()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_space.wait(lock, [this]() { return m_stop || (m_queue.size() < m_capacity && !m_error); });
+            if (m_stop)
+            {
+                return;
+            }
+        }
+        FrameSnapshot snapshot{};
+        std::exception_ptr error{};
+        try
+        {
+            snapshot = m_step();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (error)
+            {
+                m_error = error;
+            }
+            else
+            {
+                m_queue.push_back(std::move(snapshot));
+            }
+        }
+        m_ready.notify_all();
+    }
+}
+
+FramePacer::FramePacer(double frame_seconds)
+    : m_period{std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frame_seconds))},
+      m_deadline{Clock::now() + m_period}
+{
+}
+
+void FramePacer::wait()
+{
+    Clock::time_point now = Clock::now();
+    if (m_deadline - now > SPIN_MARGIN)
+    {
+        std::this_thread::sleep_until(m_deadline - SPIN_MARGIN);
+    }
+    while (Clock::now() < m_deadline)
+    {
+        std::this_thread::yield();
+    }
+    m_deadline += m_period;
+    // a frame that ran over by more than a period starts a new schedule instead of rushing
+    // the following frames to catch up
+    now = Clock::now();
+    if (now > m_deadline)
+    {
+        m_deadline = now + m_period;
+    }
+}
@@ -0,0 +1,334 @@
+#include "gl_state.hpp"
+
+#include <glbinding/gl/boolean.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+namespace
+{
+// binding of unknown value, the next bind is always issued
+const GLuint UNKNOWN = ~0u;
+
+const unsigned TEXTURE_UNITS = 32;
+const unsigned IMAGE_UNITS   = 8;
+// targets and capabilities outside these lists are passed through
+const GLenum TEXTURE_TARGETS[] = {GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D};
+const GLenum CAPABILITIES[] = {GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST,
+                               GL_FRAMEBUFFER_SRGB};
+const unsigned TARGET_COUNT     = sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]);
+const unsigned CAPABILITY_COUNT = sizeof(CAPABILITIES) / sizeof(CAPABILITIES[0]);
+
+struct ImageBinding
+{
+    GLuint texture;
+    GLint level;
+    GLboolean layered;
+    GLint layer;
+    GLenum access;
+    GLenum format;
+};
+
+struct State
+{
+    GLuint program;
+    GLuint vertex_array;
+    GLuint draw_framebuffer;
+    GLuint read_framebuffer;
+    GLuint active_unit;
+    GLuint textures[TEXTURE_UNITS][TARGET_COUNT];
+    GLuint samplers[TEXTURE_UNITS];
+    ImageBinding images[IMAGE_UNITS];
+    // -1 unknown, 0 disabled, 1 enabled
+    int enabled[CAPABILITY_COUNT];
+    // GL_NONE unknown
+    GLenum depth_func;
+    gl_state::Counters counters;
+};
+
+// every binding unknown, the counters are kept
+void clear(State& tracked)
+{
+    tracked.program          = UNKNOWN;
+    tracked.vertex_array     = UNKNOWN;
+    tracked.draw_framebuffer = UNKNOWN;
+    tracked.read_framebuffer = UNKNOWN;
+    tracked.active_unit      = UNKNOWN;
+    for (auto& unit : tracked.textures)
+    {
+        for (GLuint& binding : unit)
+        {
+            binding = UNKNOWN;
+        }
+    }
+    for (GLuint& sampler : tracked.samplers)
+    {
+        sampler = UNKNOWN;
+    }
+    for (ImageBinding& image : tracked.images)
+    {
+        image.texture = UNKNOWN;
+    }
+    for (int& enabled : tracked.enabled)
+    {
+        enabled = -1;
+    }
+    tracked.depth_func = GL_NONE;
+}
+
+// the framework renders with a single context
+State& state()
+{
+    static State current = []() {
+        State initial{};
+        clear(initial);
+        return initial;
+    }();
+    return current;
+}
+
+unsigned target_slot(GLenum target)
+{
+    for (unsigned i = 0; i < TARGET_COUNT; ++i)
+    {
+        if (TEXTURE_TARGETS[i] == target)
+        {
+            return i;
+        }
+    }
+    return TARGET_COUNT;
+}
+
+unsigned capability_slot(GLenum capability)
+{
+    for (unsigned i = 0; i < CAPABILITY_COUNT; ++i)
+    {
+        if (CAPABILITIES[i] == capability)
+        {
+            return i;
+        }
+    }
+    return CAPABILITY_COUNT;
+}
+
+// true if the call has to be issued, records the new value
+bool change(GLuint& current, GLuint value)
+{
+    State& tracked = state();
+    if (current == value)
+    {
+        ++tracked.counters.filtered;
+        return false;
+    }
+    current = value;
+    ++tracked.counters.issued;
+    return true;
+}
+
+void forget(GLuint& current, GLuint name)
+{
+    if (current == name)
+    {
+        current = UNKNOWN;
+    }
+}
+}  // namespace
+
+namespace gl_state
+{
+void use_program(GLuint program)
+{
+    if (change(state().program, program))
+    {
+        glUseProgram(program);
+    }
+}
+
+void bind_vertex_array(GLuint vertex_array)
+{
+    if (change(state().vertex_array, vertex_array))
+    {
+        glBindVertexArray(vertex_array);
+    }
+}
+
+void bind_framebuffer(GLenum target, GLuint framebuffer)
+{
+    State& tracked = state();
+    if (target == GL_FRAMEBUFFER)
+    {
+        if (tracked.draw_framebuffer == framebuffer && tracked.read_framebuffer == framebuffer)
+        {
+            ++tracked.counters.filtered;
+            return;
+        }
+        tracked.draw_framebuffer = framebuffer;
+        tracked.read_framebuffer = framebuffer;
+        ++tracked.counters.issued;
+        glBindFramebuffer(target, framebuffer);
+    }
+    else if (change(target == GL_READ_FRAMEBUFFER ? tracked.read_framebuffer : tracked.draw_framebuffer, framebuffer))
+    {
+        glBindFramebuffer(target, framebuffer);
+    }
+}
+
+void active_texture(GLuint unit)
+{
+    if (change(state().active_unit, unit))
+    {
+        glActiveTexture(static_cast<GLenum>(static_cast<unsigned>(GL_TEXTURE0) + unit));
+    }
+}
+
+void bind_texture(GLenum target, GLuint texture)
+{
+    State& tracked = state();
+    if (tracked.active_unit == UNKNOWN)
+    {
+        // the unit is needed to track the binding, select it once
+        active_texture(0);
+    }
+    bind_texture(tracked.active_unit, target, texture);
+}
+
+void bind_texture(GLuint unit, GLenum target, GLuint texture)
+{
+    State& tracked = state();
+    unsigned slot  = target_slot(target);
+    if (unit >= TEXTURE_UNITS || slot == TARGET_COUNT)
+    {
+        active_texture(unit);
+        ++tracked.counters.issued;
+        glBindTexture(target, texture);
+        return;
+    }
+    GLuint& current = tracked.textures[unit][slot];
+    if (current == texture)
+    {
+        ++tracked.counters.filtered;
+        return;
+    }
+    active_texture(unit);
+    current = texture;
+    ++tracked.counters.issued;
+    glBindTexture(target, texture);
+}
+
+void bind_sampler(GLuint unit, GLuint sampler)
+{
+    State& tracked = state();
+    if (unit >= TEXTURE_UNITS)
+    {
+        ++tracked.counters.issued;
+        glBindSampler(unit, sampler);
+    }
+    else if (change(tracked.samplers[unit], sampler))
+    {
+        glBindSampler(unit, sampler);
+    }
+}
+
+void bind_image_texture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access,
+                        GLenum format)
+{
+    State& tracked = state();
+    if (unit < IMAGE_UNITS)
+    {
+        ImageBinding& current = tracked.images[unit];
+        if (current.texture == texture && current.level == level && current.layered == layered &&
+            current.layer == layer && current.access == access && current.format == format)
+        {
+            ++tracked.counters.filtered;
+            return;
+        }
+        current = ImageBinding{texture, level, layered, layer, access, format};
+    }
+    ++tracked.counters.issued;
+    glBindImageTexture(unit, texture, level, layered, layer, access, format);
+}
+
+void set_enabled(GLenum capability, bool enabled)
+{
+    State& tracked = state();
+    unsigned slot  = capability_slot(capability);
+    if (slot < CAPABILITY_COUNT)
+    {
+        if (tracked.enabled[slot] == (enabled ? 1 : 0))
+        {
+            ++tracked.counters.filtered;
+            return;
+        }
+        tracked.enabled[slot] = enabled ? 1 : 0;
+    }
+    ++tracked.counters.issued;
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+}
+
+void depth_func(GLenum func)
+{
+    State& tracked = state();
+    if (tracked.depth_func == func)
+    {
+        ++tracked.counters.filtered;
+        return;
+    }
+    tracked.depth_func = func;
+    ++tracked.counters.issued;
+    glDepthFunc(func);
+}
+
+void forget_program(GLuint program)
+{
+    forget(state().program, program);
+}
+
+void forget_vertex_array(GLuint vertex_array)
+{
+    forget(state().vertex_array, vertex_array);
+}
+
+void forget_framebuffer(GLuint framebuffer)
+{
+    State& tracked = state();
+    forget(tracked.draw_framebuffer, framebuffer);
+    forget(tracked.read_framebuffer, framebuffer);
+}
+
+void forget_texture(GLuint texture)
+{
+    State& tracked = state();
+    for (auto& unit : tracked.textures)
+    {
+        for (GLuint& binding : unit)
+        {
+            forget(binding, texture);
+        }
+    }
+    for (ImageBinding& image : tracked.images)
+    {
+        forget(image.texture, texture);
+    }
+}
+
+void invalidate()
+{
+    clear(state());
+}
+
+Counters const& counters()
+{
+    return state().counters;
+}
+
+void reset_counters()
+{
+    state().counters = Counters{};
+}
+}  // namespace gl_state
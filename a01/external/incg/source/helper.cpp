@@ -1,5 +1,6 @@
 #include "helper.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 
@@ -7,6 +8,10 @@
 
 #include <lodepng.h>
 
+#include "gl_state.hpp"
+#include "ktx_texture.hpp"
+#include "window_handler.hpp"
+
 #include <glbinding/gl/functions.h>
 #include <glbinding/gl/enum.h>
 // load meta info extension
@@ -19,11 +24,15 @@ Tex::Tex(unsigned w, unsigned h, GLenum internal_format)
 {}
 
 Tex::Tex(glm::uvec2 const& dims, GLenum internal_format)
+ :Tex{dims, internal_format, 1}
+{}
+
+Tex::Tex(glm::uvec2 const& dims, GLenum internal_format, unsigned levels)
 	:m_dimensions{dims}
 	,m_index{0}
 {
 	glGenTextures(1,&m_index);
-	glBindTexture(GL_TEXTURE_2D,m_index);
+	gl_state::bind_texture(GL_TEXTURE_2D, m_index);
 	GLenum pix_format = pixel_format(internal_format);
 	// default color texture values
 	GLenum wrap_mode = GL_REPEAT;
@@ -33,11 +42,15 @@ Tex::Tex(glm::uvec2 const& dims, GLenum internal_format)
 		wrap_mode = GL_CLAMP_TO_EDGE;
 		filter_mode = GL_NEAREST;
 	}
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter_mode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 && filter_mode == GL_LINEAR ? GL_LINEAR_MIPMAP_LINEAR : filter_mode);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter_mode);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
-	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, m_dimensions.x, m_dimensions.y, 0, pix_format, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(levels - 1));
+	for(unsigned level = 0; level < levels; ++level) {
+		glm::uvec2 size = glm::max(m_dimensions >> level, glm::uvec2{1});
+		glTexImage2D(GL_TEXTURE_2D, GLint(level), internal_format, size.x, size.y, 0, pix_format, GL_UNSIGNED_BYTE, nullptr);
+	}
 }
 
 #include <sstream>
@@ -61,6 +74,10 @@ Tex::Tex(std::string const& filename, GLenum wrap_mode)
  :m_dimensions{}
  ,m_index{0}
 {
+  if(filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".ktx") == 0) {
+    upload(ktx::File{filename}, wrap_mode);
+    return;
+  }
   lodepng::State state;
   std::vector<uint8_t> png;
    //load the image file with given filename
@@ -73,7 +90,7 @@ Tex::Tex(std::string const& filename, GLenum wrap_mode)
 	unsigned width;
 	unsigned height;
   std::vector<uint8_t> pixels; //the raw pixels
-  lodepng::decode(pixels, width, height, state, png);
+  error = lodepng::decode(pixels, width, height, state, png);
 	if(error) {
 		std::cerr << "LodePNG error - " << error << ": " << lodepng_error_text(error) << std::endl;
   	throw std::runtime_error("LodePNG error");
@@ -81,23 +98,77 @@ Tex::Tex(std::string const& filename, GLenum wrap_mode)
   // std::cout << "Color: " << colorTypeString(state.info_png.color.colortype) << ", " << state.info_png.color.bitdepth << " bit" << std::endl;
 	m_dimensions = glm::uvec2{width, height};
 	
-	// flip pixels for ogl lookup
+	// flip pixels for ogl lookup, rows are swapped in place
 	unsigned num_channels = 4;
-	std::vector<uint8_t> pixels_flipped(width * height * num_channels, 0);
-	for(unsigned y = 0; y < height; ++y) {
-		std::memcpy(pixels_flipped.data() + y * width * num_channels, pixels.data() + (height - y - 1)* width * num_channels, sizeof(uint8_t) * num_channels * width);
+	std::size_t row_size = std::size_t(width) * num_channels;
+	for(unsigned y = 0; y < height / 2; ++y) {
+		std::swap_ranges(pixels.begin() + y * row_size, pixels.begin() + (y + 1) * row_size, pixels.begin() + (height - y - 1) * row_size);
 	}
 
 	glGenTextures(1, &m_index);
-	glBindTexture(GL_TEXTURE_2D, m_index);
+	gl_state::bind_texture(GL_TEXTURE_2D, m_index);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels_flipped.data());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 	glGenerateMipmap(GL_TEXTURE_2D);
 }
 
+Tex::Tex(ktx::File const& file, GLenum wrap_mode)
+ :m_dimensions{}
+ ,m_index{0}
+{
+	upload(file, wrap_mode);
+}
+
+void Tex::upload(ktx::File const& file, GLenum wrap_mode) {
+	ktx::Header const& header = file.header();
+	std::vector<ktx::Level> const& levels = file.levels();
+	GLenum internal_format = static_cast<GLenum>(header.gl_internal_format);
+	m_dimensions = file.dimensions();
+
+	glGenTextures(1, &m_index);
+	gl_state::bind_texture(GL_TEXTURE_2D, m_index);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels.size() > 1 ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(levels.size() - 1));
+
+	// immutable storage lets the driver allocate the whole chain once
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool texture_storage = major > 4 || (major == 4 && minor >= 2);
+	if(texture_storage) {
+		glTexStorage2D(GL_TEXTURE_2D, GLsizei(levels.size()), internal_format, m_dimensions.x, m_dimensions.y);
+	}
+	// levels are read directly from the mapped file, rows are 4 byte aligned like the unpack default
+	for(std::size_t i = 0; i < levels.size(); ++i) {
+		ktx::Level const& level = levels[i];
+		GLint index = GLint(i);
+		if(file.compressed()) {
+			if(texture_storage) {
+				glCompressedTexSubImage2D(GL_TEXTURE_2D, index, 0, 0, level.dimensions.x, level.dimensions.y, internal_format, GLsizei(level.size), level.data);
+			}
+			else {
+				glCompressedTexImage2D(GL_TEXTURE_2D, index, internal_format, level.dimensions.x, level.dimensions.y, 0, GLsizei(level.size), level.data);
+			}
+		}
+		else {
+			GLenum format = static_cast<GLenum>(header.gl_format);
+			GLenum type = static_cast<GLenum>(header.gl_type);
+			if(texture_storage) {
+				glTexSubImage2D(GL_TEXTURE_2D, index, 0, 0, level.dimensions.x, level.dimensions.y, format, type, level.data);
+			}
+			else {
+				glTexImage2D(GL_TEXTURE_2D, index, internal_format, level.dimensions.x, level.dimensions.y, 0, format, type, level.data);
+			}
+		}
+	}
+}
+
 Tex::Tex(Tex&& rhs)
  :m_dimensions{}
  ,m_index{0}
@@ -118,12 +189,17 @@ void swap(Tex& lhs, Tex& rhs) {
 Tex::~Tex() {
 	// emplace_back will call move constructor, creating ungenerated texture
 	if (m_index != 0) {
+		gl_state::forget_texture(m_index);
 		glDeleteTextures(1, &m_index);
 	}
 }
 
 void Tex::bind() const {
-	glBindTexture(GL_TEXTURE_2D, m_index);
+	gl_state::bind_texture(GL_TEXTURE_2D, m_index);
+}
+
+void Tex::bind(GLuint unit) const {
+	gl_state::bind_texture(unit, GL_TEXTURE_2D, m_index);
 }
 
 glm::uvec2 const& Tex::dimensions() const {
@@ -174,6 +250,7 @@ static GLenum pixel_format(GLenum internal_format) {
 Fbo::Fbo() 
  :id{0}
  ,attachment_ids{}
+ ,draw_buffers_set{false}
 {
 	glGenFramebuffers(1, &id);
 }
@@ -185,6 +262,7 @@ Fbo::Fbo(Fbo&& rhs)
 }
 
 Fbo::~Fbo() {
+	gl_state::forget_framebuffer(id);
 	glDeleteFramebuffers(1, &id);
 }
 
@@ -196,19 +274,25 @@ Fbo& Fbo::operator=(Fbo&& rhs) {
 void swap(Fbo& lhs, Fbo& rhs) {
 	std::swap(lhs.id, rhs.id);
 	std::swap(lhs.attachment_ids, rhs.attachment_ids);
+	std::swap(lhs.draw_buffers_set, rhs.draw_buffers_set);
 }
 
 void Fbo::bind()const {
-	glBindFramebuffer(GL_FRAMEBUFFER, id);
+	gl_state::bind_framebuffer(GL_FRAMEBUFFER, id);
+	// draw buffers belong to the framebuffer, set once after the attachments changed
+	if (draw_buffers_set)
+		return;
 	if (!attachment_ids.empty())
 		glDrawBuffers((GLsizei)attachment_ids.size(), attachment_ids.data());
 	else
 		glDrawBuffer(GL_NONE);
+	draw_buffers_set = true;
 }
 
 void Fbo::addTextureAsColorbuffer(Tex const& img) {
 	GLenum new_id = GL_COLOR_ATTACHMENT0 + GLint(attachment_ids.size());
 	attachment_ids.emplace_back(new_id);
+	draw_buffers_set = false;
 	glFramebufferTexture2D(GL_FRAMEBUFFER, new_id, GL_TEXTURE_2D, img.index(), 0);
 }
 
@@ -217,7 +301,8 @@ void Fbo::addTextureAsDepthbuffer(Tex const& img) {
 }
 
 void Fbo::unbind() const {
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// return to window or headless target
+	gl_state::bind_framebuffer(GL_FRAMEBUFFER, window_handler::default_framebuffer());
 }
 
 void Fbo::check() const {
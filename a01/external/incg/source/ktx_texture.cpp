@@ -0,0 +1,227 @@
+#include "ktx_texture.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <glm/glm.hpp>
+
+namespace ktx
+{
+namespace
+{
+const unsigned char IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+const std::uint32_t ENDIANNESS     = 0x04030201;
+// s grows to the right, t upwards, matching gl texture coordinates
+const char ORIENTATION_KEY[]   = "KTXorientation";
+const char ORIENTATION_VALUE[] = "S=r,T=u";
+
+std::size_t padded(std::size_t size) { return (size + 3) & ~std::size_t(3); }
+
+// bytes of a 4x4 block of a compressed internal format, 0 if unknown
+std::size_t block_bytes(std::uint32_t internal_format)
+{
+    switch (internal_format)
+    {
+        // bc1 rgb and rgba, srgb variants, bc4
+        case 0x83F0:
+        case 0x83F1:
+        case 0x8C4C:
+        case 0x8C4D:
+        case 0x8DBB:
+        case 0x8DBC:
+            return 8;
+        // bc2, bc3, srgb variants, bc5, bc6h and bc7
+        case 0x83F2:
+        case 0x83F3:
+        case 0x8C4E:
+        case 0x8C4F:
+        case 0x8DBD:
+        case 0x8DBE:
+        case 0x8E8C:
+        case 0x8E8D:
+        case 0x8E8E:
+        case 0x8E8F:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+// components of an uncompressed pixel format, 0 if unknown
+std::size_t components(std::uint32_t format)
+{
+    switch (format)
+    {
+        // red, red integer
+        case 0x1903:
+        case 0x8D94:
+            return 1;
+        // rg, rg integer
+        case 0x8227:
+        case 0x8228:
+            return 2;
+        // rgb, bgr and their integer variants
+        case 0x1907:
+        case 0x80E0:
+        case 0x8D98:
+        case 0x8D9A:
+            return 3;
+        // rgba, bgra and their integer variants
+        case 0x1908:
+        case 0x80E1:
+        case 0x8D99:
+        case 0x8D9B:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+// packed types hold a whole pixel in one value of gl_type_size bytes
+bool packed(std::uint32_t type)
+{
+    switch (type)
+    {
+        // 4444, 5551, 565, 10f 11f 11f rev, 2 10 10 10 rev, 5999 rev
+        case 0x8033:
+        case 0x8034:
+        case 0x8363:
+        case 0x8C3B:
+        case 0x8368:
+        case 0x8C3E:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// bytes a level of the given dimensions occupies, rows of uncompressed levels are 4 byte
+// aligned, 0 if the format is not known
+std::size_t level_bytes(Header const& header, glm::uvec2 const& dimensions)
+{
+    if (header.gl_type == 0)
+    {
+        glm::uvec2 blocks = (dimensions + glm::uvec2{3}) / glm::uvec2{4};
+        return std::size_t(blocks.x) * blocks.y * block_bytes(header.gl_internal_format);
+    }
+    std::size_t pixel = packed(header.gl_type) ? header.gl_type_size
+                                               : components(header.gl_format) * header.gl_type_size;
+    return padded(std::size_t(dimensions.x) * pixel) * dimensions.y;
+}
+}  // namespace
+
+File::File(std::string const& path) : m_mapped{new MappedFile{path}}, m_header{}, m_levels{}
+{
+    char const* data = m_mapped->data();
+    std::size_t size = m_mapped->size();
+    if (size < sizeof(IDENTIFIER) + sizeof(Header) || std::memcmp(data, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+    {
+        throw std::runtime_error(path + ": not a ktx file");
+    }
+    std::memcpy(&m_header, data + sizeof(IDENTIFIER), sizeof(Header));
+    if (m_header.endianness != ENDIANNESS)
+    {
+        throw std::runtime_error(path + ": big endian ktx files are not supported");
+    }
+    if (m_header.pixel_width == 0 || m_header.pixel_height == 0 || m_header.pixel_depth > 1 ||
+        m_header.array_elements > 1 || m_header.faces != 1)
+    {
+        throw std::runtime_error(path + ": only single 2d ktx textures are supported");
+    }
+
+    glm::uvec2 dimensions = this->dimensions();
+    std::uint32_t count   = std::max(m_header.mip_levels, 1u);
+    std::size_t offset    = sizeof(IDENTIFIER) + sizeof(Header) + m_header.key_value_bytes;
+    for (std::uint32_t level = 0; level < count; ++level)
+    {
+        std::uint32_t image_size = 0;
+        if (offset + sizeof(image_size) > size)
+        {
+            throw std::runtime_error(path + ": ktx file truncated");
+        }
+        std::memcpy(&image_size, data + offset, sizeof(image_size));
+        offset += sizeof(image_size);
+        if (offset + image_size > size)
+        {
+            throw std::runtime_error(path + ": ktx file truncated");
+        }
+        // the upload reads as many bytes as the level's dimensions and format need
+        glm::uvec2 level_dimensions = glm::max(dimensions >> level, glm::uvec2{1});
+        std::size_t expected        = level_bytes(m_header, level_dimensions);
+        if (expected == 0)
+        {
+            throw std::runtime_error(path + ": unsupported ktx format");
+        }
+        if (image_size != expected)
+        {
+            throw std::runtime_error(path + ": ktx level " + std::to_string(level) + " has " +
+                                     std::to_string(image_size) + " bytes, expected " + std::to_string(expected));
+        }
+        m_levels.push_back(Level{data + offset, image_size, level_dimensions});
+        offset += padded(image_size);
+    }
+}
+
+Header header(std::uint32_t internal_format, std::uint32_t base_internal_format, glm::uvec2 const& dimensions,
+              std::uint32_t levels, std::uint32_t format, std::uint32_t type, std::uint32_t type_size)
+{
+    Header result{};
+    result.endianness              = ENDIANNESS;
+    result.gl_type                 = type;
+    result.gl_type_size            = type_size;
+    result.gl_format               = format;
+    result.gl_internal_format      = internal_format;
+    result.gl_base_internal_format = base_internal_format;
+    result.pixel_width             = dimensions.x;
+    result.pixel_height            = dimensions.y;
+    result.faces                   = 1;
+    result.mip_levels              = levels;
+    return result;
+}
+
+void write(std::string const& path, Header const& header, std::vector<std::vector<std::uint8_t>> const& levels)
+{
+    // one key value pair, size prefixed and padded to 4 bytes
+    std::string key_value{ORIENTATION_KEY, sizeof(ORIENTATION_KEY)};
+    key_value.append(ORIENTATION_VALUE, sizeof(ORIENTATION_VALUE));
+    std::uint32_t key_value_size = std::uint32_t(key_value.size());
+    key_value.resize(padded(key_value.size()), '\0');
+
+    Header file_header          = header;
+    file_header.mip_levels      = std::uint32_t(levels.size());
+    file_header.key_value_bytes = std::uint32_t(sizeof(key_value_size) + key_value.size());
+
+    // write aside and rename so readers never map a partial file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        char const padding[4] = {0, 0, 0, 0};
+        file.write(reinterpret_cast<char const*>(IDENTIFIER), sizeof(IDENTIFIER));
+        file.write(reinterpret_cast<char const*>(&file_header), sizeof(file_header));
+        file.write(reinterpret_cast<char const*>(&key_value_size), sizeof(key_value_size));
+        file.write(key_value.data(), std::streamsize(key_value.size()));
+        for (auto const& level : levels)
+        {
+            std::uint32_t image_size = std::uint32_t(level.size());
+            file.write(reinterpret_cast<char const*>(&image_size), sizeof(image_size));
+            file.write(reinterpret_cast<char const*>(level.data()), std::streamsize(level.size()));
+            file.write(padding, std::streamsize(padded(level.size()) - level.size()));
+        }
+        if (!file)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not write \'" + path + "\'");
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write \'" + path + "\'");
+    }
+}
+}  // namespace ktx
@@ -0,0 +1,70 @@
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string.h>
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::string const& path)
+    : m_path{path}, m_data{nullptr}, m_size{0}, m_mapped{false}, m_buffer{}
+{
+#ifndef _WIN32
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        std::cerr << "File \'" << path << "\' not found" << std::endl;
+        throw std::runtime_error(path + ", errno " + strerror(errno));
+    }
+    struct stat sb;
+    if (fstat(file, &sb) != 0)
+    {
+        close(file);
+        throw std::runtime_error(path + ", errno " + strerror(errno));
+    }
+    m_size = std::size_t(sb.st_size);
+    // zero length mappings are invalid
+    if (m_size > 0)
+    {
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED)
+        {
+            // chunks are parsed in parallel, so prefetch the whole range
+            madvise(mapping, m_size, MADV_WILLNEED);
+            m_data   = static_cast<char const*>(mapping);
+            m_mapped = true;
+        }
+    }
+    close(file);
+    if (m_mapped || m_size == 0)
+    {
+        return;
+    }
+#endif
+    std::ifstream file_stream{path, std::ios::binary | std::ios::ate};
+    if (!file_stream)
+    {
+        std::cerr << "File \'" << path << "\' not found" << std::endl;
+        throw std::runtime_error(path);
+    }
+    m_size = std::size_t(file_stream.tellg());
+    file_stream.seekg(0);
+    m_buffer.resize(m_size);
+    file_stream.read(m_buffer.data(), std::streamsize(m_size));
+    m_data = m_buffer.data();
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (m_mapped)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+}
@@ -0,0 +1,390 @@
+#include "mesh_simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mesh_simplify
+{
+namespace
+{
+// symmetric 4x4 matrix of the summed squared distances to the planes around a vertex
+struct Quadric
+{
+    double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+
+    void add(Quadric const& other)
+    {
+        xx += other.xx;
+        xy += other.xy;
+        xz += other.xz;
+        xw += other.xw;
+        yy += other.yy;
+        yz += other.yz;
+        yw += other.yw;
+        zz += other.zz;
+        zw += other.zw;
+        ww += other.ww;
+    }
+
+    // plane ax + by + cz + d = 0 with unit normal
+    void addPlane(double a, double b, double c, double d)
+    {
+        xx += a * a;
+        xy += a * b;
+        xz += a * c;
+        xw += a * d;
+        yy += b * b;
+        yz += b * c;
+        yw += b * d;
+        zz += c * c;
+        zw += c * d;
+        ww += d * d;
+    }
+
+    double evaluate(glm::vec3 const& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double error = xx * x * x + 2.0 * xy * x * y + 2.0 * xz * x * z + 2.0 * xw * x + yy * y * y +
+                       2.0 * yz * y * z + 2.0 * yw * y + zz * z * z + 2.0 * zw * z + ww;
+        return std::max(error, 0.0);
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    std::uint32_t from;
+    std::uint32_t to;
+};
+
+struct PositionHash
+{
+    std::size_t operator()(glm::vec3 const& p) const
+    {
+        std::uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return std::size_t(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+    }
+};
+
+// collapses edges of a shrinking index list, the state is kept between reduce calls so a chain of
+// levels is nested and its errors grow monotonically
+class Simplifier
+{
+   public:
+    Simplifier(std::vector<glm::vec3> const& positions, std::vector<std::uint32_t> const& indices)
+        : m_positions(positions),
+          m_indices(indices),
+          m_position_id(positions.size()),
+          m_quadrics{},
+          m_locked(positions.size(), 0),
+          m_scale{1.0},
+          m_error{0.0}
+    {
+        if (indices.size() % 3 != 0)
+        {
+            throw std::invalid_argument("mesh_simplify: index count is not a multiple of 3");
+        }
+        // vertices sharing a position differ in their normal, the seam between them is kept
+        std::unordered_map<glm::vec3, std::uint32_t, PositionHash> unique{};
+        unique.reserve(positions.size());
+        std::vector<std::uint32_t> users{};
+        for (std::size_t i = 0; i < positions.size(); ++i)
+        {
+            auto inserted     = unique.emplace(positions[i], std::uint32_t(unique.size()));
+            m_position_id[i]  = inserted.first->second;
+        }
+        users.assign(unique.size(), 0);
+        std::vector<std::uint8_t> used(positions.size(), 0);
+        for (std::uint32_t index : indices)
+        {
+            if (index >= positions.size())
+            {
+                throw std::invalid_argument("mesh_simplify: index out of range");
+            }
+            if (!used[index])
+            {
+                used[index] = 1;
+                ++users[m_position_id[index]];
+            }
+        }
+        for (std::size_t i = 0; i < positions.size(); ++i)
+        {
+            m_locked[i] = users[m_position_id[i]] > 1 ? 1 : 0;
+        }
+
+        // edges of only one triangle lie on an open border, which is kept as well
+        std::unordered_map<std::uint64_t, std::uint32_t> edges{};
+        edges.reserve(indices.size());
+        for (std::size_t t = 0; t < indices.size(); t += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint64_t a = m_position_id[indices[t + corner]];
+                std::uint64_t b = m_position_id[indices[t + (corner + 1) % 3]];
+                ++edges[std::min(a, b) << 32 | std::max(a, b)];
+            }
+        }
+        for (std::size_t t = 0; t < indices.size(); t += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint32_t a = indices[t + corner];
+                std::uint32_t b = indices[t + (corner + 1) % 3];
+                std::uint64_t pa = m_position_id[a];
+                std::uint64_t pb = m_position_id[b];
+                if (edges[std::min(pa, pb) << 32 | std::max(pa, pb)] == 1)
+                {
+                    m_locked[a] = 1;
+                    m_locked[b] = 1;
+                }
+            }
+        }
+
+        // errors are relative to the bounding radius so levels of differently sized meshes compare
+        Bounds const bounds = compute_bounds(positions);
+        m_scale             = bounds.radius > 0.0f ? 1.0 / double(bounds.radius) : 1.0;
+        m_quadrics.assign(unique.size(), Quadric{});
+        for (std::size_t t = 0; t < indices.size(); t += 3)
+        {
+            glm::dvec3 p0{positions[indices[t]]};
+            glm::dvec3 p1{positions[indices[t + 1]]};
+            glm::dvec3 p2{positions[indices[t + 2]]};
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double length     = glm::length(normal);
+            if (length == 0.0)
+            {
+                continue;
+            }
+            normal /= length;
+            Quadric plane{};
+            plane.addPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0));
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                m_quadrics[m_position_id[indices[t + corner]]].add(plane);
+            }
+        }
+    }
+
+    // indices after reducing to at most target_index_count, stops early at max_error
+    std::vector<std::uint32_t> const& reduce(std::size_t target_index_count, double max_error)
+    {
+        double const max_cost = max_error * max_error / (m_scale * m_scale);
+        while (m_indices.size() > target_index_count)
+        {
+            if (pass((m_indices.size() - target_index_count) / 3, max_cost) == 0)
+            {
+                break;
+            }
+        }
+        return m_indices;
+    }
+
+    float error() const { return float(std::sqrt(m_error) * m_scale); }
+
+   private:
+    // one round of collapses of disjoint edges, returns how many were applied
+    std::size_t pass(std::size_t excess_triangles, double max_cost)
+    {
+        std::size_t const vertex_count = m_positions.size();
+        // triangles around each vertex
+        std::vector<std::uint32_t> offsets(vertex_count + 1, 0);
+        for (std::uint32_t index : m_indices)
+        {
+            ++offsets[index + 1];
+        }
+        for (std::size_t i = 0; i < vertex_count; ++i)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+        std::vector<std::uint32_t> triangles(m_indices.size());
+        {
+            std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (std::size_t i = 0; i < m_indices.size(); ++i)
+            {
+                triangles[fill[m_indices[i]]++] = std::uint32_t(i / 3);
+            }
+        }
+
+        // each interior edge is listed once, by the triangle it runs forward in
+        std::vector<Collapse> collapses{};
+        collapses.reserve(m_indices.size() / 2);
+        for (std::size_t t = 0; t < m_indices.size(); t += 3)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                std::uint32_t a = m_indices[t + corner];
+                std::uint32_t b = m_indices[t + (corner + 1) % 3];
+                if (a > b || (m_locked[a] && m_locked[b]))
+                {
+                    continue;
+                }
+                Quadric q = m_quadrics[m_position_id[a]];
+                q.add(m_quadrics[m_position_id[b]]);
+                double to_b = m_locked[a] ? HUGE_VAL : q.evaluate(m_positions[b]);
+                double to_a = m_locked[b] ? HUGE_VAL : q.evaluate(m_positions[a]);
+                collapses.push_back(to_b <= to_a ? Collapse{to_b, a, b} : Collapse{to_a, b, a});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](Collapse const& lhs, Collapse const& rhs) { return lhs.cost < rhs.cost; });
+
+        // a collapse removes two triangles on a closed surface, collapses blocked by an earlier one
+        // of the pass are left for the next pass rather than replaced by more expensive ones
+        std::size_t const limit = std::max<std::size_t>(1, (excess_triangles + 1) / 2);
+        if (!collapses.empty())
+        {
+            max_cost = std::min(max_cost, collapses[std::min(limit, collapses.size()) - 1].cost);
+        }
+        std::vector<std::uint32_t> remap(vertex_count);
+        for (std::size_t i = 0; i < vertex_count; ++i)
+        {
+            remap[i] = std::uint32_t(i);
+        }
+        std::vector<std::uint8_t> touched(vertex_count, 0);
+        std::size_t applied = 0;
+        for (Collapse const& collapse : collapses)
+        {
+            if (applied == limit || collapse.cost > max_cost)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] ||
+                flips(collapse, remap, triangles.data() + offsets[collapse.from],
+                      offsets[collapse.from + 1] - offsets[collapse.from]))
+            {
+                continue;
+            }
+            remap[collapse.from] = collapse.to;
+            m_quadrics[m_position_id[collapse.to]].add(m_quadrics[m_position_id[collapse.from]]);
+            touched[collapse.from] = 1;
+            touched[collapse.to]   = 1;
+            m_error                = std::max(m_error, collapse.cost);
+            ++applied;
+        }
+
+        // drop the triangles that collapsed to a line
+        std::size_t kept = 0;
+        for (std::size_t t = 0; t < m_indices.size(); t += 3)
+        {
+            std::uint32_t a = remap[m_indices[t]];
+            std::uint32_t b = remap[m_indices[t + 1]];
+            std::uint32_t c = remap[m_indices[t + 2]];
+            if (a == b || b == c || c == a)
+            {
+                continue;
+            }
+            m_indices[kept++] = a;
+            m_indices[kept++] = b;
+            m_indices[kept++] = c;
+        }
+        m_indices.resize(kept);
+        return applied;
+    }
+
+    // whether moving collapse.from onto collapse.to turns one of its remaining triangles over
+    bool flips(Collapse const& collapse, std::vector<std::uint32_t> const& remap, std::uint32_t const* triangles,
+               std::size_t count) const
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            std::uint32_t const* corners = &m_indices[std::size_t(triangles[i]) * 3];
+            std::uint32_t v[3]           = {remap[corners[0]], remap[corners[1]], remap[corners[2]]};
+            if (v[0] == collapse.to || v[1] == collapse.to || v[2] == collapse.to)
+            {
+                continue;
+            }
+            glm::vec3 before[3], after[3];
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                before[corner] = m_positions[v[corner]];
+                after[corner]  = v[corner] == collapse.from ? m_positions[collapse.to] : before[corner];
+            }
+            glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(n0, n1) <= 0.0f)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<glm::vec3> const& m_positions;
+    std::vector<std::uint32_t> m_indices;
+    std::vector<std::uint32_t> m_position_id;
+    // indexed by position id so seam vertices share theirs
+    std::vector<Quadric> m_quadrics;
+    std::vector<std::uint8_t> m_locked;
+    double m_scale;
+    // largest squared distance of an applied collapse
+    double m_error;
+};
+}  // namespace
+
+std::vector<std::uint32_t> simplify(std::vector<glm::vec3> const& positions, std::vector<std::uint32_t> const& indices,
+                                    std::size_t target_index_count, float max_error, float* error)
+{
+    Simplifier simplifier{positions, indices};
+    std::vector<std::uint32_t> result = simplifier.reduce(target_index_count, max_error);
+    if (error)
+    {
+        *error = simplifier.error();
+    }
+    return result;
+}
+
+std::vector<std::uint32_t> build_lods(std::vector<glm::vec3> const& positions, std::vector<std::uint32_t> const& indices,
+                                      std::vector<Lod>& lods, std::size_t max_lods, std::size_t min_triangles)
+{
+    lods.assign(1, Lod{0, std::uint32_t(indices.size()), 0.0f, 0});
+    std::vector<std::uint32_t> result{indices};
+    if (indices.size() / 3 < min_triangles * 2 || max_lods < 2)
+    {
+        return result;
+    }
+    Simplifier simplifier{positions, indices};
+    std::size_t previous = indices.size();
+    while (lods.size() < max_lods)
+    {
+        std::size_t const target = previous / 6 * 3;
+        if (target / 3 < min_triangles)
+        {
+            break;
+        }
+        std::vector<std::uint32_t> const& level = simplifier.reduce(target, 1.0);
+        // locked borders and seams stop the reduction, a barely smaller level is not worth a draw
+        if (level.size() > previous * 3 / 4)
+        {
+            break;
+        }
+        lods.push_back(Lod{std::uint32_t(result.size()), std::uint32_t(level.size()), simplifier.error(), 0});
+        result.insert(result.end(), level.begin(), level.end());
+        previous = level.size();
+    }
+    return result;
+}
+
+std::size_t select_lod(std::vector<Lod> const& lods, Bounds const& world, glm::fmat4 const& view,
+                       glm::fmat4 const& projection, float viewport_height, float pixel_error)
+{
+    float const distance = glm::length(glm::fvec3{view * glm::fvec4{world.center, 1.0f}}) - world.radius;
+    if (lods.size() < 2 || distance <= 0.0f)
+    {
+        return 0;
+    }
+    // radius of the bounding sphere on screen, projection[1][1] is the cotangent of half the fov
+    float const radius_pixels = world.radius * projection[1][1] * 0.5f * viewport_height / distance;
+    for (std::size_t level = lods.size() - 1; level > 0; --level)
+    {
+        if (lods[level].error * radius_pixels <= pixel_error)
+        {
+            return level;
+        }
+    }
+    return 0;
+}
+}  // namespace mesh_simplify
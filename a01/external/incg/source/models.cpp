@@ -14,6 +14,8 @@ using namespace gl;
 
 #include "models.hpp"
 
+#include "gl_state.hpp"
+
 // screen space quad
 simpleQuad::simpleQuad()
     : indices{0, 1, 3, 1, 2, 3}, vertices{glm::vec3(-1, -1, 0),
@@ -23,7 +25,7 @@ simpleQuad::simpleQuad()
       vbo{0, 0} {
 
   glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
+  gl_state::bind_vertex_array(vao);
 
   glEnableVertexAttribArray(0);
   // ==
@@ -41,9 +43,8 @@ simpleQuad::simpleQuad()
 
 void simpleQuad::draw() const {
 
-  glBindVertexArray(vao);
+  gl_state::bind_vertex_array(vao);
   glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
 }
 
 simpleQuad::~simpleQuad() { glDeleteBuffers(2, vbo); }
@@ -52,7 +53,7 @@ simpleQuad::~simpleQuad() { glDeleteBuffers(2, vbo); }
 simplePoint::simplePoint() : vertex{0, 0, 0}, vbo{0} {
 
   glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
+  gl_state::bind_vertex_array(vao);
 
   glGenBuffers(1, &vbo);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -63,115 +64,63 @@ simplePoint::simplePoint() : vertex{0, 0, 0}, vbo{0} {
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, 0);
 
 
-  glBindVertexArray(0);
+  gl_state::bind_vertex_array(0);
 }
 
 void simplePoint::draw() const {
-  glBindVertexArray(vao);
+  gl_state::bind_vertex_array(vao);
   glDrawArrays(GL_POINTS, 0, 1);
-  glBindVertexArray(0);
 }
 
 simplePoint::~simplePoint() { glDeleteBuffers(1, &vbo); }
 
-simpleModel::simpleModel() : indices{}, vertices{}, normals{} {}
-
-simpleModel::simpleModel(std::string const &filename) : simpleModel{} {
-  std::vector<glm::vec3> normals_tmp;
-  std::vector<uint32_t> nIndices;
+fullscreenTriangle::fullscreenTriangle() { glGenVertexArrays(1, &vao); }
 
-  FILE *file = fopen(filename.c_str(), "r");
-  if (file == NULL) {
-    std::cerr << "Model file not found: " << filename << std::endl;
-    exit(0);
-  }
-
-  while (1) {
-    char lineHeader[128];
-    int res = fscanf(file, "%s", lineHeader);
-    if (res == EOF)
-      break;
-
-    if (strcmp(lineHeader, "v") == 0) {
-      glm::vec3 vertex;
-      fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-      vertices.push_back(vertex);
-    } else if (strcmp(lineHeader, "vn") == 0) {
-      glm::vec3 normal;
-      fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-      normals_tmp.push_back(normal);
-    } else if (strcmp(lineHeader, "f") == 0) {
-      unsigned vIndex[3], nIndex[3];
-      int matches =
-          fscanf(file, "%u//%u %u//%u %u//%u\n", &vIndex[0], &nIndex[0],
-                 &vIndex[1], &nIndex[1], &vIndex[2], &nIndex[2]);
-      if (matches < 6) {
-        std::cerr << "Information missin in obj file. " << matches << ", "
-                  << lineHeader << std::endl;
-        exit(0);
-      }
-
-      for (int i = 0; i < 3; ++i) {
-        indices.push_back(vIndex[i] - 1);
-        nIndices.push_back(nIndex[i] - 1);
-      }
-    }
-  }
-
-  std::vector<glm::vec3> extra_verts;
-  std::vector<glm::vec3> extra_norms;
-  std::map<std::pair<int, int>, int> mapping;
-
-  normals.resize(vertices.size());
-  std::vector<bool> tested(vertices.size(), false);
-
-  for (size_t i = 0; i < indices.size(); ++i) {
-    int vIdx = indices[i];
-    int nIdx = nIndices[i];
-
-    if (tested[vIdx] && vIdx != nIdx) {
-      auto it = mapping.find(std::pair<int, int>(vIdx, nIdx));
-      if (it != mapping.end())
-        indices[i] = uint32_t(vertices.size() + it->second - 1);
-      else {
-        extra_verts.push_back(vertices[indices[i]]);
-        extra_norms.push_back(normals_tmp[nIndices[i]]);
-        indices[i] = uint32_t(vertices.size() + extra_verts.size() - 1);
-        mapping[std::pair<int, int>(vIdx, nIdx)] = (int)extra_verts.size();
-      }
-    } else {
-      normals[indices[i]] = normals_tmp[nIndices[i]];
-      tested[indices[i]] = true;
-    }
-  }
-
-  for (auto it = tested.begin(); it != tested.end(); ++it)
-    if (*it != true)
-      std::cout << "probs" << std::endl;
-
-  vertices.insert(vertices.end(), extra_verts.begin(), extra_verts.end());
-  normals.insert(normals.end(), extra_norms.begin(), extra_norms.end());
-
-  mapping.clear();
-  extra_verts.clear();
-  extra_norms.clear();
-  nIndices.clear();
-  normals_tmp.clear();
+fullscreenTriangle::~fullscreenTriangle() {
+  gl_state::forget_vertex_array(vao);
+  glDeleteVertexArrays(1, &vao);
+}
 
-  if (vertices.size() != normals.size()) {
-    std::cerr << "Object data (vertices/normals) inconsitent." << std::endl;
-    exit(0);
-  }
+void fullscreenTriangle::draw() const {
+  gl_state::bind_vertex_array(vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+}
 
+simpleModel::simpleModel(MeshArena *arena)
+    : indices{}, lods{}, vertices{}, normals{}, arena{arena} {}
+
+simpleModel::simpleModel(std::string const &filename, MeshArena *arena)
+    : simpleModel{arena} {
+  // throws obj_loader::ParseError on malformed files
+  mesh_cache::File mesh = mesh_cache::load(filename);
+  // arena and shaders only take float or half normals
+  if (arena || mesh.header().normal_encoding == mesh_cache::NORMAL_OCTAHEDRAL) {
+    mesh.unpack(vertices, normals, indices);
+    lods = mesh.lods();
     upload();
+    return;
+  }
+  upload(mesh);
 }
 
-simpleModel::~simpleModel() { glDeleteBuffers(3, vbo); }
+simpleModel::~simpleModel() {
+  glDeleteBuffers(3, vbo);
+  gl_state::forget_vertex_array(vao);
+  glDeleteVertexArrays(1, &vao);
+}
 
 void simpleModel::upload() {
+  bounding = compute_bounds(vertices);
+  if (lods.empty())
+    indices = mesh_simplify::build_lods(vertices, indices, lods);
+  if (arena) {
+    range = arena->add(vertices, normals, indices);
+    range.indexCount = lods[0].index_count;
+    return;
+  }
   assert(vao == 0);
   glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
+  gl_state::bind_vertex_array(vao);
 
   glGenBuffers(3, vbo);
 
@@ -194,22 +143,71 @@ void simpleModel::upload() {
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
                indices.data(), GL_STATIC_DRAW);
 
+  gl_state::bind_vertex_array(0);
+}
 
+void simpleModel::upload(mesh_cache::File const &mesh) {
+  assert(vao == 0 && !arena);
+  mesh_cache::Header const &header = mesh.header();
+  // positions lead each interleaved vertex
+  bounding = compute_bounds(mesh.vertices(), header.vertex_count,
+                            header.vertex_stride);
+  glGenVertexArrays(1, &vao);
+  gl_state::bind_vertex_array(vao);
 
+  glGenBuffers(1, vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+  glBufferData(GL_ARRAY_BUFFER, mesh.payloadSize(), mesh.payload(),
+               GL_STATIC_DRAW);
 
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, header.vertex_stride, 0);
+  glVertexAttribPointer(1, 3,
+                        header.normal_encoding == mesh_cache::NORMAL_HALF
+                            ? GL_HALF_FLOAT
+                            : GL_FLOAT,
+                        GL_FALSE, header.vertex_stride,
+                        (void *)sizeof(glm::vec3));
+
+  // the index range follows the vertices in the same buffer
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[0]);
+  lods = mesh.lods();
+  index_type =
+      header.index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  index_offset = mesh.indexOffset();
+
+  gl_state::bind_vertex_array(0);
+}
 
+void simpleModel::draw(size_t lod) const {
+  if (arena) {
+    arena->draw(mesh(lod));
+    return;
+  }
+  size_t index_size = index_type == GL_UNSIGNED_SHORT ? 2 : 4;
+  gl_state::bind_vertex_array(vao);
+  glDrawElements(GL_TRIANGLES, (GLsizei)lods[lod].index_count, index_type,
+                 (void *)(index_offset + lods[lod].first_index * index_size));
+}
 
-  glBindVertexArray(0);
+MeshRange simpleModel::mesh(size_t lod) const {
+  MeshRange level = range;
+  level.firstIndex += lods[lod].first_index;
+  level.indexCount = lods[lod].index_count;
+  return level;
 }
 
-void simpleModel::draw() const {
-  glBindVertexArray(vao);
-  glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-   glBindVertexArray(0);
+size_t simpleModel::selectLod(Bounds const &world, glm::fmat4 const &view,
+                              glm::fmat4 const &projection,
+                              float viewport_height, float pixel_error) const {
+  return mesh_simplify::select_lod(lods, world, view, projection,
+                                   viewport_height, pixel_error);
 }
 
-groundPlane::groundPlane(const float height, const float width)
-    : simpleModel{} {
+groundPlane::groundPlane(const float height, const float width,
+                         MeshArena *arena)
+    : simpleModel{arena} {
   vertices = std::vector<glm::vec3>(4);
   vertices = {glm::vec3(-width, height, -width),
               glm::vec3(-width, height, width), glm::vec3(width, height, width),
@@ -224,7 +222,8 @@ groundPlane::groundPlane(const float height, const float width)
 }
 
 groundPlane::groundPlane(const float height, const float width,
-                         const unsigned int resolution) {
+                         const unsigned int resolution, MeshArena *arena)
+    : simpleModel{arena} {
   const float step = 2.f * width / resolution;
 
   vertices = std::vector<glm::fvec3>();
@@ -402,9 +401,10 @@ solidSphere::solidSphere(const float r, const int slices, const int stacks)
 solidSphere::~solidSphere() { glDeleteBuffers(3, vbo); }
 
 void solidSphere::upload() {
+  bounding = compute_bounds(vertices);
   assert(vao == 0);
   glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
+  gl_state::bind_vertex_array(vao);
 
   glEnableVertexAttribArray(0);
   glEnableVertexAttribArray(1);
@@ -425,11 +425,10 @@ void solidSphere::upload() {
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
                indices.data(), GL_STATIC_DRAW);
 
-  glBindVertexArray(0);
+  gl_state::bind_vertex_array(0);
 }
 
 void solidSphere::draw() const {
-  glBindVertexArray(vao);
+  gl_state::bind_vertex_array(vao);
   glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
 }
@@ -0,0 +1,593 @@
+#include "obj_loader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+#include "mapped_file.hpp"
+
+namespace obj_loader
+{
+ParseError::ParseError(std::string const& name, std::size_t line, std::string const& message)
+    : std::runtime_error{name + ":" + std::to_string(line) + ": " + message}, m_line{line}
+{
+}
+}  // namespace obj_loader
+
+// hidden helper functions
+namespace
+{
+// chunks smaller than this are not worth a thread
+const std::size_t MIN_CHUNK_SIZE = 1 << 20;
+
+enum LineType
+{
+    LINE_OTHER,
+    LINE_POSITION,
+    LINE_TEXCOORD,
+    LINE_NORMAL,
+    LINE_FACE,
+};
+
+// number of elements in a chunk, also used as global offsets of a chunk
+struct Counts
+{
+    std::size_t lines     = 0;
+    std::size_t positions = 0;
+    std::size_t texcoords = 0;
+    std::size_t normals   = 0;
+    std::size_t triangles = 0;
+};
+
+// face corner with resolved zero based indices, -1 if not given
+struct Corner
+{
+    int64_t v;
+    int64_t vt;
+    int64_t vn;
+};
+
+struct Chunk
+{
+    char const* begin;
+    char const* end;
+    Counts counts;
+    Counts offset;
+    std::vector<Corner> corners;
+    std::exception_ptr error;
+};
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline char const* skip_space(char const* p, char const* end)
+{
+    while (p < end && is_space(*p))
+    {
+        ++p;
+    }
+    return p;
+}
+
+inline char const* next_line(char const* p, char const* end)
+{
+    char const* newline = static_cast<char const*>(memchr(p, '\n', std::size_t(end - p)));
+    return newline ? newline + 1 : end;
+}
+
+// classify line and advance behind its keyword
+inline LineType line_type(char const*& p, char const* end)
+{
+    p = skip_space(p, end);
+    if (end - p < 2)
+    {
+        return LINE_OTHER;
+    }
+    if (p[0] == 'v')
+    {
+        if (is_space(p[1]))
+        {
+            p += 1;
+            return LINE_POSITION;
+        }
+        if (end - p > 2 && is_space(p[2]))
+        {
+            p += 2;
+            return p[-1] == 't' ? LINE_TEXCOORD : p[-1] == 'n' ? LINE_NORMAL : LINE_OTHER;
+        }
+    }
+    else if (p[0] == 'f' && is_space(p[1]))
+    {
+        p += 1;
+        return LINE_FACE;
+    }
+    return LINE_OTHER;
+}
+
+// decimal float without locale and without copying the token
+bool parse_float(char const*& p, char const* end, float& value)
+{
+    static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    p             = skip_space(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int exponent      = 0;
+    int digits        = 0;
+    bool any          = false;
+    for (; p < end && is_digit(*p); ++p)
+    {
+        any = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+            digits += mantissa > 0 ? 1 : 0;
+        }
+        else
+        {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && is_digit(*p); ++p)
+        {
+            any = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + uint64_t(*p - '0');
+                digits += mantissa > 0 ? 1 : 0;
+                --exponent;
+            }
+        }
+    }
+    if (!any)
+    {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+        bool negative_exponent = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative_exponent = *p == '-';
+            ++p;
+        }
+        int e = 0;
+        for (; p < end && is_digit(*p); ++p)
+        {
+            e = std::min(e * 10 + (*p - '0'), 10000);
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+
+    double result = double(mantissa);
+    if (exponent < 0)
+    {
+        result = exponent >= -22 ? result / powers[-exponent] : result * std::pow(10.0, exponent);
+    }
+    else if (exponent > 0)
+    {
+        result = exponent <= 22 ? result * powers[exponent] : result * std::pow(10.0, exponent);
+    }
+    value = float(negative ? -result : result);
+    return true;
+}
+
+bool parse_int(char const*& p, char const* end, int64_t& value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p == end || !is_digit(*p))
+    {
+        return false;
+    }
+    int64_t result = 0;
+    for (; p < end && is_digit(*p); ++p)
+    {
+        result = result * 10 + (*p - '0');
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+// count lines and elements so output storage can be reserved up front
+void prescan(Chunk& chunk)
+{
+    Counts& counts = chunk.counts;
+    for (char const* line = chunk.begin; line < chunk.end;)
+    {
+        char const* p         = line;
+        char const* line_end  = next_line(line, chunk.end);
+        ++counts.lines;
+        switch (line_type(p, line_end))
+        {
+            case LINE_POSITION:
+                ++counts.positions;
+                break;
+            case LINE_TEXCOORD:
+                ++counts.texcoords;
+                break;
+            case LINE_NORMAL:
+                ++counts.normals;
+                break;
+            case LINE_FACE:
+            {
+                std::size_t corners = 0;
+                while (true)
+                {
+                    p = skip_space(p, line_end);
+                    if (p == line_end || *p == '\n' || *p == '#')
+                    {
+                        break;
+                    }
+                    ++corners;
+                    while (p < line_end && !is_space(*p) && *p != '\n')
+                    {
+                        ++p;
+                    }
+                }
+                counts.triangles += corners > 2 ? corners - 2 : 0;
+                break;
+            }
+            default:
+                break;
+        }
+        line = line_end;
+    }
+}
+
+// turn 1-based or negative relative index into a zero based one
+int64_t resolve(int64_t index, std::size_t count)
+{
+    return index > 0 ? index - 1 : int64_t(count) + index;
+}
+
+void parse_chunk(Chunk& chunk, std::string const& name, Counts const& total, std::vector<glm::vec3>& positions,
+                 std::vector<glm::vec2>& texcoords, std::vector<glm::vec3>& normals)
+{
+    std::size_t line_number = chunk.offset.lines;
+    std::size_t position    = chunk.offset.positions;
+    std::size_t texcoord    = chunk.offset.texcoords;
+    std::size_t normal      = chunk.offset.normals;
+    chunk.corners.reserve(chunk.counts.triangles * 3);
+    std::vector<Corner> polygon{};
+
+    for (char const* line = chunk.begin; line < chunk.end;)
+    {
+        char const* p        = line;
+        char const* line_end = next_line(line, chunk.end);
+        ++line_number;
+        switch (line_type(p, line_end))
+        {
+            case LINE_POSITION:
+            {
+                glm::vec3& v = positions[position++];
+                if (!parse_float(p, line_end, v.x) || !parse_float(p, line_end, v.y) ||
+                    !parse_float(p, line_end, v.z))
+                {
+                    throw obj_loader::ParseError{name, line_number, "expected 3 position coordinates"};
+                }
+                break;
+            }
+            case LINE_TEXCOORD:
+            {
+                glm::vec2& vt = texcoords[texcoord++];
+                if (!parse_float(p, line_end, vt.x))
+                {
+                    throw obj_loader::ParseError{name, line_number, "expected texture coordinate"};
+                }
+                // v is optional
+                if (!parse_float(p, line_end, vt.y))
+                {
+                    vt.y = 0.0f;
+                }
+                break;
+            }
+            case LINE_NORMAL:
+            {
+                glm::vec3& vn = normals[normal++];
+                if (!parse_float(p, line_end, vn.x) || !parse_float(p, line_end, vn.y) ||
+                    !parse_float(p, line_end, vn.z))
+                {
+                    throw obj_loader::ParseError{name, line_number, "expected 3 normal coordinates"};
+                }
+                break;
+            }
+            case LINE_FACE:
+            {
+                polygon.clear();
+                while (true)
+                {
+                    p = skip_space(p, line_end);
+                    if (p == line_end || *p == '\n' || *p == '#')
+                    {
+                        break;
+                    }
+                    Corner corner{-1, -1, -1};
+                    int64_t index = 0;
+                    if (!parse_int(p, line_end, index) || index == 0)
+                    {
+                        throw obj_loader::ParseError{name, line_number, "invalid vertex index"};
+                    }
+                    corner.v = resolve(index, position);
+                    if (p < line_end && *p == '/')
+                    {
+                        ++p;
+                        if (p < line_end && *p != '/')
+                        {
+                            if (!parse_int(p, line_end, index) || index == 0)
+                            {
+                                throw obj_loader::ParseError{name, line_number, "invalid texture coordinate index"};
+                            }
+                            corner.vt = resolve(index, texcoord);
+                        }
+                        if (p < line_end && *p == '/')
+                        {
+                            ++p;
+                            if (!parse_int(p, line_end, index) || index == 0)
+                            {
+                                throw obj_loader::ParseError{name, line_number, "invalid normal index"};
+                            }
+                            corner.vn = resolve(index, normal);
+                        }
+                    }
+                    if (p < line_end && !is_space(*p) && *p != '\n')
+                    {
+                        throw obj_loader::ParseError{name, line_number, "unexpected character in face"};
+                    }
+                    if (corner.v < 0 || corner.vt < -1 || corner.vn < -1)
+                    {
+                        throw obj_loader::ParseError{name, line_number, "relative index before first element"};
+                    }
+                    // forward references are allowed, totals are known from the prescan
+                    if (corner.v >= int64_t(total.positions) || corner.vt >= int64_t(total.texcoords) ||
+                        corner.vn >= int64_t(total.normals))
+                    {
+                        throw obj_loader::ParseError{name, line_number, "index out of range"};
+                    }
+                    polygon.push_back(corner);
+                }
+                if (polygon.size() < 3)
+                {
+                    throw obj_loader::ParseError{name, line_number, "face with less than 3 vertices"};
+                }
+                // fan triangulation, exact for the convex polygons obj exporters write
+                for (std::size_t i = 1; i + 1 < polygon.size(); ++i)
+                {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i]);
+                    chunk.corners.push_back(polygon[i + 1]);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        line = line_end;
+    }
+}
+
+// run task for every index, one thread each
+template <typename F>
+void parallel_for(std::size_t count, F const& task)
+{
+    std::vector<std::thread> threads{};
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        threads.emplace_back(task, i);
+    }
+    if (count > 0)
+    {
+        task(0);
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+struct CornerHash
+{
+    std::size_t operator()(Corner const& c) const
+    {
+        uint64_t h = uint64_t(c.v) * 0x9E3779B97F4A7C15ull;
+        h ^= uint64_t(c.vt + 1) * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+        h ^= uint64_t(c.vn + 1) * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+        return std::size_t(h);
+    }
+};
+
+struct CornerEqual
+{
+    bool operator()(Corner const& a, Corner const& b) const { return a.v == b.v && a.vt == b.vt && a.vn == b.vn; }
+};
+}  // namespace
+
+namespace obj_loader
+{
+Mesh parse(char const* data, std::size_t size, std::string const& name, unsigned threads)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // split into line aligned chunks
+    std::size_t chunk_count = std::max<std::size_t>(1, std::min<std::size_t>(threads, size / MIN_CHUNK_SIZE));
+    std::vector<Chunk> chunks(chunk_count);
+    char const* end   = data + size;
+    char const* begin = data;
+    for (std::size_t i = 0; i < chunk_count; ++i)
+    {
+        char const* chunk_end = i + 1 == chunk_count ? end : std::min(end, data + size * (i + 1) / chunk_count);
+        if (chunk_end < end && chunk_end > begin)
+        {
+            chunk_end = next_line(chunk_end - 1, end);
+        }
+        chunk_end       = std::max(chunk_end, begin);
+        chunks[i].begin = begin;
+        chunks[i].end   = chunk_end;
+        begin           = chunk_end;
+    }
+
+    parallel_for(chunk_count, [&](std::size_t i) { prescan(chunks[i]); });
+
+    // prefix sums give every chunk the global index of its first element
+    Counts total{};
+    for (auto& chunk : chunks)
+    {
+        chunk.offset = total;
+        total.lines += chunk.counts.lines;
+        total.positions += chunk.counts.positions;
+        total.texcoords += chunk.counts.texcoords;
+        total.normals += chunk.counts.normals;
+        total.triangles += chunk.counts.triangles;
+    }
+
+    std::vector<glm::vec3> positions(total.positions);
+    std::vector<glm::vec2> texcoords(total.texcoords);
+    std::vector<glm::vec3> normals(total.normals);
+    parallel_for(chunk_count, [&](std::size_t i) {
+        try
+        {
+            parse_chunk(chunks[i], name, total, positions, texcoords, normals);
+        }
+        catch (...)
+        {
+            chunks[i].error = std::current_exception();
+        }
+    });
+    // report the first error in file order
+    for (auto const& chunk : chunks)
+    {
+        if (chunk.error)
+        {
+            std::rethrow_exception(chunk.error);
+        }
+    }
+
+    bool has_texcoords = false;
+    bool identity      = true;
+    for (auto const& chunk : chunks)
+    {
+        for (auto const& corner : chunk.corners)
+        {
+            has_texcoords |= corner.vt >= 0;
+            identity &= corner.vt < 0 && (corner.vn < 0 || corner.vn == corner.v);
+        }
+    }
+
+    Mesh mesh{};
+    mesh.indices.reserve(total.triangles * 3);
+    std::vector<bool> has_normal{};
+    if (identity)
+    {
+        // common case, vertices map one to one to positions
+        mesh.normals.resize(positions.size());
+        has_normal.resize(positions.size(), false);
+        for (auto const& chunk : chunks)
+        {
+            for (auto const& corner : chunk.corners)
+            {
+                mesh.indices.push_back(uint32_t(corner.v));
+                if (corner.vn >= 0 && !has_normal[std::size_t(corner.v)])
+                {
+                    mesh.normals[std::size_t(corner.v)] = normals[std::size_t(corner.vn)];
+                    has_normal[std::size_t(corner.v)]   = true;
+                }
+            }
+        }
+        mesh.positions = std::move(positions);
+    }
+    else
+    {
+        // split vertices with differing attribute combinations
+        std::unordered_map<Corner, uint32_t, CornerHash, CornerEqual> unique{};
+        unique.reserve(total.triangles * 2);
+        for (auto const& chunk : chunks)
+        {
+            for (auto const& corner : chunk.corners)
+            {
+                auto inserted = unique.emplace(corner, uint32_t(mesh.positions.size()));
+                if (inserted.second)
+                {
+                    mesh.positions.push_back(positions[std::size_t(corner.v)]);
+                    mesh.normals.push_back(corner.vn >= 0 ? normals[std::size_t(corner.vn)] : glm::vec3(0.0f));
+                    has_normal.push_back(corner.vn >= 0);
+                    if (has_texcoords)
+                    {
+                        mesh.texcoords.push_back(corner.vt >= 0 ? texcoords[std::size_t(corner.vt)]
+                                                                : glm::vec2(0.0f));
+                    }
+                }
+                mesh.indices.push_back(inserted.first->second);
+            }
+        }
+    }
+
+    // area weighted face normals for vertices the file gives none
+    if (std::find(has_normal.begin(), has_normal.end(), false) != has_normal.end())
+    {
+        for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            uint32_t a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+            glm::vec3 face =
+                glm::cross(mesh.positions[b] - mesh.positions[a], mesh.positions[c] - mesh.positions[a]);
+            for (uint32_t index : {a, b, c})
+            {
+                if (!has_normal[index])
+                {
+                    mesh.normals[index] += face;
+                }
+            }
+        }
+        for (std::size_t i = 0; i < mesh.normals.size(); ++i)
+        {
+            if (!has_normal[i])
+            {
+                float length    = glm::length(mesh.normals[i]);
+                mesh.normals[i] = length > 0.0f ? mesh.normals[i] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            }
+        }
+    }
+    return mesh;
+}
+
+Mesh load(std::string const& path, unsigned threads)
+{
+    MappedFile file{path};
+    try
+    {
+        return parse(file.data(), file.size(), path, threads);
+    }
+    catch (ParseError const& error)
+    {
+        std::cerr << "Model file invalid: " << error.what() << std::endl;
+        throw;
+    }
+}
+}  // namespace obj_loader
@@ -0,0 +1,302 @@
+#include "profiler.hpp"
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+Profiler::Profiler(unsigned frames_in_flight, std::size_t history_size)
+    : m_slots(std::max(2u, frames_in_flight)),
+      m_current{0},
+      m_frame_index{0},
+      m_dropped{0},
+      m_open{},
+      m_history{},
+      m_history_size{history_size},
+      m_resolved{},
+      m_latest{},
+      m_cpu_epoch{std::chrono::steady_clock::now()},
+      m_gpu_epoch{0}
+{
+    // align gpu timestamps with the cpu clock for the trace view
+    glGetInteger64v(GL_TIMESTAMP, &m_gpu_epoch);
+}
+
+Profiler::~Profiler()
+{
+    for (auto& slot : m_slots)
+    {
+        if (!slot.queries.empty())
+        {
+            glDeleteQueries(GLsizei(slot.queries.size()), slot.queries.data());
+        }
+    }
+}
+
+double Profiler::cpuNow() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_cpu_epoch).count();
+}
+
+GLuint Profiler::timestamp(Slot& slot, std::size_t index)
+{
+    // grow query set when a frame has more markers than before
+    if (index >= slot.queries.size())
+    {
+        std::size_t old_size = slot.queries.size();
+        slot.queries.resize(std::max(index + 1, old_size * 2));
+        glGenQueries(GLsizei(slot.queries.size() - old_size), slot.queries.data() + old_size);
+    }
+    glQueryCounter(slot.queries[index], GL_TIMESTAMP);
+    return slot.queries[index];
+}
+
+bool Profiler::tryResolve(Slot& slot, bool wait)
+{
+    if (!slot.pending)
+    {
+        return false;
+    }
+    // root marker ends last, its query being available implies all others are
+    if (!wait)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < slot.frame.markers.size(); ++i)
+    {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[2 * i], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+        auto& marker     = slot.frame.markers[i];
+        marker.gpu_begin = double(GLint64(begin) - m_gpu_epoch) / 1000000.0;
+        marker.gpu_end   = double(GLint64(end) - m_gpu_epoch) / 1000000.0;
+    }
+    slot.pending = false;
+
+    m_latest = slot.frame;
+    m_resolved.push_back(slot.frame);
+    m_history.push_back(std::move(slot.frame));
+    while (m_history.size() > m_history_size)
+    {
+        m_history.pop_front();
+    }
+    return true;
+}
+
+void Profiler::beginFrame()
+{
+    if (!m_open.empty())
+    {
+        throw std::logic_error("Profiler: frame started with open markers");
+    }
+    // collect finished frames, oldest first
+    for (std::size_t i = 1; i <= m_slots.size(); ++i)
+    {
+        tryResolve(m_slots[(m_current + i) % m_slots.size()], false);
+    }
+
+    m_current  = (m_current + 1) % m_slots.size();
+    Slot& slot = m_slots[m_current];
+    if (slot.pending)
+    {
+        // gpu is more than the ring behind, drop results instead of waiting for them
+        glDeleteQueries(GLsizei(slot.queries.size()), slot.queries.data());
+        slot.queries.clear();
+        slot.pending = false;
+        ++m_dropped;
+    }
+    slot.frame.index = m_frame_index++;
+    slot.frame.markers.clear();
+
+    push("frame");
+}
+
+void Profiler::endFrame()
+{
+    pop();
+    if (!m_open.empty())
+    {
+        throw std::logic_error("Profiler: frame ended with open markers");
+    }
+    m_slots[m_current].pending = true;
+}
+
+void Profiler::push(char const* name)
+{
+    Slot& slot        = m_slots[m_current];
+    std::size_t index = slot.frame.markers.size();
+    slot.frame.markers.push_back(ProfileMarker{name, int(m_open.size()), cpuNow(), 0.0, 0.0, 0.0});
+    timestamp(slot, 2 * index);
+    m_open.push_back(index);
+}
+
+void Profiler::pop()
+{
+    if (m_open.empty())
+    {
+        throw std::logic_error("Profiler: pop without matching push");
+    }
+    Slot& slot = m_slots[m_current];
+    std::size_t index = m_open.back();
+    m_open.pop_back();
+    timestamp(slot, 2 * index + 1);
+    slot.frame.markers[index].cpu_end = cpuNow();
+}
+
+std::vector<FrameProfile> Profiler::takeResolved()
+{
+    std::vector<FrameProfile> resolved{};
+    std::swap(resolved, m_resolved);
+    return resolved;
+}
+
+FrameProfile const& Profiler::latest() const
+{
+    return m_latest;
+}
+
+std::uint64_t Profiler::droppedFrames() const
+{
+    return m_dropped;
+}
+
+void Profiler::flush()
+{
+    for (std::size_t i = 1; i <= m_slots.size(); ++i)
+    {
+        tryResolve(m_slots[(m_current + i) % m_slots.size()], true);
+    }
+}
+
+// draw marker and its children as tree, returns index of next marker on the same or a higher level
+static std::size_t imgui_tree(std::vector<ProfileMarker> const& markers, std::size_t i)
+{
+    ProfileMarker const& marker = markers[i];
+    bool has_children = i + 1 < markers.size() && markers[i + 1].depth > marker.depth;
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | (has_children ? 0 : ImGuiTreeNodeFlags_Leaf);
+    bool open = ImGui::TreeNodeEx((void*)(intptr_t)i, flags, "%s  gpu %.3f ms  cpu %.3f ms", marker.name,
+                                  marker.gpu(), marker.cpu());
+    std::size_t next = i + 1;
+    while (next < markers.size() && markers[next].depth > marker.depth)
+    {
+        if (open)
+        {
+            next = imgui_tree(markers, next);
+        }
+        else
+        {
+            ++next;
+        }
+    }
+    if (open)
+    {
+        ImGui::TreePop();
+    }
+    return next;
+}
+
+void Profiler::imgui()
+{
+    auto const& markers = m_latest.markers;
+    if (markers.empty())
+    {
+        ImGui::Text("waiting for gpu results");
+        return;
+    }
+    ImGui::Text("frame %llu, %llu dropped", (unsigned long long)m_latest.index, (unsigned long long)m_dropped);
+    imgui_tree(markers, 0);
+
+    // flame graph of gpu time, one row per depth
+    const float row_height = ImGui::GetTextLineHeightWithSpacing();
+    int max_depth          = 0;
+    for (auto const& marker : markers)
+    {
+        max_depth = std::max(max_depth, marker.depth);
+    }
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size   = ImVec2(std::max(ImGui::GetContentRegionAvail().x, 1.0f), row_height * float(max_depth + 1));
+    ImGui::InvisibleButton("##flame", size);
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    double start = markers.front().gpu_begin;
+    double scale = size.x / std::max(markers.front().gpu(), 1e-6);
+    for (auto const& marker : markers)
+    {
+        ImVec2 min = ImVec2(origin.x + float((marker.gpu_begin - start) * scale), origin.y + row_height * float(marker.depth));
+        ImVec2 max = ImVec2(origin.x + float((marker.gpu_end - start) * scale), min.y + row_height - 1.0f);
+        // stable color per name
+        unsigned hash = 2166136261u;
+        for (char const* c = marker.name; *c; ++c)
+        {
+            hash = (hash ^ unsigned(*c)) * 16777619u;
+        }
+        ImU32 color = IM_COL32(80 + hash % 150, 80 + (hash >> 8) % 150, 80 + (hash >> 16) % 150, 255);
+        draw_list->AddRectFilled(min, max, color);
+        if (ImGui::CalcTextSize(marker.name).x < max.x - min.x)
+        {
+            draw_list->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_BLACK, marker.name);
+        }
+        if (ImGui::IsMouseHoveringRect(min, max))
+        {
+            ImGui::SetTooltip("%s\ngpu %.3f ms\ncpu %.3f ms", marker.name, marker.gpu(), marker.cpu());
+        }
+    }
+}
+
+void Profiler::writeChromeTrace(std::string const& path) const
+{
+    std::ofstream file{path};
+    if (!file)
+    {
+        std::cerr << "Could not open \'" << path << "\' for writing" << std::endl;
+        throw std::invalid_argument(path);
+    }
+
+    // complete events in microseconds, cpu and gpu markers on separate threads
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\": [\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"cpu\"}},\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 1, \"args\": {\"name\": \"gpu\"}}";
+    for (auto const& frame : m_history)
+    {
+        for (auto const& marker : frame.markers)
+        {
+            file << ",\n{\"name\": \"" << marker.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": "
+                 << marker.cpu_begin * 1000.0 << ", \"dur\": " << marker.cpu() * 1000.0
+                 << ", \"args\": {\"frame\": " << frame.index << "}}";
+            file << ",\n{\"name\": \"" << marker.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 1, \"ts\": "
+                 << marker.gpu_begin * 1000.0 << ", \"dur\": " << marker.gpu() * 1000.0
+                 << ", \"args\": {\"frame\": " << frame.index << "}}";
+        }
+    }
+    file << "\n],\n\"displayTimeUnit\": \"ms\"}\n";
+}
+
+ProfileScope::ProfileScope(Profiler& profiler, char const* name) : m_profiler{&profiler}
+{
+    m_profiler->push(name);
+}
+
+ProfileScope::ProfileScope(ProfileScope&& rhs) : m_profiler{rhs.m_profiler}
+{
+    rhs.m_profiler = nullptr;
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (m_profiler)
+    {
+        m_profiler->pop();
+    }
+}
@@ -1,8 +1,13 @@
 #include "shader_loader.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <glbinding/gl/functions.h>
 #include <iostream>
+#include <iterator>
 #include <regex>
 #include <sstream>
 #include <string.h>
@@ -98,12 +103,50 @@ void shader_error_log(GLchar const* log_buffer, std::string const& header)
     }
 }
 
+// file of a "#pragma incg_include "file"" line, empty for any other line
+std::string include_target(std::string const& line)
+{
+    std::size_t begin = line.find_first_not_of(" \t");
+    if (begin == std::string::npos || line.compare(begin, 7, "#pragma") != 0)
+    {
+        return {};
+    }
+    begin = line.find_first_not_of(" \t", begin + 7);
+    if (begin == std::string::npos || line.compare(begin, 12, "incg_include") != 0)
+    {
+        return {};
+    }
+    begin = line.find_first_not_of(" \t", begin + 12);
+    if (begin == std::string::npos || line[begin] != '"')
+    {
+        return {};
+    }
+    std::size_t end = line.find('"', begin + 1);
+    return end == std::string::npos ? std::string{} : line.substr(begin + 1, end - begin - 1);
+}
+
+// expanded text of a file and the write times of everything it was expanded from,
+// reused until one of them changes so includes are not resolved again for every program
+struct Expanded
+{
+    std::string text;
+    std::vector<std::pair<std::string, long>> files;
+};
+std::unordered_map<std::string, Expanded> expanded_files;
+
 static std::string read_file(std::string const& name)
 {
-    std::ifstream ifile(name);
-    // manage shader includes:
-    std::regex include_regex = std::regex("^#pragma\\s+incg_include\\s+\"(.*)\".*\\s*");
-    auto filename            = file_name(name);
+    auto cached = expanded_files.find(name);
+    if (cached != expanded_files.end() &&
+        std::all_of(cached->second.files.begin(), cached->second.files.end(),
+                    [](std::pair<std::string, long> const& file)
+                    { return getFileWriteTime(file.first.c_str()) == file.second; }))
+    {
+        return cached->second.text;
+    }
+
+    std::ifstream ifile(name, std::ios::in | std::ios::binary);
+    auto filename = file_name(name);
     if (shader_filenameIDs.find(filename) == shader_filenameIDs.end())
     {
         shader_filenameIDs[filename] = shader_filenameIDs.size();
@@ -113,47 +156,44 @@ static std::string read_file(std::string const& name)
 
     shader_filenames[fileID].second = getFileWriteTime(name.c_str());
 
-    if (ifile)
+    if (!ifile)
     {
-        std::string filetext;
-        int lineID = 0;
-
-        while (ifile.good())
-        {
-            std::string line;
-            std::getline(ifile, line);
-            // handle CRLF line endings on unix systems
-            line = std::regex_replace(line, std::regex("\r+"), "");
+        std::cerr << "File \'" << name << "\' not found" << std::endl;
 
-            // assert includes starting at correct linenumber (after #version)
-            if (lineID == 0) line.append("\n#line 2 ").append(std::to_string(fileID));
+        throw std::invalid_argument(name);
+    }
 
-            // manage shader includes
-            std::smatch match;
-            if (std::regex_match(line, match, include_regex))
-            {
-                std::stringstream stream;
-                stream << file_path(name) << match[1];
-                std::string inc_file = stream.str();
+    std::string source{std::istreambuf_iterator<char>{ifile}, std::istreambuf_iterator<char>{}};
+    // handle CRLF line endings on unix systems
+    source.erase(std::remove(source.begin(), source.end(), '\r'), source.end());
 
-                std::stringstream stream2;
-                stream2 << read_file(inc_file) << "\n#line " << lineID << " " << fileID << "\n";
-                line = stream2.str();
-            }
+    Expanded expanded{};
+    expanded.files.emplace_back(name, shader_filenames[fileID].second);
+    expanded.text.reserve(source.size());
+    int lineID = 0;
+    for (std::size_t begin = 0; begin <= source.size(); ++lineID)
+    {
+        std::size_t end = std::min(source.find('\n', begin), source.size());
+        std::string line{source, begin, end - begin};
+        begin = end + 1;
 
-            filetext.append(line + "\n");
-            lineID++;
+        // manage shader includes, numbering continues after the include line
+        std::string include = include_target(line);
+        if (!include.empty())
+        {
+            std::string inc_file = file_path(name) + include;
+            expanded.text.append(read_file(inc_file));
+            auto const& inc_files = expanded_files[inc_file].files;
+            expanded.files.insert(expanded.files.end(), inc_files.begin(), inc_files.end());
+            expanded.text.append("\n#line " + std::to_string(lineID + 2) + " " + std::to_string(fileID) + "\n");
+            continue;
         }
-
-        // std::cout<<filetext<<std::endl;
-        return filetext;
+        expanded.text.append(line).append("\n");
+        // assert includes starting at correct linenumber (after #version)
+        if (lineID == 0) expanded.text.append("#line 2 " + std::to_string(fileID) + "\n");
     }
-    else
-    {
-        std::cerr << "File \'" << name << "\' not found" << std::endl;
 
-        throw std::invalid_argument(name);
-    }
+    return (expanded_files[name] = std::move(expanded)).text;
 }
 // http://insanecoding.blogspot.com/2011/11/how-to-read-in-file-in-c.html
 std::string read_binary(std::string const& name)
@@ -177,6 +217,193 @@ std::string read_binary(std::string const& name)
     }
 }
 
+// throws with the compile log if compilation failed
+void check_compiled(GLuint shader, std::string const& file_path)
+{
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (success == 0)
+    {
+        // get log length
+        GLint log_size = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
+        // get log
+        GLchar* log_buffer = (GLchar*)malloc(sizeof(GLchar) * log_size);
+        glGetShaderInfoLog(shader, log_size, &log_size, log_buffer);
+        // output errors
+        shader_error_log(log_buffer, file_name(file_path));
+        free(log_buffer);
+
+        throw std::logic_error("OpenGL error: compilation of " + file_path);
+    }
+}
+
+// starts compiling, with parallel compilation the driver continues in the background
+GLuint compile(std::string const& source, GLenum shader_type)
+{
+    GLuint shader = glCreateShader(shader_type);
+    // glshadersource expects array of c-strings
+    const char* shader_chars = source.c_str();
+    glShaderSource(shader, 1, &shader_chars, 0);
+    glCompileShader(shader);
+    return shader;
+}
+
+// detaches and frees the shaders, on failure frees the program too and throws with the log
+void check_linked(GLuint program, std::vector<GLuint> const& shaders, std::vector<std::string> const& files)
+{
+    for (auto shader_handle : shaders)
+    {
+        // detach shader
+        glDetachShader(program, shader_handle);
+        // and free it
+        glDeleteShader(shader_handle);
+    }
+
+    // check if linking was successfull
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == 0)
+    {
+        // get log length
+        GLint log_size = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
+        // get log
+        GLchar* log_buffer = (GLchar*)malloc(sizeof(GLchar) * log_size);
+        glGetProgramInfoLog(program, log_size, &log_size, log_buffer);
+
+        // output errors
+        std::string paths{};
+        for (auto const& file : files)
+        {
+            paths += file_name(file) + " & ";
+        }
+        paths.resize(paths.size() - 3);
+        output_log(log_buffer, paths);
+        // free broken program
+        glDeleteProgram(program);
+        free(log_buffer);
+
+        throw std::logic_error("OpenGL error: linking of " + paths);
+    }
+}
+
+bool parallel_compile = false;
+
+std::string binary_cache_directory{};
+shader_loader::BuildStats stats{};
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char BINARY_MAGIC[8] = {'I', 'N', 'C', 'G', 'P', 'R', 'O', 'G'};
+
+// 64 bit fnv-1a
+std::uint64_t hash(std::string const& data)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char c : data)
+    {
+        hash = (hash ^ std::uint64_t(static_cast<unsigned char>(c))) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// binaries are only valid for the driver that wrote them
+std::string driver_id()
+{
+    std::string id{};
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION})
+    {
+        GLubyte const* value = glGetString(name);
+        id.append(value ? reinterpret_cast<char const*>(value) : "").append("\n");
+    }
+    return id;
+}
+
+bool binary_cache_enabled()
+{
+    if (binary_cache_directory.empty())
+    {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// linked program from the cache, 0 if missing or rejected by the driver
+GLuint load_cached(std::string const& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    char magic[sizeof(BINARY_MAGIC)] = {};
+    std::uint32_t format = 0, size = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file || memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0)
+    {
+        return 0;
+    }
+    std::string binary(size, '\0');
+    file.read(&binary[0], std::streamsize(size));
+    if (!file)
+    {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, static_cast<GLenum>(format), binary.data(), GLsizei(size));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == 0)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// the cache is optional, failing to write it only costs the next start
+void save_cached(std::string const& path, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+    std::string binary(std::size_t(length), '\0');
+    GLenum format = GL_NONE;
+    glGetProgramBinary(program, length, &length, &format, &binary[0]);
+    std::uint32_t format_value = static_cast<std::uint32_t>(format), size = std::uint32_t(length);
+
+#ifdef _WIN32
+    CreateDirectoryA(binary_cache_directory.c_str(), NULL);
+#else
+    mkdir(binary_cache_directory.c_str(), 0755);
+#endif
+    // write aside and rename so a concurrent start never reads a partial file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        file.write(reinterpret_cast<char const*>(&format_value), sizeof(format_value));
+        file.write(reinterpret_cast<char const*>(&size), sizeof(size));
+        file.write(binary.data(), std::streamsize(size));
+        if (!file)
+        {
+            std::cerr << "Could not write program binary \'" << path << "\'" << std::endl;
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    std::remove(path.c_str());
+    std::rename(temporary.c_str(), path.c_str());
+}
+
 }  // namespace
 
 namespace shader_loader
@@ -184,10 +411,9 @@ namespace shader_loader
 GLuint shader(std::string const& file_path, GLenum shader_type, bool binary)
 {
     GLuint shader = 0;
-    shader        = glCreateShader(shader_type);
-
     if (binary)
     {
+        shader = glCreateShader(shader_type);
         std::string shader_source{read_binary(file_path)};
         glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, shader_source.data(),
                        (GLsizei)(shader_source.size() * sizeof(std::string::value_type)));
@@ -195,34 +421,19 @@ GLuint shader(std::string const& file_path, GLenum shader_type, bool binary)
     }
     else
     {
-        std::string shader_source{read_file(file_path)};
-        // glshadersource expects array of c-strings
-        const char* shader_chars = shader_source.c_str();
-        glShaderSource(shader, 1, &shader_chars, 0);
-
-        glCompileShader(shader);
+        shader = compile(read_file(file_path), shader_type);
     }
 
-    // check if compilation was successfull
-    GLint success = 0;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (success == 0)
+    try
+    {
+        check_compiled(shader, file_path);
+    }
+    catch (...)
     {
-        // get log length
-        GLint log_size = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
-        // get log
-        GLchar* log_buffer = (GLchar*)malloc(sizeof(GLchar) * log_size);
-        glGetShaderInfoLog(shader, log_size, &log_size, log_buffer);
-        // output errors
-        shader_error_log(log_buffer, file_name(file_path));
         // free broken shader
         glDeleteShader(shader);
-        free(log_buffer);
-
-        throw std::logic_error("OpenGL error: compilation of " + file_path);
+        throw;
     }
-
     return shader;
 }
 
@@ -238,60 +449,175 @@ unsigned program(std::map<GLenum, std::string> const& stages, bool spirv)
         }
         return program_binary(bin_stage->second);
     }
+    if (!spirv)
+    {
+        PendingProgram pending = begin_program(stages);
+        return finish(pending);
+    }
 
+    // spir-v modules are specialized one after another
+    auto start       = std::chrono::steady_clock::now();
     unsigned program = glCreateProgram();
-
     std::vector<GLuint> shaders{};
-    // load and compile vert and frag shader
+    std::vector<std::string> files{};
     for (auto const& stage : stages)
     {
-        GLuint shader_handle = shader(stage.second, stage.first, spirv);
-        shaders.push_back(shader_handle);
+        shaders.push_back(shader(stage.second, stage.first, true));
+        files.push_back(stage.second);
         // attach the shader to program
-        glAttachShader(program, shader_handle);
+        glAttachShader(program, shaders.back());
     }
-    // make programs retrieveable by default
-    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
-    // link shaders
     glLinkProgram(program);
+    check_linked(program, shaders, files);
+    ++stats.compiled;
+    stats.milliseconds += milliseconds_since(start);
+    return program;
+}
 
-    // check if linking was successfull
-    GLint success = 0;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (success == 0)
+PendingProgram begin_program(std::map<GLenum, std::string> const& stages)
+{
+    auto start = std::chrono::steady_clock::now();
+    PendingProgram pending{};
+
+    // preprocessed sources, with the driver they also key the binary cache
+    std::vector<std::string> sources{};
+    std::string key{};
+    for (auto const& stage : stages)
     {
-        // get log length
-        GLint log_size = 0;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
-        // get log
-        GLchar* log_buffer = (GLchar*)malloc(sizeof(GLchar) * log_size);
-        glGetProgramInfoLog(program, log_size, &log_size, log_buffer);
+        sources.push_back(read_file(stage.second));
+        key.append(std::to_string(static_cast<unsigned>(stage.first))).append("\n").append(sources.back());
+        key.push_back('\0');
+        pending.stage_files.push_back(stage.second);
+        for (auto const& file : expanded_files[stage.second].files)
+        {
+            if (std::find(pending.files.begin(), pending.files.end(), file.first) == pending.files.end())
+            {
+                pending.files.push_back(file.first);
+            }
+        }
+    }
+    if (binary_cache_enabled())
+    {
+        char name[17];
+        snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(driver_id() + key)));
+        pending.cache_path = binary_cache_directory + "/" + name + ".bin";
+        pending.program    = load_cached(pending.cache_path);
+        if (pending.program)
+        {
+            pending.cached = true;
+            stats.milliseconds += milliseconds_since(start);
+            return pending;
+        }
+    }
 
-        // output errors
-        std::string paths{};
-        for (auto const& stage : stages)
+    pending.program = glCreateProgram();
+    std::size_t i   = 0;
+    for (auto const& stage : stages)
+    {
+        pending.shaders.push_back(compile(sources[i++], stage.first));
+        // attach the shader to program
+        glAttachShader(pending.program, pending.shaders.back());
+    }
+    // make programs retrieveable by default
+    glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    // linking right away lets the driver continue through the link without another call
+    glLinkProgram(pending.program);
+    stats.milliseconds += milliseconds_since(start);
+    return pending;
+}
+
+bool ready(PendingProgram const& pending)
+{
+    if (pending.cached || !parallel_compile)
+    {
+        return true;
+    }
+    GLint done = 0;
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done != 0;
+}
+
+unsigned finish(PendingProgram& pending)
+{
+    auto start      = std::chrono::steady_clock::now();
+    GLuint program  = pending.program;
+    pending.program = 0;
+    if (pending.cached)
+    {
+        ++stats.cached;
+        stats.milliseconds += milliseconds_since(start);
+        return program;
+    }
+
+    try
+    {
+        for (std::size_t i = 0; i < pending.shaders.size(); ++i)
         {
-            paths += file_name(stage.second) + " & ";
+            check_compiled(pending.shaders[i], pending.stage_files[i]);
+        }
+    }
+    catch (...)
+    {
+        for (auto shader_handle : pending.shaders)
+        {
+            glDeleteShader(shader_handle);
         }
-        paths.resize(paths.size() - 3);
-        output_log(log_buffer, paths);
-        // free broken program
         glDeleteProgram(program);
-        free(log_buffer);
+        throw;
+    }
+    check_linked(program, pending.shaders, pending.stage_files);
 
-        throw std::logic_error("OpenGL error: linking of " + paths);
+    if (!pending.cache_path.empty())
+    {
+        save_cached(pending.cache_path, program);
     }
+    ++stats.compiled;
+    stats.milliseconds += milliseconds_since(start);
+    return program;
+}
 
-    for (auto shader_handle : shaders)
+void cancel(PendingProgram& pending)
+{
+    for (auto shader_handle : pending.shaders)
     {
-        // detach shader
-        glDetachShader(program, shader_handle);
-        // and free it
         glDeleteShader(shader_handle);
     }
+    glDeleteProgram(pending.program);
+    pending = PendingProgram{};
+}
 
-    return program;
+bool enable_parallel_compile()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        std::string extension{reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, GLuint(i)))};
+        if (extension == "GL_KHR_parallel_shader_compile")
+        {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            parallel_compile = true;
+        }
+        else if (extension == "GL_ARB_parallel_shader_compile" && !parallel_compile)
+        {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            parallel_compile = true;
+        }
+    }
+    return parallel_compile;
+}
+
+void invalidate(std::string const& file)
+{
+    for (auto expanded = expanded_files.begin(); expanded != expanded_files.end();)
+    {
+        auto const& files = expanded->second.files;
+        bool depends      = std::any_of(files.begin(), files.end(),
+                                        [&](std::pair<std::string, long> const& entry) { return entry.first == file; });
+        expanded          = depends ? expanded_files.erase(expanded) : std::next(expanded);
+    }
 }
+
 unsigned program_binary(std::string const& file_path)
 {
     unsigned program = glCreateProgram();
@@ -330,17 +656,69 @@ unsigned program_binary(std::string const& file_path)
 
     return program;
 }
-bool RequireReload()
+Reflection reflect(unsigned program, bool compute)
 {
-    for (auto& f : shader_filenames)
+    Reflection reflection{};
+
+    GLint name_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &name_length);
+    std::vector<GLchar> name(std::max(name_length, 1));
+
+    GLint num_uniforms = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+    for (GLint i = 0; i < num_uniforms; ++i)
     {
-        auto new_time = getFileWriteTime(f.first.c_str());
-        if( new_time != f.second)
+        UniformInfo info{-1, GL_NONE, 0};
+        GLsizei length = 0;
+        glGetActiveUniform(program, GLuint(i), GLsizei(name.size()), &length, &info.size, &info.type, name.data());
+        std::string uniform_name{name.data(), std::size_t(length)};
+        // block members have no location
+        info.location = ::glGetUniformLocation(program, uniform_name.c_str());
+        if (info.location < 0)
+        {
+            continue;
+        }
+        reflection.uniforms.emplace(uniform_name, info);
+        // arrays are reported as name[0]
+        auto bracket = uniform_name.find('[');
+        if (bracket != std::string::npos)
         {
-            return true;
+            reflection.uniforms.emplace(uniform_name.substr(0, bracket), info);
         }
     }
-    return false;
+
+    GLint num_blocks = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &num_blocks);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &name_length);
+    name.resize(std::max(name_length, 1));
+    for (GLint i = 0; i < num_blocks; ++i)
+    {
+        BlockInfo info{GLuint(i), 0, 0};
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(program, info.index, GLsizei(name.size()), &length, name.data());
+        GLint binding = 0;
+        glGetActiveUniformBlockiv(program, info.index, GL_UNIFORM_BLOCK_BINDING, &binding);
+        glGetActiveUniformBlockiv(program, info.index, GL_UNIFORM_BLOCK_DATA_SIZE, &info.data_size);
+        info.binding = GLuint(binding);
+        reflection.blocks.emplace(std::string{name.data(), std::size_t(length)}, info);
+    }
+
+    // querying the work group size of non-compute programs is an error
+    if (compute)
+    {
+        glGetProgramiv(program, GL_COMPUTE_WORK_GROUP_SIZE, &reflection.work_group_size[0]);
+    }
+    return reflection;
+}
+
+void set_binary_cache(std::string const& directory)
+{
+    binary_cache_directory = directory;
+}
+
+BuildStats const& build_stats()
+{
+    return stats;
 }
 
 }  // namespace shader_loader
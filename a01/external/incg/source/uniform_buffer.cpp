@@ -0,0 +1,109 @@
+#include "uniform_buffer.hpp"
+
+#include <glbinding/gl/bitfield.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+UniformRing::UniformRing(std::size_t frame_capacity, unsigned frames_in_flight)
+    : m_buffer{0},
+      m_capacity{0},
+      m_alignment{256},
+      m_mapping{nullptr},
+      m_fences(std::max(1u, frames_in_flight), nullptr),
+      m_region{0},
+      m_offset{0}
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_alignment = std::size_t(std::max(alignment, 1));
+    m_capacity  = (frame_capacity + m_alignment - 1) / m_alignment * m_alignment;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool buffer_storage = major > 4 || (major == 4 && minor >= 4);
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    GLsizeiptr size = GLsizeiptr(m_capacity * m_fences.size());
+    if (buffer_storage)
+    {
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr,
+                        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+        m_mapping = static_cast<unsigned char*>(
+            glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+    }
+    else
+    {
+        // no persistent mapping before 4.4, fall back to sub data uploads
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRing::~UniformRing()
+{
+    for (auto fence : m_fences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    if (m_mapping)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformRing::beginFrame()
+{
+    m_region = (m_region + 1) % m_fences.size();
+    m_offset = 0;
+
+    GLsync& fence = m_fences[m_region];
+    if (fence)
+    {
+        // region was last written frames_in_flight frames ago, usually already signaled
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void UniformRing::endFrame()
+{
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT);
+}
+
+void UniformRing::bind(GLuint binding, void const* data, std::size_t size)
+{
+    if (m_offset + size > m_capacity)
+    {
+        throw std::runtime_error("UniformRing: frame capacity of " + std::to_string(m_capacity) + " bytes exceeded");
+    }
+    std::size_t offset = m_region * m_capacity + m_offset;
+    if (m_mapping)
+    {
+        std::memcpy(m_mapping + offset, data, size);
+    }
+    else
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, GLintptr(offset), GLsizeiptr(size), data);
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, GLintptr(offset), GLsizeiptr(size));
+    m_offset += (size + m_alignment - 1) / m_alignment * m_alignment;
+}
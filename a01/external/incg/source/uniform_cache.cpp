@@ -0,0 +1,68 @@
+#include "uniform_cache.hpp"
+
+#include <glbinding/Meta.h>
+
+#include <iostream>
+
+// samplers and images are set through their texture unit
+static bool is_opaque_type(GLenum type)
+{
+    std::string name = glbinding::Meta::getString(type);
+    return name.find("SAMPLER") != std::string::npos || name.find("IMAGE") != std::string::npos;
+}
+
+ProgramUniforms::ProgramUniforms(std::string const& name)
+    : m_name{name}, m_program{0}, m_reflection{}, m_names{}, m_types{}, m_locations{}
+{
+}
+
+void ProgramUniforms::update(GLuint program, shader_loader::Reflection&& reflection)
+{
+    m_program    = program;
+    m_reflection = std::move(reflection);
+    for (std::size_t i = 0; i < m_names.size(); ++i)
+    {
+        m_locations[i] = resolve(m_names[i], m_types[i]);
+    }
+}
+
+std::size_t ProgramUniforms::index(std::string const& name, GLenum type)
+{
+    for (std::size_t i = 0; i < m_names.size(); ++i)
+    {
+        if (m_names[i] == name)
+        {
+            return i;
+        }
+    }
+    m_names.push_back(name);
+    m_types.push_back(type);
+    m_locations.push_back(resolve(name, type));
+    return m_names.size() - 1;
+}
+
+GLint ProgramUniforms::location(std::string const& name) const
+{
+    auto uniform = m_reflection.uniforms.find(name);
+    return uniform != m_reflection.uniforms.end() ? uniform->second.location : -1;
+}
+
+GLint ProgramUniforms::resolve(std::string const& name, GLenum type) const
+{
+    auto uniform = m_reflection.uniforms.find(name);
+    // inactive uniforms are optimized out, uploads to -1 are ignored by gl
+    if (uniform == m_reflection.uniforms.end())
+    {
+        return -1;
+    }
+    GLenum active_type = uniform->second.type;
+    bool compatible    = active_type == type || (type == GL_INT && is_opaque_type(active_type)) ||
+                      (type == GL_BOOL && active_type == GL_INT);
+    if (!compatible)
+    {
+        std::cerr << "Uniform type mismatch: " << m_name << "::" << name << " is "
+                  << glbinding::Meta::getString(active_type) << ", uploaded as "
+                  << glbinding::Meta::getString(type) << std::endl;
+    }
+    return uniform->second.location;
+}
@@ -15,8 +15,18 @@ using namespace gl;
 
 #include <glm/gtc/type_precision.hpp>
 
+#ifdef INCG_WITH_EGL
+// keep X11 typedefs and macros out of the egl headers
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 #include <iostream>
+
+#include "gl_state.hpp"
+
 // helper functions
 static void glsl_error(int error, const char* description);
 static void watch_gl_errors(bool activate = true);
@@ -84,12 +94,115 @@ GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigne
 
   return window;
 }
+
+// offscreen state used instead of a window
+static GLuint headless_fbo = 0;
+static GLuint headless_rbos[2] = {0, 0};
+#ifdef INCG_WITH_EGL
+static EGLDisplay headless_display = EGL_NO_DISPLAY;
+static EGLContext headless_context = EGL_NO_CONTEXT;
+#endif
+
+void initialize_headless(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor) {
+#ifdef INCG_WITH_EGL
+  // prefer a display without any window system, works with llvmpipe on machines without gpu
+  auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (getPlatformDisplay) {
+    headless_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (headless_display == EGL_NO_DISPLAY) {
+    headless_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  EGLint egl_major = 0, egl_minor = 0;
+  if (headless_display == EGL_NO_DISPLAY || !eglInitialize(headless_display, &egl_major, &egl_minor)) {
+    std::cerr << "EGL Error: no display available for headless rendering" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  eglBindAPI(EGL_OPENGL_API);
+
+  // no surface is created, so config only needs to support desktop gl
+  const EGLint config_attribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config = nullptr;
+  EGLint num_configs = 0;
+  eglChooseConfig(headless_display, config_attribs, &config, 1, &num_configs);
+
+  // same profile as the windowed context, compatibility unless on MacOS
+  const EGLint context_attribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, EGLint(ver_major),
+    EGL_CONTEXT_MINOR_VERSION, EGLint(ver_minor),
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+    EGL_NONE
+  };
+  headless_context = eglCreateContext(headless_display, num_configs > 0 ? config : EGLConfig(nullptr), EGL_NO_CONTEXT, context_attribs);
+  if (headless_context == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE, headless_context)) {
+    std::cerr << "EGL Error " << std::hex << eglGetError() << std::dec << ": headless context creation failed" << std::endl;
+    eglTerminate(headless_display);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // context is not known to glx, so pass handle explicitly
+  glbinding::Binding::initialize(reinterpret_cast<glbinding::ContextHandle>(headless_context), true, true);
+  watch_gl_errors();
+
+  glEnable(GL_DEBUG_OUTPUT);
+  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  glDebugMessageCallback(openglCallbackFunction, nullptr);
+  glDebugMessageControl(
+    GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, true
+  );
+
+  // surfaceless context has no default framebuffer, render into fbo with window-like attachments
+  glGenRenderbuffers(2, headless_rbos);
+  glBindRenderbuffer(GL_RENDERBUFFER, headless_rbos[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, resolution.x, resolution.y);
+  glBindRenderbuffer(GL_RENDERBUFFER, headless_rbos[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, resolution.x, resolution.y);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &headless_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, headless_fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless_rbos[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headless_rbos[1]);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "OpenGL Error: headless framebuffer incomplete" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
+  std::cout << "Headless context: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+#else
+  (void)resolution; (void)ver_major; (void)ver_minor;
+  std::cerr << "Headless rendering not available, incg was built without EGL" << std::endl;
+  std::exit(EXIT_FAILURE);
+#endif
+}
+
 namespace window_handler {
+unsigned default_framebuffer() {
+  return headless_fbo;
+}
+
 void close_and_quit(GLFWwindow* window, int status) {
 
-  // free glfw resources
-  glfwDestroyWindow(window);
-  glfwTerminate();
+  if (window) {
+    // free glfw resources
+    glfwDestroyWindow(window);
+    glfwTerminate();
+  }
+#ifdef INCG_WITH_EGL
+  else if (headless_context != EGL_NO_CONTEXT) {
+    gl_state::forget_framebuffer(headless_fbo);
+    glDeleteFramebuffers(1, &headless_fbo);
+    glDeleteRenderbuffers(2, headless_rbos);
+    headless_fbo = 0;
+
+    eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(headless_display, headless_context);
+    eglTerminate(headless_display);
+    headless_context = EGL_NO_CONTEXT;
+  }
+#endif
 
   std::exit(status);
 }
@@ -0,0 +1,233 @@
+// compares loading and drawing meshes from obj files with the binary mesh cache
+// usage: mesh_benchmark [--runs=N] [--draws=N] file.obj...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include "mesh_cache.hpp"
+#include "window_handler.hpp"
+
+namespace
+{
+template <typename F>
+double best_seconds(unsigned runs, F const& function)
+{
+    double best = 1e30;
+    for (unsigned i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+#ifdef INCG_WITH_EGL
+char const* VERTEX_SHADER =
+    "#version 330\n"
+    "layout(location = 0) in vec3 position;\n"
+    "layout(location = 1) in vec3 normal;\n"
+    "out vec3 color;\n"
+    "void main() {\n"
+    "  color = normal * 0.5 + 0.5;\n"
+    "  gl_Position = vec4(position * 0.01, 1.0);\n"
+    "}\n";
+char const* FRAGMENT_SHADER =
+    "#version 330\n"
+    "in vec3 color;\n"
+    "out vec4 out_color;\n"
+    "void main() { out_color = vec4(color, 1.0); }\n";
+
+GLuint compile(GLenum type, char const* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+// geometry as uploaded by one of the two paths
+struct GpuMesh
+{
+    GLuint vao           = 0;
+    GLuint buffers[3]    = {0, 0, 0};
+    GLsizei index_count  = 0;
+    GLenum index_type    = GL_UNSIGNED_INT;
+    std::size_t offset   = 0;
+    double upload_millis = 0.0;
+
+    ~GpuMesh()
+    {
+        glDeleteBuffers(3, buffers);
+        glDeleteVertexArrays(1, &vao);
+    }
+};
+
+// separate float streams and 32 bit indices in file order, as simpleModel did before the cache
+void upload_obj(GpuMesh& mesh, obj_loader::Mesh const& obj)
+{
+    auto start = std::chrono::steady_clock::now();
+    glGenVertexArrays(1, &mesh.vao);
+    glBindVertexArray(mesh.vao);
+    glGenBuffers(3, mesh.buffers);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, obj.positions.size() * sizeof(glm::vec3), obj.positions.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, obj.normals.size() * sizeof(glm::vec3), obj.normals.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffers[2]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, obj.indices.size() * sizeof(std::uint32_t), obj.indices.data(),
+                 GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glFinish();
+    mesh.index_count   = GLsizei(obj.indices.size());
+    mesh.upload_millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// one buffer holding interleaved vertices and indices, as simpleModel::upload(File)
+void upload_cache(GpuMesh& mesh, mesh_cache::File const& file)
+{
+    auto start                       = std::chrono::steady_clock::now();
+    mesh_cache::Header const& header = file.header();
+    glGenVertexArrays(1, &mesh.vao);
+    glBindVertexArray(mesh.vao);
+    glGenBuffers(1, mesh.buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, file.payloadSize(), file.payload(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, header.vertex_stride, 0);
+    glVertexAttribPointer(1, 3, header.normal_encoding == mesh_cache::NORMAL_HALF ? GL_HALF_FLOAT : GL_FLOAT,
+                          GL_FALSE, header.vertex_stride, (void*)sizeof(glm::vec3));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffers[0]);
+    glBindVertexArray(0);
+    glFinish();
+    mesh.index_count   = GLsizei(file.lods().front().index_count);
+    mesh.index_type    = header.index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    mesh.offset        = file.indexOffset();
+    mesh.upload_millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// million vertices (indices) per second, best of runs
+// timed on the cpu around glFinish, timer queries are not reliable on software renderers
+double vertex_rate(GpuMesh const& mesh, unsigned runs, unsigned draws)
+{
+    glBindVertexArray(mesh.vao);
+    // warm up
+    glDrawElements(GL_TRIANGLES, mesh.index_count, mesh.index_type, (void*)mesh.offset);
+    glFinish();
+    double seconds = best_seconds(runs, [&]() {
+        for (unsigned i = 0; i < draws; ++i)
+        {
+            glDrawElements(GL_TRIANGLES, mesh.index_count, mesh.index_type, (void*)mesh.offset);
+        }
+        glFinish();
+    });
+    glBindVertexArray(0);
+    return double(mesh.index_count) * draws / seconds * 1e-6;
+}
+#endif
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned runs  = 5;
+    unsigned draws = 100;
+    std::vector<std::string> files{};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg.compare(0, 7, "--runs=") == 0)
+        {
+            runs = unsigned(std::max(1, std::stoi(arg.substr(7))));
+        }
+        else if (arg.compare(0, 8, "--draws=") == 0)
+        {
+            draws = unsigned(std::max(1, std::stoi(arg.substr(8))));
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--runs=N] [--draws=N] file.obj..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#ifdef INCG_WITH_EGL
+    // drawing into a single pixel keeps the measurement vertex bound
+    initialize_headless(glm::uvec2{1, 1}, 3, 3);
+    GLuint program = glCreateProgram();
+    GLuint shaders[2] = {compile(GL_VERTEX_SHADER, VERTEX_SHADER), compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER)};
+    glAttachShader(program, shaders[0]);
+    glAttachShader(program, shaders[1]);
+    glLinkProgram(program);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+    glUseProgram(program);
+    glBindFramebuffer(GL_FRAMEBUFFER, window_handler::default_framebuffer());
+    glViewport(0, 0, 1, 1);
+#endif
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto const& path : files)
+    {
+        try
+        {
+            // make sure the cache exists before timing it
+            mesh_cache::load(path);
+            obj_loader::Mesh obj{};
+            double obj_load = best_seconds(runs, [&]() { obj = obj_loader::load(path); });
+            std::unique_ptr<mesh_cache::File> cache{};
+            double cache_load =
+                best_seconds(runs, [&]() { cache.reset(new mesh_cache::File{mesh_cache::cache_path(path)}); });
+
+            std::vector<glm::vec3> positions, normals;
+            std::vector<std::uint32_t> indices;
+            cache->unpack(positions, normals, indices);
+            std::cout << path << std::endl
+                      << "  load ms:    obj " << obj_load * 1e3 << ", cache " << cache_load * 1e3 << ", "
+                      << obj_load / cache_load << "x" << std::endl
+                      << "  vertices:   obj " << obj.positions.size() << ", cache " << cache->header().vertex_count
+                      << std::endl
+                      << "  acmr(16):   obj " << mesh_cache::acmr(obj.indices) << ", cache "
+                      << mesh_cache::acmr(indices) << std::endl;
+#ifdef INCG_WITH_EGL
+            GpuMesh obj_mesh{}, cache_mesh{};
+            upload_obj(obj_mesh, obj);
+            upload_cache(cache_mesh, *cache);
+            double obj_rate   = vertex_rate(obj_mesh, runs, draws);
+            double cache_rate = vertex_rate(cache_mesh, runs, draws);
+            std::cout << "  upload ms:  obj " << obj_mesh.upload_millis << ", cache " << cache_mesh.upload_millis
+                      << std::endl
+                      << "  Mverts/s:   obj " << obj_rate << ", cache " << cache_rate << ", "
+                      << cache_rate / obj_rate << "x" << std::endl;
+#endif
+        }
+        catch (std::exception const& error)
+        {
+            std::cerr << error.what() << std::endl;
+        }
+    }
+
+#ifdef INCG_WITH_EGL
+    glDeleteProgram(program);
+    window_handler::close_and_quit(nullptr, EXIT_SUCCESS);
+#endif
+}
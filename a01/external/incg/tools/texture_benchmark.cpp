@@ -0,0 +1,245 @@
+// compares png textures with precompressed ktx textures in load time, video memory and sampling rate
+// the first file is the quality reference for the others
+// usage: texture_benchmark [--runs=N] [--draws=N] file.png|file.ktx...
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include "helper.hpp"
+#include "ktx_texture.hpp"
+#include "window_handler.hpp"
+
+namespace
+{
+template <typename F>
+double best_seconds(unsigned runs, F const& function)
+{
+    double best = 1e30;
+    for (unsigned i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+#ifdef INCG_WITH_EGL
+// minified lookups across the whole texture, so every level gets sampled
+char const* VERTEX_SHADER =
+    "#version 330\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "  vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "  uv = corner * 2.0;\n"
+    "  gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+char const* FRAGMENT_SHADER =
+    "#version 330\n"
+    "uniform sampler2D tex;\n"
+    "in vec2 uv;\n"
+    "out vec4 out_color;\n"
+    "void main() { out_color = texture(tex, uv); }\n";
+
+const glm::uvec2 TARGET_SIZE{1024, 1024};
+
+GLuint compile(GLenum type, char const* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+// bytes of all levels as allocated by the driver
+std::size_t video_memory(Tex const& texture)
+{
+    texture.bind();
+    GLint levels = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &levels);
+    std::size_t bytes = 0;
+    for (GLint level = 0; level <= levels; ++level)
+    {
+        GLint width = 0, height = 0, compressed = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+        if (width == 0)
+        {
+            break;
+        }
+        if (compressed)
+        {
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            bytes += std::size_t(size);
+        }
+        else
+        {
+            GLint bits = 0;
+            for (GLenum channel : {GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+                                   GL_TEXTURE_ALPHA_SIZE})
+            {
+                GLint channel_bits = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, level, channel, &channel_bits);
+                bits += channel_bits;
+            }
+            bytes += std::size_t(width) * height * bits / 8;
+        }
+    }
+    return bytes;
+}
+
+// level 0 as decoded by the gpu
+std::vector<std::uint8_t> read_back(Tex const& texture)
+{
+    texture.bind();
+    std::vector<std::uint8_t> pixels(std::size_t(texture.dimensions().x) * texture.dimensions().y * 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+// peak signal to noise ratio of the rgb channels
+double psnr(std::vector<std::uint8_t> const& reference, std::vector<std::uint8_t> const& pixels)
+{
+    double error = 0.0;
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        if (i % 4 != 3)
+        {
+            double d = double(reference[i]) - double(pixels[i]);
+            error += d * d;
+        }
+    }
+    error /= double(pixels.size()) * 3.0 / 4.0;
+    return error > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / error) : INFINITY;
+}
+
+// million texture lookups per second into an offscreen target, best of runs
+double sample_rate(Tex const& texture, unsigned runs, unsigned draws)
+{
+    glActiveTexture(GL_TEXTURE0);
+    texture.bind();
+    // warm up
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glFinish();
+    double seconds = best_seconds(runs, [&]() {
+        for (unsigned i = 0; i < draws; ++i)
+        {
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glFinish();
+    });
+    return double(TARGET_SIZE.x) * TARGET_SIZE.y * draws / seconds * 1e-6;
+}
+#endif
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned runs  = 5;
+    unsigned draws = 10;
+    std::vector<std::string> files{};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg.compare(0, 7, "--runs=") == 0)
+        {
+            runs = unsigned(std::max(1, std::stoi(arg.substr(7))));
+        }
+        else if (arg.compare(0, 8, "--draws=") == 0)
+        {
+            draws = unsigned(std::max(1, std::stoi(arg.substr(8))));
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--runs=N] [--draws=N] file.png|file.ktx..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#ifndef INCG_WITH_EGL
+    std::cerr << argv[0] << " needs a headless context, build incg with egl" << std::endl;
+    return EXIT_FAILURE;
+#else
+    initialize_headless(TARGET_SIZE, 4, 2);
+    GLuint program    = glCreateProgram();
+    GLuint shaders[2] = {compile(GL_VERTEX_SHADER, VERTEX_SHADER), compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER)};
+    glAttachShader(program, shaders[0]);
+    glAttachShader(program, shaders[1]);
+    glLinkProgram(program);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "tex"), 0);
+    GLuint vao = 0;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    int status = EXIT_SUCCESS;
+    {
+        Tex target{TARGET_SIZE, GL_RGBA8};
+        Fbo fbo{};
+        fbo.bind();
+        fbo.addTextureAsColorbuffer(target);
+        fbo.check();
+        fbo.bind();
+        glViewport(0, 0, TARGET_SIZE.x, TARGET_SIZE.y);
+
+        std::vector<std::uint8_t> reference{};
+        std::cout << std::fixed << std::setprecision(2);
+        for (auto const& path : files)
+        {
+            try
+            {
+                struct stat source;
+                stat(path.c_str(), &source);
+                // texture creation including decoding, mip generation and upload
+                double load = best_seconds(runs, [&]() {
+                    Tex texture{path};
+                    glFinish();
+                });
+                Tex texture{path};
+                std::cout << path << std::endl
+                          << "  file KiB:   " << double(source.st_size) / 1024.0 << std::endl
+                          << "  load ms:    " << load * 1e3 << std::endl
+                          << "  video KiB:  " << double(video_memory(texture)) / 1024.0 << std::endl
+                          << "  Msamples/s: " << sample_rate(texture, runs, draws) << std::endl;
+                std::vector<std::uint8_t> pixels = read_back(texture);
+                if (reference.empty())
+                {
+                    reference = std::move(pixels);
+                }
+                else if (reference.size() == pixels.size())
+                {
+                    std::cout << "  psnr dB:    " << psnr(reference, pixels) << std::endl;
+                }
+            }
+            catch (std::exception const& error)
+            {
+                std::cerr << error.what() << std::endl;
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+    window_handler::close_and_quit(nullptr, status);
+#endif
+}
@@ -0,0 +1,206 @@
+// converts png files into mipmapped, block compressed ktx textures ahead of time
+// usage: texture_compress [--format=bc1|bc3|bc6h|bc7|rgba16f] input.png [output.ktx]
+// bc1, bc3 and rgba16f are encoded here, bc6h and bc7 by the driver of a headless context
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <lodepng.h>
+
+#include "ktx_texture.hpp"
+#include "texture_codec.hpp"
+#include "window_handler.hpp"
+
+namespace
+{
+struct Format
+{
+    char const* name;
+    GLenum internal_format;
+    GLenum base_internal_format;
+};
+
+const Format FORMATS[] = {
+    {"bc1", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_RGB},
+    {"bc3", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_RGBA},
+    {"bc6h", GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, GL_RGB},
+    {"bc7", GL_COMPRESSED_RGBA_BPTC_UNORM, GL_RGBA},
+    {"rgba16f", GL_RGBA16F, GL_RGBA},
+};
+
+std::vector<std::uint8_t> as_bytes(std::vector<std::uint16_t> const& values)
+{
+    auto const* begin = reinterpret_cast<std::uint8_t const*>(values.data());
+    return std::vector<std::uint8_t>(begin, begin + values.size() * sizeof(std::uint16_t));
+}
+
+#ifdef INCG_WITH_EGL
+// let the driver compress a level on upload and read the blocks back
+std::vector<std::uint8_t> driver_encode(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& dimensions,
+                                        GLenum internal_format)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // bc6h is a float format, feed it half floats so no precision is lost before encoding
+    if (internal_format == GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT)
+    {
+        std::vector<std::uint16_t> half = texture_codec::to_rgba16f(pixels);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, dimensions.x, dimensions.y, 0, GL_RGBA, GL_HALF_FLOAT,
+                     half.data());
+    }
+    else
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     pixels.data());
+    }
+    GLint compressed = 0, size = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+    std::vector<std::uint8_t> blocks(compressed ? std::size_t(size) : 0);
+    if (compressed)
+    {
+        glGetCompressedTexImage(GL_TEXTURE_2D, 0, blocks.data());
+    }
+    glDeleteTextures(1, &texture);
+    if (!compressed)
+    {
+        throw std::runtime_error("driver cannot compress to the requested format");
+    }
+    return blocks;
+}
+#endif
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    Format const* format = &FORMATS[0];
+    std::string input{};
+    std::string output{};
+    bool known = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg.compare(0, 9, "--format=") == 0)
+        {
+            known = false;
+            for (auto const& candidate : FORMATS)
+            {
+                if (arg.substr(9) == candidate.name)
+                {
+                    format = &candidate;
+                    known  = true;
+                }
+            }
+        }
+        else if (input.empty())
+        {
+            input = arg;
+        }
+        else
+        {
+            output = arg;
+        }
+    }
+    if (input.empty() || !known)
+    {
+        std::cerr << "usage: " << argv[0] << " [--format=bc1|bc3|bc6h|bc7|rgba16f] input.png [output.ktx]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (output.empty())
+    {
+        output = input.substr(0, input.rfind('.')) + ".ktx";
+    }
+
+    bool driver = format->internal_format == GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT ||
+                  format->internal_format == GL_COMPRESSED_RGBA_BPTC_UNORM;
+#ifdef INCG_WITH_EGL
+    if (driver)
+    {
+        initialize_headless(glm::uvec2{1, 1}, 4, 2);
+    }
+#else
+    if (driver)
+    {
+        std::cerr << format->name << " needs a headless context, build incg with egl" << std::endl;
+        return EXIT_FAILURE;
+    }
+#endif
+
+    int status = EXIT_SUCCESS;
+    try
+    {
+        std::vector<std::uint8_t> pixels{};
+        unsigned width = 0, height = 0;
+        unsigned error = lodepng::decode(pixels, width, height, input);
+        if (error)
+        {
+            throw std::runtime_error("LodePNG error - " + std::to_string(error) + ": " + lodepng_error_text(error));
+        }
+        glm::uvec2 const dimensions{width, height};
+        // stored in gl row order so loading never flips
+        texture_codec::flip_rows(pixels, dimensions);
+        std::vector<std::vector<std::uint8_t>> levels = texture_codec::mip_chain(std::move(pixels), dimensions);
+
+        std::size_t bytes = 0;
+        for (unsigned level = 0; level < levels.size(); ++level)
+        {
+            glm::uvec2 size = texture_codec::level_dimensions(dimensions, level);
+            switch (format->internal_format)
+            {
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                    levels[level] = texture_codec::encode_bc1(levels[level], size);
+                    break;
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                    levels[level] = texture_codec::encode_bc3(levels[level], size);
+                    break;
+                case GL_RGBA16F:
+                    levels[level] = as_bytes(texture_codec::to_rgba16f(levels[level]));
+                    break;
+                default:
+#ifdef INCG_WITH_EGL
+                    levels[level] = driver_encode(levels[level], size, format->internal_format);
+#endif
+                    break;
+            }
+            bytes += levels[level].size();
+        }
+
+        ktx::Header header =
+            format->internal_format == GL_RGBA16F
+                ? ktx::header(std::uint32_t(GL_RGBA16F), std::uint32_t(GL_RGBA), dimensions,
+                              std::uint32_t(levels.size()), std::uint32_t(GL_RGBA), std::uint32_t(GL_HALF_FLOAT), 2)
+                : ktx::header(std::uint32_t(format->internal_format), std::uint32_t(format->base_internal_format),
+                              dimensions, std::uint32_t(levels.size()));
+        ktx::write(output, header, levels);
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << output << std::endl
+                  << "  format: " << format->name << ", " << width << "x" << height << ", " << levels.size()
+                  << " levels" << std::endl
+                  << "  bytes:  " << dimensions.x * dimensions.y * 4 * 4 / 3 << " rgba8 -> " << bytes << ", "
+                  << double(bytes) * 8.0 / (double(dimensions.x) * dimensions.y * 4.0 / 3.0) << " bits per texel"
+                  << std::endl;
+    }
+    catch (std::exception const& error)
+    {
+        std::cerr << error.what() << std::endl;
+        status = EXIT_FAILURE;
+    }
+
+#ifdef INCG_WITH_EGL
+    if (driver)
+    {
+        window_handler::close_and_quit(nullptr, status);
+    }
+#endif
+    return status;
+}
@@ -7,8 +7,8 @@ in vec3 L;
 in vec4 P;
 in vec2 TC;
 
-uniform bool pattern;
-uniform vec3 color;
+flat in vec3 color;
+flat in int pattern;
 
 const float shinyness   = 32.0;
 const vec3 ambient_col  = vec3(0.1, 0.1, 0.2);  // grey
@@ -23,7 +23,7 @@ vec4 blinn_phong_reflectance(vec3 N, vec3 L, vec3 V)
 
     vec3 col = color;
 
-    if (pattern)
+    if (pattern != 0)
     {
         vec2 modTC = mod(TC * 50 - 0.75f, 2.0);
         col *= 0.2f;
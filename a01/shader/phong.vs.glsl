@@ -2,25 +2,33 @@
 
 layout(location = 0) in vec3 vPosition;
 layout(location = 1) in vec3 vNormal;
+// per instance, alpha of color selects the pattern
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in vec4 instanceColor;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
-
-uniform vec3 lightDir;
+layout(std140, binding = 1) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    vec4 lightDir;
+};
 
 out vec3 N;
 out vec3 L;
 out vec4 P;
 out vec2 TC;
+flat out vec3 color;
+flat out int pattern;
 
 void main()
 {
     mat3 normalMatrix = transpose(inverse(mat3(viewMatrix * modelMatrix)));
 
     N  = normalMatrix * vNormal.xyz;
-    L  = (viewMatrix * vec4(-lightDir, 0)).xyz;
+    L  = (viewMatrix * vec4(-lightDir.xyz, 0)).xyz;
     P  = viewMatrix * modelMatrix * vec4(vPosition, 1);
+    color   = instanceColor.rgb;
+    pattern = instanceColor.a > 0.5 ? 1 : 0;
     TC = (vPosition.xz + abs(vPosition.xz)) * 0.5f / abs(vPosition.xz);
 
     gl_Position = projMatrix * P;
@@ -4,19 +4,25 @@
 layout(local_size_x = 32, local_size_y = 32) in;
 layout(binding = 0) uniform sampler2D currFrame;
 layout(binding = 1) uniform sampler2D history;
-layout(binding = 2, rgba32f) uniform image2D taaOut;
+// format is chosen when binding, rgba32f, rgba16f or r11f_g11f_b10f
+layout(binding = 2) uniform writeonly image2D taaOut;
+layout(binding = 3) uniform sampler2D currDepth;
 
-uniform bool init;
-uniform uvec2 res;
-
-uniform float[9] weights;
-uniform mat4 reProj;
-
-uniform bool freeze;
-uniform bool doFilter;
-uniform bool doClamp;
-uniform bool doDynamicFeedback;
-uniform float maxFeedback;
+layout(std140, binding = 0) uniform TaaParameters
+{
+    mat4 reProj;
+    vec4 weights[3];  // 3x3 weights packed into vec4
+    uvec2 res;
+    float maxFeedback;
+    bool init;
+    bool freeze;
+    bool doFilter;
+    bool doClamp;
+    bool doDynamicFeedback;
+    vec2 jitter;     // sample position in the current frame, in its pixels
+    uvec2 frameRes;  // resolution of the current frame, below res when upsampling
+    float renderScale;
+};
 
 const ivec2 offsets[9] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {0, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
 float luma(vec3 rgb)
@@ -40,7 +46,7 @@ void main()
         // bound checked at line 29 and 30
         vec4 sampleColor = texelFetch(currFrame, ivec2(gid) + offsets[i], 0);
         // weights are already normalized
-        color += sampleColor * weights[i];
+        color += sampleColor * weights[i / 4][i % 4];
 
         // TODO d) calculate absolute 3x3 neighborhood min/max and clamp history sample
         colorBoxMin = min(colorBoxMin, sampleColor.rgb);
@@ -55,8 +61,9 @@ void main()
 
     // reprojection
     vec2 tex_coord = (vec2(gid) + 0.5) / res;
-    // here, depth is between 0 and 1
-    float depth = texelFetch(currFrame, ivec2(gid), 0).a;
+    // here, depth is between 0 and 1, read from the depth attachment since
+    // reduced precision color formats have no room for it
+    float depth = texelFetch(currDepth, ivec2(gid), 0).r;
 
     vec2 prev_tex_coord = tex_coord;
     // TODO c) reproject current screen space texture coordinates to coordinates from previous frame
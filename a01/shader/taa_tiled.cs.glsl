@@ -0,0 +1,122 @@
+#version 450
+
+// same resolve as taa.cs.glsl, but every work group reads its tile of the current frame
+// plus a one pixel apron into shared memory once, the 3x3 filter and clamp read from there
+// the current frame may be rendered at a lower resolution, every output pixel then filters
+// the 3x3 frame pixels around its position, a tile of at most TILE + 2 covers the work group
+
+#define TILE 16
+#define APRON_TILE (TILE + 2)
+#define gid gl_GlobalInvocationID.xy
+layout(local_size_x = TILE, local_size_y = TILE) in;
+layout(binding = 0) uniform sampler2D currFrame;
+layout(binding = 1) uniform sampler2D history;
+layout(binding = 3) uniform sampler2D currDepth;
+// format is chosen when binding, rgba32f, rgba16f or r11f_g11f_b10f
+layout(binding = 2) uniform writeonly image2D taaOut;
+
+layout(std140, binding = 0) uniform TaaParameters
+{
+    mat4 reProj;
+    vec4 weights[3];  // 3x3 weights packed into vec4
+    uvec2 res;
+    float maxFeedback;
+    bool init;
+    bool freeze;
+    bool doFilter;
+    bool doClamp;
+    bool doDynamicFeedback;
+    vec2 jitter;     // sample position in the current frame, in its pixels
+    uvec2 frameRes;  // resolution of the current frame, below res when upsampling
+    float renderScale;
+};
+
+const ivec2 offsets[9] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {0, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+
+shared vec3 tile[APRON_TILE][APRON_TILE];
+
+float luma(vec3 rgb)
+{
+    return 0.299 * rgb.r + 0.578 * rgb.g + 0.144 * rgb.b;
+}
+
+// current frame pixel whose jittered sample lies closest to an output pixel
+ivec2 nearestSample(vec2 outputPixel)
+{
+    return ivec2(floor((outputPixel + 0.5) * renderScale - jitter));
+}
+
+void main()
+{
+    // stage tile and apron, texels outside the frame repeat the edge
+    ivec2 origin = nearestSample(vec2(gl_WorkGroupID.xy * TILE)) - 1;
+    ivec2 last   = ivec2(frameRes) - 1;
+    for (uint i = gl_LocalInvocationIndex; i < APRON_TILE * APRON_TILE; i += TILE * TILE)
+    {
+        ivec2 t        = ivec2(i % APRON_TILE, i / APRON_TILE);
+        tile[t.y][t.x] = texelFetch(currFrame, clamp(origin + t, ivec2(0), last), 0).rgb;
+    }
+    barrier();
+
+    if (gid.x >= res.x || gid.y >= res.y) return;
+
+    // filtered sample and color neighborhood
+    bool upsampling  = renderScale < 1.0;
+    ivec2 nearest    = nearestSample(vec2(gid));
+    ivec2 center     = nearest - origin;
+    vec2 position    = (vec2(gid) + 0.5) * renderScale;
+    vec3 color       = vec3(0);
+    float weightSum  = 0.0;
+    float confidence = 1.0;
+    vec3 colorBoxMax = vec3(-1.0 / 0.0);  // -infinity
+    vec3 colorBoxMin = vec3(1.0 / 0.0);   // +infinity
+    for (int i = 0; i < 9; i++)
+    {
+        ivec2 t          = center + offsets[i];
+        vec3 sampleColor = tile[t.y][t.x];
+        float weight     = weights[i / 4][i % 4];
+        if (upsampling)
+        {
+            // gaussian of the distance between sample and output pixel, in output pixels
+            vec2 d = (vec2(nearest + offsets[i]) + 0.5 + jitter - position) / renderScale;
+            weight = exp(-2.29 * dot(d, d));
+            if (i == 4) confidence = weight;
+        }
+        color += sampleColor * weight;
+        weightSum += weight;
+        colorBoxMin = min(colorBoxMin, sampleColor);
+        colorBoxMax = max(colorBoxMax, sampleColor);
+    }
+    if (upsampling) color /= max(weightSum, 1e-6);
+    color = min(color, vec3(1));
+    if (!doFilter) color = tile[center.y][center.x];
+
+    // reprojection
+    vec2 tex_coord      = (vec2(gid) + 0.5) / res;
+    float depth         = texelFetch(currDepth, clamp(nearest, ivec2(0), last), 0).r;
+    vec4 prevNDC        = reProj * vec4(tex_coord * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec2 prev_tex_coord = prevNDC.xy / prevNDC.w * 0.5 + 0.5;
+
+    // no history available (init) or out-of-bounds access
+    vec3 historyColor = texture(history, prev_tex_coord).rgb;
+    if (init || prev_tex_coord != clamp(prev_tex_coord, 0, 1)) historyColor = color;
+
+    if (doClamp) historyColor = clamp(historyColor, colorBoxMin, colorBoxMax);
+
+    float feedback = maxFeedback;
+    if (doDynamicFeedback)
+    {
+        // lower feedback for fast motion and large luma changes
+        float velocity       = length(abs(tex_coord - prev_tex_coord) * res);
+        float lumaDiff       = abs(luma(color) - luma(historyColor));
+        float velocityFactor = 1.0 - smoothstep(0.0, 1.0, velocity);
+        float lumaFactor     = 1.0 - smoothstep(0.0, 0.1, lumaDiff);
+        feedback             = mix(0.7, maxFeedback, velocityFactor * lumaFactor);
+    }
+    // a sample far from the pixel center adds less, the history fills in between samples
+    feedback = 1.0 - (1.0 - feedback) * confidence;
+
+    vec4 result = vec4(mix(color, historyColor, feedback), 1);
+    if (freeze) result = texelFetch(history, ivec2(gid), 0);
+    imageStore(taaOut, ivec2(gid), result);
+}
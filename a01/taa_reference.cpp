@@ -0,0 +1,538 @@
+#include "taa_reference.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define TAA_REFERENCE_SSE 1
+#    include <emmintrin.h>
+#endif
+
+namespace
+{
+// pixels per tile, rows of a tile are contiguous so the planes stream through the cache
+const unsigned TILE_WIDTH  = 128;
+const unsigned TILE_HEIGHT = 16;
+// lowest feedback of the dynamic feedback, as in the shaders
+const float MIN_FEEDBACK = 0.7f;
+
+const int OFFSETS[9][2] = {{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {0, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+
+float luma(glm::fvec3 const& rgb) { return 0.299f * rgb.r + 0.578f * rgb.g + 0.144f * rgb.b; }
+
+float smoothstep(float edge0, float edge1, float x)
+{
+    float t = glm::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// texture() with linear filtering and repeat wrapping
+glm::fvec3 sampleBilinear(TaaImage const& image, float u, float v)
+{
+    float x  = u * float(image.size.x) - 0.5f;
+    float y  = v * float(image.size.y) - 0.5f;
+    float x0 = std::floor(x);
+    float y0 = std::floor(y);
+    float fx = x - x0;
+    float fy = y - y0;
+    int w    = int(image.size.x);
+    int h    = int(image.size.y);
+    // coordinates within 0 and 1 wrap by at most one texel
+    auto texel = [&](int tx, int ty) {
+        tx = tx < 0 ? tx + w : (tx >= w ? tx - w : tx);
+        ty = ty < 0 ? ty + h : (ty >= h ? ty - h : ty);
+        return glm::fvec3(image.texels[std::size_t(ty) * image.size.x + std::size_t(tx)]);
+    };
+    int ix = int(x0), iy = int(y0);
+    glm::fvec3 bottom = glm::mix(texel(ix, iy), texel(ix + 1, iy), fx);
+    glm::fvec3 top    = glm::mix(texel(ix, iy + 1), texel(ix + 1, iy + 1), fx);
+    return glm::mix(bottom, top, fy);
+}
+
+// everything one pixel needs besides the filtered color, shared by both code paths
+struct PixelInputs
+{
+    TaaBlock const& taa;
+    TaaImage const& history;
+    float const* depth;
+};
+
+glm::fvec4 resolvePixel(PixelInputs const& in, std::vector<float> const* planes, unsigned x, unsigned y)
+{
+    TaaBlock const& taa = in.taa;
+    std::size_t stride  = taa.res.x + 2;
+    std::size_t center  = (y + 1) * stride + x + 1;
+
+    glm::fvec3 color{0.0f};
+    glm::fvec3 boxMin{INFINITY};
+    glm::fvec3 boxMax{-INFINITY};
+    for (int i = 0; i < 9; ++i)
+    {
+        std::size_t index = std::size_t(std::ptrdiff_t(center) + OFFSETS[i][1] * std::ptrdiff_t(stride) + OFFSETS[i][0]);
+        glm::fvec3 sample{planes[0][index], planes[1][index], planes[2][index]};
+        color += sample * taa.weights[i / 4][i % 4];
+        boxMin = glm::min(boxMin, sample);
+        boxMax = glm::max(boxMax, sample);
+    }
+    color = glm::min(color, glm::fvec3(1.0f));
+    if (!taa.doFilter)
+    {
+        color = glm::fvec3{planes[0][center], planes[1][center], planes[2][center]};
+    }
+
+    glm::fvec2 res{taa.res};
+    glm::fvec2 texCoord = (glm::fvec2(x, y) + 0.5f) / res;
+    float depth         = in.depth[std::size_t(y) * taa.res.x + x];
+    glm::fvec4 prevNDC  = taa.reProj * glm::fvec4(texCoord * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+    glm::fvec2 prevTex  = glm::fvec2(prevNDC) / prevNDC.w * 0.5f + 0.5f;
+
+    bool inside = prevTex.x >= 0.0f && prevTex.x <= 1.0f && prevTex.y >= 0.0f && prevTex.y <= 1.0f;
+    glm::fvec3 historyColor = color;
+    if (!taa.init && inside)
+    {
+        historyColor = sampleBilinear(in.history, prevTex.x, prevTex.y);
+    }
+    if (taa.doClamp)
+    {
+        historyColor = glm::min(glm::max(historyColor, boxMin), boxMax);
+    }
+
+    float feedback = taa.maxFeedback;
+    if (taa.doDynamicFeedback)
+    {
+        float velocity       = glm::length(glm::abs(texCoord - prevTex) * res);
+        float lumaDiff       = std::abs(luma(color) - luma(historyColor));
+        float velocityFactor = 1.0f - smoothstep(0.0f, 1.0f, velocity);
+        float lumaFactor     = 1.0f - smoothstep(0.0f, 0.1f, lumaDiff);
+        feedback             = glm::mix(MIN_FEEDBACK, taa.maxFeedback, velocityFactor * lumaFactor);
+    }
+    glm::fvec4 result{glm::mix(color, historyColor, feedback), 1.0f};
+    if (taa.freeze)
+    {
+        result = in.history.texels[std::size_t(y) * taa.res.x + x];
+    }
+    return result;
+}
+
+#ifdef TAA_REFERENCE_SSE
+__m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+__m128 clamp01(__m128 x) { return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+
+__m128 smoothstep(float edge0, float edge1, __m128 x)
+{
+    __m128 t = clamp01(_mm_div_ps(_mm_sub_ps(x, _mm_set1_ps(edge0)), _mm_set1_ps(edge1 - edge0)));
+    return _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t)));
+}
+
+__m128 luma(__m128 r, __m128 g, __m128 b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(0.299f)), _mm_mul_ps(g, _mm_set1_ps(0.578f))),
+                      _mm_mul_ps(b, _mm_set1_ps(0.144f)));
+}
+
+// row of a column major matrix applied to (x, y, z, 1)
+__m128 transformRow(glm::fmat4 const& m, int row, __m128 x, __m128 y, __m128 z)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0][row]), x), _mm_mul_ps(_mm_set1_ps(m[1][row]), y)),
+                      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2][row]), z), _mm_set1_ps(m[3][row])));
+}
+
+// pixels x to x + 3 of row y, the same steps as resolvePixel on four lanes
+void resolveQuad(PixelInputs const& in, std::vector<float> const* planes, unsigned x, unsigned y, glm::fvec4* out)
+{
+    TaaBlock const& taa = in.taa;
+    std::size_t stride  = taa.res.x + 2;
+    std::size_t center  = (y + 1) * stride + x + 1;
+
+    __m128 color[3] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+    __m128 boxMin[3], boxMax[3], middle[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        boxMin[c] = _mm_set1_ps(INFINITY);
+        boxMax[c] = _mm_set1_ps(-INFINITY);
+    }
+    for (int i = 0; i < 9; ++i)
+    {
+        std::size_t index = std::size_t(std::ptrdiff_t(center) + OFFSETS[i][1] * std::ptrdiff_t(stride) + OFFSETS[i][0]);
+        __m128 weight     = _mm_set1_ps(taa.weights[i / 4][i % 4]);
+        for (int c = 0; c < 3; ++c)
+        {
+            __m128 sample = _mm_loadu_ps(&planes[c][index]);
+            color[c]      = _mm_add_ps(color[c], _mm_mul_ps(sample, weight));
+            boxMin[c]     = _mm_min_ps(boxMin[c], sample);
+            boxMax[c]     = _mm_max_ps(boxMax[c], sample);
+            if (i == 4)
+            {
+                middle[c] = sample;
+            }
+        }
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        color[c] = taa.doFilter ? _mm_min_ps(color[c], _mm_set1_ps(1.0f)) : middle[c];
+    }
+
+    __m128 resX     = _mm_set1_ps(float(taa.res.x));
+    __m128 resY     = _mm_set1_ps(float(taa.res.y));
+    __m128 texX     = _mm_div_ps(_mm_add_ps(_mm_set1_ps(float(x) + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f)), resX);
+    __m128 texY     = _mm_div_ps(_mm_set1_ps(float(y) + 0.5f), resY);
+    __m128 depth    = _mm_loadu_ps(in.depth + std::size_t(y) * taa.res.x + x);
+    __m128 one      = _mm_set1_ps(1.0f);
+    __m128 half     = _mm_set1_ps(0.5f);
+    __m128 ndcX     = _mm_sub_ps(_mm_add_ps(texX, texX), one);
+    __m128 ndcY     = _mm_sub_ps(_mm_add_ps(texY, texY), one);
+    __m128 ndcZ     = _mm_sub_ps(_mm_add_ps(depth, depth), one);
+    __m128 prevW    = transformRow(taa.reProj, 3, ndcX, ndcY, ndcZ);
+    __m128 prevTexX = _mm_add_ps(_mm_mul_ps(_mm_div_ps(transformRow(taa.reProj, 0, ndcX, ndcY, ndcZ), prevW), half), half);
+    __m128 prevTexY = _mm_add_ps(_mm_mul_ps(_mm_div_ps(transformRow(taa.reProj, 1, ndcX, ndcY, ndcZ), prevW), half), half);
+
+    // nan coordinates count as outside like in the shader
+    __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(prevTexX, _mm_setzero_ps()), _mm_cmple_ps(prevTexX, one)),
+                               _mm_and_ps(_mm_cmpge_ps(prevTexY, _mm_setzero_ps()), _mm_cmple_ps(prevTexY, one)));
+    if (taa.init)
+    {
+        inside = _mm_setzero_ps();
+    }
+
+    // bilinear history fetches have no vector form without gathers, the lanes sample one by one
+    alignas(16) float u[4], v[4], lanes[3][4] = {};
+    alignas(16) int fetch[4];
+    _mm_store_ps(u, prevTexX);
+    _mm_store_ps(v, prevTexY);
+    _mm_store_si128(reinterpret_cast<__m128i*>(fetch), _mm_castps_si128(inside));
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        if (fetch[lane])
+        {
+            glm::fvec3 sample = sampleBilinear(in.history, u[lane], v[lane]);
+            lanes[0][lane]    = sample.r;
+            lanes[1][lane]    = sample.g;
+            lanes[2][lane]    = sample.b;
+        }
+    }
+    __m128 history[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        history[c] = select(inside, _mm_load_ps(lanes[c]), color[c]);
+        if (taa.doClamp)
+        {
+            history[c] = _mm_min_ps(_mm_max_ps(history[c], boxMin[c]), boxMax[c]);
+        }
+    }
+
+    __m128 feedback = _mm_set1_ps(taa.maxFeedback);
+    if (taa.doDynamicFeedback)
+    {
+        __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 velX     = _mm_mul_ps(_mm_andnot_ps(signMask, _mm_sub_ps(texX, prevTexX)), resX);
+        __m128 velY     = _mm_mul_ps(_mm_andnot_ps(signMask, _mm_sub_ps(texY, prevTexY)), resY);
+        __m128 velocity = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(velX, velX), _mm_mul_ps(velY, velY)));
+        __m128 lumaDiff = _mm_andnot_ps(
+            signMask, _mm_sub_ps(luma(color[0], color[1], color[2]), luma(history[0], history[1], history[2])));
+        __m128 factor = _mm_mul_ps(_mm_sub_ps(one, smoothstep(0.0f, 1.0f, velocity)),
+                                   _mm_sub_ps(one, smoothstep(0.0f, 0.1f, lumaDiff)));
+        __m128 lowest = _mm_set1_ps(MIN_FEEDBACK);
+        feedback      = _mm_add_ps(_mm_mul_ps(lowest, _mm_sub_ps(one, factor)), _mm_mul_ps(feedback, factor));
+    }
+
+    if (taa.freeze)
+    {
+        std::copy_n(&in.history.texels[std::size_t(y) * taa.res.x + x], 4, out);
+        return;
+    }
+    __m128 keep = _mm_sub_ps(one, feedback);
+    __m128 r    = _mm_add_ps(_mm_mul_ps(color[0], keep), _mm_mul_ps(history[0], feedback));
+    __m128 g    = _mm_add_ps(_mm_mul_ps(color[1], keep), _mm_mul_ps(history[1], feedback));
+    __m128 b    = _mm_add_ps(_mm_mul_ps(color[2], keep), _mm_mul_ps(history[2], feedback));
+    __m128 a    = one;
+    // planar to rgba texels
+    _MM_TRANSPOSE4_PS(r, g, b, a);
+    float* texels = &out[0].x;
+    _mm_storeu_ps(texels, r);
+    _mm_storeu_ps(texels + 4, g);
+    _mm_storeu_ps(texels + 8, b);
+    _mm_storeu_ps(texels + 12, a);
+}
+#endif
+}  // namespace
+
+std::array<float, 9> taaFilterWeights(glm::fvec2 const& jitter)
+{
+    std::array<float, 9> weights{};
+    float weightSum = 0.0f;
+    for (int i = 0; i < 9; i++)
+    {
+        // squared distance of the jittered middle pixel to each neighbor
+        glm::fvec2 offset{float(OFFSETS[i][0]), float(OFFSETS[i][1])};
+        float distance = glm::distance(jitter, offset);
+        weights[i]     = std::exp(-2.29f * (distance * distance));
+        weightSum += weights[i];
+    }
+    for (auto& weight : weights)
+    {
+        weight /= weightSum;
+    }
+    return weights;
+}
+
+TaaDifference compareTaaImages(TaaImage const& lhs, TaaImage const& rhs, float tolerance, unsigned border)
+{
+    if (lhs.size != rhs.size)
+    {
+        throw std::invalid_argument("compareTaaImages: images differ in size");
+    }
+    TaaDifference difference{};
+    for (unsigned y = border; y + border < lhs.size.y; ++y)
+    {
+        for (unsigned x = border; x + border < lhs.size.x; ++x)
+        {
+            std::size_t index = std::size_t(y) * lhs.size.x + x;
+            glm::fvec3 error  = glm::abs(glm::fvec3(lhs.texels[index]) - glm::fvec3(rhs.texels[index]));
+            float largest     = glm::max(error.r, glm::max(error.g, error.b));
+            difference.max_error = std::max(difference.max_error, largest);
+            // nan never passes
+            if (!(largest <= tolerance))
+            {
+                ++difference.failed;
+            }
+            ++difference.compared;
+        }
+    }
+    return difference;
+}
+
+TaaReference::TaaReference(unsigned threads, bool simd) : m_pool{}, m_simd{simd}, m_planes{}
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // the calling thread works too
+    if (threads > 1)
+    {
+        m_pool.reset(new ThreadPool{threads - 1});
+    }
+#ifndef TAA_REFERENCE_SSE
+    m_simd = false;
+#endif
+}
+
+unsigned TaaReference::threads() const { return m_pool ? unsigned(m_pool->size()) + 1 : 1; }
+
+bool TaaReference::simd() const { return m_simd; }
+
+void TaaReference::parallel(unsigned count, std::function<void(unsigned)> const& task)
+{
+    std::atomic<unsigned> next{0};
+    auto work = [&]() {
+        for (unsigned i = next++; i < count; i = next++)
+        {
+            task(i);
+        }
+    };
+    unsigned helpers = m_pool ? std::min(unsigned(m_pool->size()), count) : 0;
+    std::mutex mutex{};
+    std::condition_variable finished{};
+    unsigned running = helpers;
+    for (unsigned i = 0; i < helpers; ++i)
+    {
+        m_pool->submit([&]() {
+            work();
+            std::lock_guard<std::mutex> lock{mutex};
+            if (--running == 0)
+            {
+                finished.notify_one();
+            }
+        });
+    }
+    work();
+    std::unique_lock<std::mutex> lock{mutex};
+    finished.wait(lock, [&]() { return running == 0; });
+}
+
+void TaaReference::resolve(TaaBlock const& taa, TaaImage const& frame, std::vector<float> const& depth,
+                           TaaImage const& history, TaaImage& result)
+{
+    glm::uvec2 res = taa.res;
+    if (taa.frameRes != res || frame.size != res || history.size != res || depth.size() != frame.texels.size())
+    {
+        throw std::invalid_argument("TaaReference: frame, depth and history must match the output resolution");
+    }
+    result.size = res;
+    result.texels.resize(frame.texels.size());
+
+    // split the frame into channels with an apron
+    std::size_t stride = res.x + 2;
+    for (auto& plane : m_planes)
+    {
+        plane.resize(stride * (res.y + 2));
+    }
+    parallel(res.y + 2,
+             [&](unsigned row) {
+                 unsigned y = unsigned(glm::clamp(int(row) - 1, 0, int(res.y) - 1));
+                 glm::fvec4 const* source = &frame.texels[std::size_t(y) * res.x];
+                 for (int c = 0; c < 3; ++c)
+                 {
+                     float* target = &m_planes[c][row * stride];
+                     target[0]     = source[0][c];
+                     for (unsigned x = 0; x < res.x; ++x)
+                     {
+                         target[x + 1] = source[x][c];
+                     }
+                     target[res.x + 1] = source[res.x - 1][c];
+                 }
+             });
+
+    PixelInputs inputs{taa, history, depth.data()};
+    glm::uvec2 tiles = (res + glm::uvec2(TILE_WIDTH - 1, TILE_HEIGHT - 1)) / glm::uvec2(TILE_WIDTH, TILE_HEIGHT);
+    parallel(tiles.x * tiles.y,
+             [&](unsigned tile) {
+                 unsigned x0 = (tile % tiles.x) * TILE_WIDTH;
+                 unsigned y0 = (tile / tiles.x) * TILE_HEIGHT;
+                 unsigned x1 = std::min(x0 + TILE_WIDTH, res.x);
+                 unsigned y1 = std::min(y0 + TILE_HEIGHT, res.y);
+                 for (unsigned y = y0; y < y1; ++y)
+                 {
+                     unsigned x = x0;
+#ifdef TAA_REFERENCE_SSE
+                     for (; m_simd && x + 4 <= x1; x += 4)
+                     {
+                         resolveQuad(inputs, m_planes, x, y, &result.texels[std::size_t(y) * res.x + x]);
+                     }
+#endif
+                     for (; x < x1; ++x)
+                     {
+                         result.texels[std::size_t(y) * res.x + x] = resolvePixel(inputs, m_planes, x, y);
+                     }
+                 }
+             });
+}
+
+int benchmarkTaaReference(std::string const& size, std::ostream& out)
+{
+    // both dimensions positive decimal numbers, the whole argument consumed
+    glm::uvec2 res{0u};
+    std::string::size_type split = size.find('x');
+    if (split != std::string::npos)
+    {
+        try
+        {
+            std::string const dims[2] = {size.substr(0, split), size.substr(split + 1)};
+            for (int i = 0; i < 2; ++i)
+            {
+                std::size_t end     = 0;
+                unsigned long value = std::stoul(dims[i], &end);
+                if (end != dims[i].size() || dims[i][0] == '-' || value > std::numeric_limits<unsigned>::max())
+                {
+                    throw std::invalid_argument{dims[i]};
+                }
+                res[i] = unsigned(value);
+            }
+        }
+        catch (std::invalid_argument const&)
+        {
+            res = glm::uvec2{0u};
+        }
+        catch (std::out_of_range const&)
+        {
+            res = glm::uvec2{0u};
+        }
+    }
+    if (res.x == 0 || res.y == 0)
+    {
+        std::cerr << "--taa-cpu-benchmark expects WIDTHxHEIGHT with both sizes above 0, got " << size << std::endl;
+        return EXIT_FAILURE;
+    }
+    const unsigned frames = 32;
+
+    // a camera circling a textured slope, every frame jittered like the application
+    std::size_t pixels = std::size_t(res.x) * res.y;
+    std::vector<TaaImage> sequence(frames, TaaImage{res, std::vector<glm::fvec4>(pixels)});
+    std::vector<std::vector<float>> depths(frames, std::vector<float>(pixels));
+    std::vector<TaaBlock> blocks(frames);
+    glm::fmat4 projection = glm::perspective(glm::radians(70.0f), float(res.x) / float(res.y), 1.0f, 100.0f);
+    glm::fmat4 prevView{1.0f};
+    for (unsigned frame = 0; frame < frames; ++frame)
+    {
+        float angle     = 0.01f * float(frame);
+        glm::fmat4 view = glm::lookAt(glm::fvec3(std::sin(angle), 0.5f, std::cos(angle)) * 20.0f, glm::fvec3(0.0f),
+                                      glm::fvec3(0.0f, 1.0f, 0.0f));
+        glm::fvec2 jitter{std::fmod(0.618f * float(frame), 1.0f) * 2.0f - 1.0f,
+                          std::fmod(0.382f * float(frame), 1.0f) * 2.0f - 1.0f};
+        for (unsigned y = 0; y < res.y; ++y)
+        {
+            for (unsigned x = 0; x < res.x; ++x)
+            {
+                float checker = float(((x + frame) / 8 + y / 8) % 2);
+                sequence[frame].texels[std::size_t(y) * res.x + x] =
+                    glm::fvec4(0.2f + 0.6f * checker, float(x) / float(res.x), float(y) / float(res.y), 1.0f);
+                depths[frame][std::size_t(y) * res.x + x] = 0.9f + 0.09f * float(y) / float(res.y);
+            }
+        }
+        TaaBlock& taa = blocks[frame];
+        taa           = TaaBlock{};
+        auto weights  = taaFilterWeights(jitter);
+        for (int i = 0; i < 9; ++i)
+        {
+            taa.weights[i / 4][i % 4] = weights[i];
+        }
+        taa.reProj            = projection * prevView * glm::inverse(view) * glm::inverse(projection);
+        taa.res               = res;
+        taa.frameRes          = res;
+        taa.renderScale       = 1.0f;
+        taa.jitter            = jitter * 0.5f;
+        taa.maxFeedback       = 0.95f;
+        taa.init              = frame == 0;
+        taa.doFilter          = true;
+        taa.doClamp           = true;
+        taa.doDynamicFeedback = true;
+        prevView              = view;
+    }
+
+    // every path on one thread, then on all of them if there are more
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::pair<unsigned, bool>> variants{{1, false}, {1, true}};
+    if (hardware > 1)
+    {
+        variants.push_back({hardware, false});
+        variants.push_back({hardware, true});
+    }
+    std::vector<TaaImage> results(variants.size(), TaaImage{});
+    out << "taa cpu reference " << res.x << "x" << res.y << ", " << frames << " frames" << std::endl;
+    for (std::size_t v = 0; v < variants.size(); ++v)
+    {
+        TaaReference reference{variants[v].first, variants[v].second};
+        TaaImage history{res, std::vector<glm::fvec4>(pixels)};
+        TaaImage& result = results[v];
+        auto start       = std::chrono::steady_clock::now();
+        for (unsigned frame = 0; frame < frames; ++frame)
+        {
+            reference.resolve(blocks[frame], sequence[frame], depths[frame], history, result);
+            std::swap(history, result);
+        }
+        std::swap(history, result);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        out << std::left << std::setw(7) << (reference.simd() ? "sse" : "scalar") << std::right
+            << std::setw(3) << reference.threads() << " threads " << std::fixed << std::setprecision(1)
+            << std::setw(8) << double(pixels) * frames / seconds * 1e-6 << " Mpixels/s" << std::endl;
+    }
+    // both paths round differently but must accumulate to the same image
+    TaaDifference difference = compareTaaImages(results.front(), results.back(), 1e-4f);
+    out << "scalar and sse differ by at most " << std::scientific << std::setprecision(2) << difference.max_error
+        << std::endl;
+    return difference.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
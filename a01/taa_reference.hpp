@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glbinding/gl/types.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include "thread_pool.hpp"
+
+// std140 block of the taa shaders, bools are 4 byte uints
+struct TaaBlock
+{
+    glm::fmat4 reProj;
+    // 3x3 filter weights, packed since std140 pads scalar arrays to vec4
+    glm::fvec4 weights[3];
+    glm::uvec2 res;
+    float maxFeedback;
+    GLuint init;
+    GLuint freeze;
+    GLuint doFilter;
+    GLuint doClamp;
+    GLuint doDynamicFeedback;
+    glm::fvec2 jitter;
+    glm::uvec2 frameRes;
+    float renderScale;
+    // std140 rounds the block size up to a vec4
+    float padding[3];
+};
+
+// normalized 3x3 gaussian weights around a sample jittered by -1 to 1 pixels
+std::array<float, 9> taaFilterWeights(glm::fvec2 const& jitter);
+
+// rgba texels as read back with glGetTexImage, rows from bottom to top
+struct TaaImage
+{
+    glm::uvec2 size;
+    std::vector<glm::fvec4> texels;
+};
+
+// largest channel difference and pixels differing by more than the tolerance
+struct TaaDifference
+{
+    float max_error      = 0.0f;
+    std::size_t failed   = 0;
+    std::size_t compared = 0;
+};
+// pixels within border of the image edge are skipped, taa.cs.glsl does not write row and
+// column 0 and fetches outside the frame along the opposite edges
+TaaDifference compareTaaImages(TaaImage const& lhs, TaaImage const& rhs, float tolerance, unsigned border = 0);
+
+// the resolve of taa_tiled.cs.glsl at render scale 1 on the cpu, which equals taa.cs.glsl
+// away from the image border, for checking gpu output and for resolving without a gpu
+// tiles are spread over the threads, each row of a tile is resolved 4 pixels at a time with sse
+class TaaReference
+{
+   public:
+    // threads = 0 uses every hardware thread, simd = false runs the scalar code path
+    explicit TaaReference(unsigned threads = 0, bool simd = true);
+    TaaReference(TaaReference const&) = delete;
+    TaaReference& operator=(TaaReference const&) = delete;
+
+    // frame, depth and history as the shader samples them, history is read with bilinear
+    // filtering and repeat wrapping like the history texture
+    void resolve(TaaBlock const& taa, TaaImage const& frame, std::vector<float> const& depth,
+                 TaaImage const& history, TaaImage& result);
+
+    unsigned threads() const;
+    // false where the build has no sse, every resolve then runs the scalar path
+    bool simd() const;
+
+   private:
+    // run task(0) to task(count - 1) on the pool and the calling thread
+    void parallel(unsigned count, std::function<void(unsigned)> const& task);
+
+    std::unique_ptr<ThreadPool> m_pool;
+    bool m_simd;
+    // frame channels with a one pixel apron repeating the edge, the 3x3 loads need no checks
+    std::vector<float> m_planes[3];
+};
+
+// resolve a synthetic sequence at the given WIDTHxHEIGHT with the scalar and sse paths
+// on one and on all threads, prints Mpixels/s and returns the process exit code
+int benchmarkTaaReference(std::string const& size, std::ostream& out);
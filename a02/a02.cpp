@@ -5,92 +5,183 @@
 #include <glbinding/gl/functions.h>
 #include <glm/gtx/transform.hpp>
 
+#include <cstring>
+
+#include "gl_state.hpp"
 #include "shader_loader.hpp"
+#include "texture_codec.hpp"
 
 void Assignment02::render()
 {
-    renderMap();
-    switch (assignmentNr)
+    // keep showing the previous map while the selected one loads
+    if (nextEnvMap.resident())
     {
-        case 0:
-            renderObject(shader("shaderA"));
-            break;
-        case 1:
-            renderObject(shader("shaderB"));
-            break;
-        case 2:
-            glUseProgram(shader("shaderC"));
-            uniform("shaderC", "glossyRays", glossyRays);
-            uniform("shaderC", "roughness", roughness);
-            renderObject(shader("shaderC"));
-            break;
+        envMap              = nextEnvMap;
+        useCylindricMapping = envMapID == 1;
+        nextEnvMap          = StreamedTexture{};
+        prefilterDirty      = true;
+    }
+    else if (nextEnvMap.failed())
+    {
+        envMapID   = useCylindricMapping ? 1 : 0;
+        nextEnvMap = StreamedTexture{};
+    }
+    if (prefilterDirty && envMap.resident())
+    {
+        auto scope = profile("prefilter");
+        prefilterEnvMap();
+        prefilterDirty = false;
     }
-}
-
-void Assignment02::renderMap() const
-{
-    glClearColor(0.2f, 0.2f, 0.2f, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    glUseProgram(shader("map"));
 
-    uniform("map", "envMap", 0);
-    uniform("map", "debugUV", debugUV);
+    CameraBlock camera{viewMatrix(), projectionMatrix()};
+    uniformBlock(CAMERA_BLOCK, camera);
 
-    uniform("map", "viewMatrix", viewMatrix());
-    uniform("map", "projMatrix", projectionMatrix());
-    uniform("map", "modelMatrix", glm::mat4(1));
+    drawQueue.clear();
+    queueMap();
+    char const* programs[] = {"shaderA", "shaderB", "shaderC"};
+    queueObject(shader(programs[assignmentNr]));
+    drawQueue.submit(sortDraws);
+}
 
-    envSphere.draw();
+void Assignment02::queueMap()
+{
+    DrawItem item{};
+    // the sky covers every pixel and writes far plane depth, which replaces both clears, so it
+    // goes first
+    item.layer       = 0;
+    item.program     = shader("map");
+    item.textures[0] = envMap.index();
+    item.mesh        = sky.vertexArray();
+    item.draw        = [this]() {
+        auto scope = profile("renderMap");
+        uniform("map", "envMap", 0);
+        uniform("map", "cylindricMapping", useCylindricMapping);
+        uniform("map", "debugUV", debugUV);
 
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glUseProgram(0);
+        gl_state::depth_func(GL_ALWAYS);
+        sky.draw();
+        gl_state::depth_func(GL_LESS);
+    };
+    drawQueue.add(std::move(item));
 }
 
-void Assignment02::renderObject(GLuint program) const
+void Assignment02::prefilterEnvMap()
 {
-    glUseProgram(program);
-
-    uniform(program, "envMap", 0);
-    uniform(program, "cylindricMapping", useCylindricMapping);
-    uniform(program, "debugUV", debugUV);
+    // level 1 blurs over about two of its own texels, each further level halves the
+    // resolution and doubles the lobe, until the largest roughness is covered
+    glm::uvec2 const size    = envMap.dimensions();
+    float const texel_angle  = std::max(2.0f * float(M_PI) / float(size.x), float(M_PI) / float(size.y));
+    prefilteredRoughness     = 2.0f * texel_angle;
+    unsigned const max_level = texture_codec::level_count(size) - 1;
+    prefilteredLevels        = 2;
+    while (prefilteredLevels <= max_level &&
+           prefilteredRoughness * float(1u << (prefilteredLevels - 2)) < MAX_ROUGHNESS)
+    {
+        ++prefilteredLevels;
+    }
+    prefilteredLevels = std::min(prefilteredLevels, max_level + 1);
+    prefilteredMap    = Tex{size, GL_RGBA16F, prefilteredLevels};
 
-    uniform(program, "viewMatrix", viewMatrix());
-    uniform(program, "projMatrix", projectionMatrix());
+    // creating the texture replaced the binding of the active unit
+    gl_state::bind_texture(0, GL_TEXTURE_2D, envMap.index());
+    gl_state::use_program(shader("prefilter"));
+    uniform("prefilter", "cylindricMapping", useCylindricMapping);
+    uniform("prefilter", "sampleCount", PREFILTER_SAMPLES);
+    glm::ivec3 const& work_size = shaderInfo("prefilter").work_group_size;
+    for (unsigned level = 0; level < prefilteredLevels; ++level)
+    {
+        glm::uvec2 const level_size = texture_codec::level_dimensions(size, level);
+        uniform("prefilter", "roughness", level == 0 ? 0.0f : prefilteredRoughness * float(1u << (level - 1)));
+        gl_state::bind_image_texture(0, prefilteredMap.index(), GLint(level), GL_FALSE, 0, GL_WRITE_ONLY,
+                                     GL_RGBA16F);
+        glDispatchCompute((level_size.x + work_size.x - 1) / work_size.x, (level_size.y + work_size.y - 1) / work_size.y,
+                          1);
+    }
+    gl_state::bind_image_texture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
 
+void Assignment02::queueObject(GLuint program)
+{
     auto R = glm::rotate(objectRotation, glm::fvec3(0, 1, 0));
     auto T = glm::translate(glm::fvec3(0, -0.33, 0));
-    switch(objectID){
-        case 0: 
-            uniform(program, "modelMatrix", T*R*glm::scale(glm::fvec3(1,1,1)));
-            sphere.draw();
-        break;
-        case 1:
-            uniform(program, "modelMatrix", T*R*glm::scale(glm::fvec3(2,2,2)));
-            teaPot.draw();
-        break;
-        case 2:
-            uniform(program, "modelMatrix", T*R*glm::scale(glm::fvec3(.1f,.1f,.1f)));
-            bunny.draw();
-        break;
+    simpleModel const* models[] = {&sphere, &teaPot, &bunny};
+    const float scales[]        = {1.0f, 2.0f, 0.1f};
+    simpleModel const& model    = *models[objectID];
+    glm::fmat4 modelMatrix      = T * R * glm::scale(glm::fvec3(scales[objectID]));
+    Bounds const world      = transform_bounds(model.bounds(), modelMatrix);
+    // the object fills most of the view, it is only culled when looking past it
+    objectVisible = intersects(extract_frustum(projectionMatrix() * viewMatrix()), world);
+    if (!objectVisible)
+    {
+        return;
     }
+    objectLod = useLod ? model.selectLod(world, viewMatrix(), projectionMatrix(), float(resolution().y), lodPixelError)
+                       : 0;
 
-    glUseProgram(0);
+    DrawItem item{};
+    item.layer       = 1;
+    item.program     = program;
+    item.textures[0] = envMap.index();
+    bool glossy      = program == shader("shaderC");
+    if (glossy)
+    {
+        item.textures[1] = prefilteredMap.index();
+    }
+    item.mesh = model.vertexArray();
+    item.draw = [this, program, glossy, modelMatrix, &model]() {
+        auto scope = profile("renderObject");
+        uniform(program, "envMap", 0);
+        uniform(program, "cylindricMapping", useCylindricMapping);
+        uniform(program, "debugUV", debugUV);
+        if (glossy)
+        {
+            glossyRays_uniform.set(glossyRays);
+            roughness_uniform.set(roughness);
+            usePrefiltered_uniform.set(glossyMode == 1);
+            prefilteredRoughness_uniform.set(prefilteredRoughness);
+            prefilteredMaxLevel_uniform.set(float(prefilteredLevels - 1));
+            prefilteredMap_uniform.set(1);
+        }
+        uniform(program, "modelMatrix", modelMatrix);
+        model.draw(objectLod);
+    };
+    drawQueue.add(std::move(item));
 }
 
 Assignment02::Assignment02(std::string const& resource_path)
     : Application{resource_path},
-      envMap{m_resource_path + "/data/waterfall.png"},
+      glossyRays_uniform{},
+      roughness_uniform{},
+      usePrefiltered_uniform{},
+      prefilteredMap_uniform{},
+      prefilteredRoughness_uniform{},
+      prefilteredMaxLevel_uniform{},
+      envMap{textureStreamer().load(m_resource_path + "/data/waterfall.png")},
+      nextEnvMap{},
+      prefilteredMap{glm::uvec2{1, 1}, GL_RGBA16F},
       teaPot{m_resource_path + "/data/teapot.obj"},
       sphere{m_resource_path + "/data/sphere.obj"},
       bunny{m_resource_path + "/data/bunny.obj"},
-      envSphere{60, 1000, 1000}
+      sky{},
+      drawQueue{}
 {
     m_cam = cameraSystem{glm::fvec3(1.5f, 1.5f, 1.5f)};
     updateCamera();
 
-    initializeObjects();
     initializeShaderPrograms();
+
+    // settings a recorded flythrough is replayed with, not the environment map as switching it
+    // streams the texture in over several frames
+    recordParameter("assignmentNr", assignmentNr);
+    recordParameter("objectID", objectID);
+    recordParameter("objectRotation", objectRotation);
+    recordParameter("debugUV", debugUV);
+    recordParameter("glossyMode", glossyMode);
+    recordParameter("glossyRays", glossyRays);
+    recordParameter("roughness", roughness);
+    recordParameter("useLod", useLod);
+    recordParameter("lodPixelError", lodPixelError);
 }
 
 
@@ -105,12 +196,21 @@ void Assignment02::initializeShaderPrograms()
                                  {GL_FRAGMENT_SHADER, m_resource_path + "/shader/shaderB.fs.glsl"}});
     initializeShader("shaderC", {{GL_VERTEX_SHADER, m_resource_path + "/shader/shaderC.vs.glsl"},
                                  {GL_FRAGMENT_SHADER, m_resource_path + "/shader/shaderC.fs.glsl"}});
-}
+    initializeShader("prefilter", {{GL_COMPUTE_SHADER, m_resource_path + "/shader/prefilter.cs.glsl"}});
 
-void Assignment02::initializeObjects()
-{
-    glActiveTexture(GL_TEXTURE0);
-    envMap.bind();
+    // glsl 330 has no binding qualifier for blocks
+    for (auto const& program : {"map", "shaderA", "shaderB", "shaderC"})
+    {
+        bindUniformBlock(program, "Camera", CAMERA_BLOCK);
+        checkUniformBlock<CameraBlock>(program, "Camera");
+    }
+
+    glossyRays_uniform           = uniformHandle<int>("shaderC", "glossyRays");
+    roughness_uniform            = uniformHandle<float>("shaderC", "roughness");
+    usePrefiltered_uniform       = uniformHandle<bool>("shaderC", "usePrefiltered");
+    prefilteredMap_uniform       = uniformHandle<int>("shaderC", "prefilteredMap");
+    prefilteredRoughness_uniform = uniformHandle<float>("shaderC", "prefilteredRoughness");
+    prefilteredMaxLevel_uniform  = uniformHandle<float>("shaderC", "prefilteredMaxLevel");
 }
 
 
@@ -124,12 +224,28 @@ void Assignment02::imgui()
         const char* textures[] = {"waterfall.png", "panorama.png"};
         if (ImGui::Combo("envMap", &envMapID, textures, 2))
         {
-            useCylindricMapping = envMapID == 1;
-            envMap = Tex(m_resource_path + "/data/" + textures[envMapID]);
-            initializeObjects();
+            nextEnvMap = textureStreamer().load(m_resource_path + "/data/" + textures[envMapID]);
         }
         const char* objects[] = {"sphere", "teapot", "bunny"};
         ImGui::Combo("object", &objectID, objects, 3);
+        ImGui::Text("%s", objectVisible ? "1 visible, 0 culled" : "0 visible, 1 culled");
+        ImGui::Checkbox("lod", &useLod);
+        if (useLod)
+        {
+            ImGui::SliderFloat("pixel error", &lodPixelError, 0.25f, 16.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+        }
+        simpleModel const* models[] = {&sphere, &teaPot, &bunny};
+        ImGui::Text("lod %zu, %zu of %zu triangles", objectLod, models[objectID]->triangleCount(objectLod),
+                    models[objectID]->triangleCount());
+        for (ProfileMarker const& marker : profiler().latest().markers)
+        {
+            if (std::strcmp(marker.name, "renderObject") == 0)
+            {
+                ImGui::Text("renderObject %6.3f ms", marker.gpu());
+            }
+        }
+        ImGui::Checkbox("sort draws", &sortDraws);
+        ImGui::Text("%zu draws, %zu state changes", drawQueue.size(), drawQueue.stateChanges());
         
         ImGui::Checkbox("debugUV", &debugUV);
         ImGui::SliderFloat("objectRotation", &objectRotation, 0, 2 * M_PI);
@@ -138,8 +254,13 @@ void Assignment02::imgui()
         ImGui::Combo("assignment", &assignmentNr, names, 3);
         if (assignmentNr == 2)
         {
-            ImGui::SliderFloat("roughness", &roughness, 0, 0.1f);
-            ImGui::SliderInt("glossyRays", &glossyRays, 1, 128);
+            ImGui::SliderFloat("roughness", &roughness, 0, MAX_ROUGHNESS);
+            const char* modes[] = {"rays", "prefiltered"};
+            ImGui::Combo("glossy", &glossyMode, modes, 2);
+            if (glossyMode == 0)
+            {
+                ImGui::SliderInt("glossyRays", &glossyRays, 1, 128);
+            }
         }
     }
     ImGui::End();
@@ -147,6 +268,7 @@ void Assignment02::imgui()
 // exe entry point
 int main(int argc, char* argv[])
 {
+    Application::setLaunchOptions(read_launch_options(argc, argv));
     std::string resource_path = read_resource_path(argc, argv);
     Assignment02 application{resource_path};
     application.run(60);  // max fps
@@ -1,10 +1,26 @@
 #pragma once
 #include "application.hpp"
+#include "culling.hpp"
+#include "draw_queue.hpp"
 #include "helper.hpp"
 #include "models.hpp"
 
 #include <glm/glm.hpp>
 
+// per-frame std140 block shared by all programs
+struct CameraBlock
+{
+    glm::fmat4 viewMatrix;
+    glm::fmat4 projMatrix;
+};
+
+static const GLuint CAMERA_BLOCK = 0;
+
+// upper end of the roughness slider, the prefiltered map covers up to here
+static const float MAX_ROUGHNESS = 0.1f;
+// lobe samples per texel of the prefiltered map
+static const int PREFILTER_SAMPLES = 64;
+
 class Assignment02 : public Application
 {
    public:
@@ -21,20 +37,41 @@ class Assignment02 : public Application
    private:
     // common methods
     void initializeShaderPrograms();
-    void initializeObjects();
 
     // special methods
-    void renderMap() const;
-    void renderObject(GLuint program) const;
+    // add the sky and the object to drawQueue
+    void queueMap();
+    void queueObject(GLuint program);
+    // convolve envMap into the roughness levels of prefilteredMap
+    void prefilterEnvMap();
+
+    Uniform<int> glossyRays_uniform;
+    Uniform<float> roughness_uniform;
+    Uniform<bool> usePrefiltered_uniform;
+    Uniform<int> prefilteredMap_uniform;
+    Uniform<float> prefilteredRoughness_uniform;
+    Uniform<float> prefilteredMaxLevel_uniform;
 
-    Tex envMap;
+    // shown map and the one being streamed in, swapped once it is resident
+    StreamedTexture envMap;
+    StreamedTexture nextEnvMap;
+    // glossy reflections of envMap by roughness, rebuilt whenever it changes
+    Tex prefilteredMap;
+    bool prefilterDirty = true;
+    // roughness of level 1, each further level doubles it
+    float prefilteredRoughness = 0.0f;
+    unsigned prefilteredLevels = 1;
 
     // render objects
     simpleModel teaPot;
     simpleModel sphere;
     simpleModel bunny;
 
-    solidSphere envSphere;
+    // background, drawn per pixel from the view direction
+    fullscreenTriangle sky;
+    // draws of the frame, sorted so state changes are made once per group
+    DrawQueue drawQueue;
+    bool sortDraws = true;
 
     bool debugUV = false;
     bool useCylindricMapping = false;
@@ -43,6 +80,13 @@ class Assignment02 : public Application
     int envMapID     = 0;
     int objectID     = 0;
     float objectRotation = 0;
+    // result of the frustum test and the level of detail of the last queued object
+    bool objectVisible    = true;
+    std::size_t objectLod = 0;
+    bool useLod         = true;
+    float lodPixelError = 1.0f;
     int glossyRays   = 16;
+    // 0: glossyRays samples per pixel, 1: one fetch from the prefiltered map
+    int glossyMode   = 1;
     float roughness  = 0.0f;
 };
@@ -0,0 +1,55 @@
+#ifndef DRAW_QUEUE_HPP
+#define DRAW_QUEUE_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+// one draw of a scene, its program, textures and vertex array are bound by the queue before
+// draw runs
+struct DrawItem
+{
+    static const unsigned MAX_TEXTURES = 4;
+
+    // layers are submitted in order, e.g. a sky that replaces the clear before the objects
+    std::uint8_t layer = 0;
+    GLuint program     = 0;
+    // 2d textures of units 0 to MAX_TEXTURES - 1, 0 leaves the unit as it is
+    GLuint textures[MAX_TEXTURES] = {};
+    // vertex array the draw uses, draws of the same mesh are submitted together
+    GLuint mesh = 0;
+    // sets per draw uniforms and issues the draw call
+    std::function<void()> draw{};
+};
+
+// collects the draws of a pass and submits them sorted by layer, program, textures and mesh,
+// so each state change is made once per group instead of once per draw
+class DrawQueue
+{
+   public:
+    void add(DrawItem item);
+    void clear();
+    // sorted or in the order added, bindings go through gl_state
+    void submit(bool sorted = true);
+
+    std::size_t size() const { return m_items.size(); }
+    // program, texture and mesh changes between consecutive draws of the last submit
+    std::size_t stateChanges() const { return m_state_changes; }
+
+   private:
+    // layer, program, textures and mesh from high to low bits, names above the field width
+    // only weaken the grouping
+    static std::uint64_t key(DrawItem const& item);
+
+    std::vector<DrawItem> m_items;
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> m_order;
+    std::size_t m_state_changes = 0;
+};
+
+#endif
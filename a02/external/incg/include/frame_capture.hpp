@@ -0,0 +1,126 @@
+#ifndef FRAME_CAPTURE_HPP
+#define FRAME_CAPTURE_HPP
+
+#include <glbinding/gl/types.h>
+#include <glm/gtc/type_precision.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include "thread_pool.hpp"
+
+// rgba pixels of a captured frame, rows from bottom to top as gl reads them
+struct CapturedImage
+{
+    glm::uvec2 size;
+    // GL_UNSIGNED_BYTE for 8 bit or GL_FLOAT for 32 bit channels
+    GLenum type;
+    std::vector<unsigned char> pixels;
+
+    std::size_t channelCount() const { return std::size_t(size.x) * size.y * 4; }
+    // channel i normalized to 0..1 for 8 bit images
+    float channel(std::size_t i) const;
+};
+
+// png (8 bit rgba) or pfm (portable float map, 32 bit rgb) chosen by extension, channels are
+// converted to the format of the file, throws std::runtime_error if it cannot be written
+void write_image(std::string const& path, CapturedImage const& image);
+// png or pfm as written by write_image, throws std::runtime_error
+CapturedImage read_image(std::string const& path);
+
+struct ImageDifference
+{
+    // largest absolute difference of a channel, in 0..1 for 8 bit images
+    float max_difference;
+    std::size_t pixels_over;
+};
+// per channel difference of two images of the same size, throws std::invalid_argument otherwise
+ImageDifference compare_images(CapturedImage const& lhs, CapturedImage const& rhs, float tolerance);
+
+// reads frames back without stalling the pipeline
+// each capture packs the pixels into the next buffer of a ring and fences it, update() hands
+// buffers whose fence has passed to a copy thread, which frees the buffer and queues the pixels
+// for the encoding workers
+// when the whole ring is still in flight the capture is dropped instead of waiting
+class FrameCapture
+{
+   public:
+    // runs on an encoding worker after the pixels have been copied out of the ring
+    using Sink = std::function<void(CapturedImage&)>;
+
+    // threads encoding images besides the copy thread
+    explicit FrameCapture(unsigned ring_size = 4, unsigned threads = 1);
+    FrameCapture(FrameCapture const&) = delete;
+    FrameCapture& operator=(FrameCapture const&) = delete;
+    // finishes outstanding captures
+    ~FrameCapture();
+
+    // color attachment 0 of a framebuffer, 0 is the default framebuffer's back buffer
+    bool captureFramebuffer(GLuint framebuffer, glm::uvec2 const& size, GLenum type, Sink sink);
+    // level 0 of a 2d texture, converted to rgba of the given type
+    bool captureTexture(GLuint texture, glm::uvec2 const& size, GLenum type, Sink sink);
+    // as above, written to path as png or pfm, which also selects the type that is read
+    bool captureFramebuffer(GLuint framebuffer, glm::uvec2 const& size, std::string const& path);
+    bool captureTexture(GLuint texture, glm::uvec2 const& size, std::string const& path);
+
+    // hand finished reads to the workers, call once per frame
+    void update();
+    // wait for every capture and its sink
+    void flush();
+
+    std::size_t captured() const { return m_captured; }
+    std::size_t dropped() const { return m_dropped; }
+
+   private:
+    enum State
+    {
+        FREE,
+        // pixels are being packed by the gpu
+        PACKING,
+        // the copy thread is copying the pixels out
+        COPYING,
+        // copied, the buffer is unmapped on the gl thread before reuse
+        COPIED,
+    };
+    struct Slot
+    {
+        GLuint buffer = 0;
+        std::size_t capacity = 0;
+        unsigned char* mapping = nullptr;
+        GLsync fence = nullptr;
+        glm::uvec2 size{0};
+        GLenum type{};
+        Sink sink{};
+        std::atomic<int> state{FREE};
+    };
+
+    // next free slot with room for the image, null if the ring is busy
+    Slot* acquire(glm::uvec2 const& size, GLenum type);
+    bool read(Slot* slot, GLuint framebuffer, GLenum buffer, glm::uvec2 const& size, GLenum type, Sink sink);
+    void submit(Slot& slot);
+
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::size_t m_next;
+    bool m_persistent;
+    GLuint m_framebuffer;
+    std::size_t m_captured;
+    std::size_t m_dropped;
+    // sinks that have not returned yet
+    std::size_t m_running;
+    std::mutex m_mutex;
+    std::condition_variable m_done;
+    // last so they are destroyed first, their workers use the members above
+    std::unique_ptr<ThreadPool> m_encoders;
+    // copies run apart from encoding so buffers return to the ring promptly
+    std::unique_ptr<ThreadPool> m_copier;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef FRAME_PIPELINE_HPP
+#define FRAME_PIPELINE_HPP
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// scene state an application builds in its simulation step, derived per application
+// owned by the frame it was built for, render() may change it (e.g. submit a batch) once taken
+struct SceneSnapshot
+{
+    virtual ~SceneSnapshot();
+};
+
+// simulation result of one frame, rendering reads it but never changes it
+struct FrameSnapshot
+{
+    std::uint64_t index = 0;
+    // simulated seconds since the first frame and the step leading to this frame
+    double time = 0.0;
+    float dt    = 0.0f;
+    glm::fmat4 view{1.0f};
+    glm::fvec3 eye{0.0f};
+    glm::fvec3 view_dir{0.0f, 0.0f, -1.0f};
+    glm::fvec3 up_dir{0.0f, 1.0f, 0.0f};
+    // built with the step, null if the application builds none
+    std::shared_ptr<SceneSnapshot> scene{};
+};
+
+// runs the simulation step on its own thread, up to capacity snapshots ahead of rendering
+// the step blocks while the queue is full, so a deeper queue hides uneven step and frame times
+// at the cost of rendering the camera up to capacity frames after it was simulated
+class FramePipeline
+{
+   public:
+    FramePipeline(std::function<FrameSnapshot()> step, unsigned capacity);
+    FramePipeline(FramePipeline const&) = delete;
+    FramePipeline& operator=(FramePipeline const&) = delete;
+    ~FramePipeline();
+
+    // oldest snapshot, waits while none is ready, rethrows exceptions of the step in order
+    FrameSnapshot take();
+    // wait for a running step and join the simulation thread, snapshots not taken are dropped
+    void stop();
+
+   private:
+    void simulate();
+
+    std::function<FrameSnapshot()> m_step;
+    std::size_t m_capacity;
+    std::mutex m_mutex;
+    // snapshot published, and room in the queue or stop requested
+    std::condition_variable m_ready;
+    std::condition_variable m_space;
+    std::deque<FrameSnapshot> m_queue;
+    bool m_stop;
+    // the step is paused until the error is taken
+    std::exception_ptr m_error;
+    std::thread m_thread;
+};
+
+// holds the frame rate by sleeping until shortly before the deadline and spinning the rest,
+// sleep alone overshoots by the scheduler granularity
+class FramePacer
+{
+   public:
+    explicit FramePacer(double frame_seconds);
+
+    // block until the current frame's time is over
+    void wait();
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::duration m_period;
+    Clock::time_point m_deadline;
+};
+
+#endif
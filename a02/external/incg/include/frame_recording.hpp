@@ -0,0 +1,80 @@
+#ifndef FRAME_RECORDING_HPP
+#define FRAME_RECORDING_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// camera of a recorded frame, as kept by cameraSystem
+struct CameraState
+{
+    glm::fvec3 position;
+    glm::fvec3 view_dir;
+    glm::fvec3 up_dir;
+};
+
+// per-frame camera and application parameters, recorded from an interactive session and replayed
+// frame by frame so runs of different builds and settings see the same frames
+// parameters are bound by name, a replay applies those present in both the file and the application
+class FrameRecording
+{
+   public:
+    // thread a parameter is read on, each stage is replayed there so both see the values of the
+    // frame they work on while the simulation runs ahead
+    enum Stage
+    {
+        SIMULATION,
+        RENDER,
+    };
+
+    FrameRecording();
+    // read a recording, throws std::runtime_error if it is missing, truncated or of another version
+    explicit FrameRecording(std::string const& path);
+
+    // the value is saved with each recorded frame and overwritten with each replayed one
+    void bind(std::string const& name, bool& value, Stage stage = RENDER);
+    void bind(std::string const& name, int& value, Stage stage = RENDER);
+    void bind(std::string const& name, float& value, Stage stage = RENDER);
+
+    // append the camera and the current values of the bound parameters
+    void record(CameraState const& camera);
+    // camera of a frame, frames past the end repeat the last one
+    CameraState camera(std::size_t frame) const;
+    // restore the bound parameters of a stage, frames past the end repeat the last one
+    void replay(std::size_t frame, Stage stage);
+
+    std::size_t size() const { return m_cameras.size(); }
+    // throws std::runtime_error if the file cannot be written
+    void write(std::string const& path) const;
+
+   private:
+    enum Type : std::uint32_t
+    {
+        BOOL  = 0,
+        INT   = 1,
+        FLOAT = 2,
+    };
+    struct Parameter
+    {
+        std::string name;
+        Type type;
+        // bound value, null for parameters of a file the application does not have
+        void* value;
+        Stage stage;
+    };
+
+    void bind(std::string const& name, Type type, void* value, Stage stage);
+
+    // parameters of the file followed by those bound only by the application
+    std::vector<Parameter> m_parameters;
+    // parameters stored per frame, the leading part of m_parameters
+    std::size_t m_stored;
+    std::vector<CameraState> m_cameras;
+    // m_stored 32 bit values per frame
+    std::vector<std::uint32_t> m_values;
+};
+
+#endif
@@ -10,22 +10,36 @@ using namespace gl;
 
 #include <glm/gtc/type_precision.hpp>
 
+namespace ktx
+{
+class File;
+}
+
 // Texture
 class Tex
 {
     glm::uvec2 m_dimensions;
     GLuint m_index;
 
+    void upload(ktx::File const& file, GLenum wrap_mode);
+
    public:
     Tex(unsigned w, unsigned h, GLenum internal_format);
     Tex(glm::uvec2 const& dims, GLenum internal_format);
+    // empty mip chain of the given number of levels, sampled trilinearly
+    Tex(glm::uvec2 const& dims, GLenum internal_format, unsigned levels);
+    // png files are decoded and mipmapped, .ktx files are uploaded as stored
     Tex(std::string const& filename, GLenum wrap_mode = GL_REPEAT);
+    // precompressed mip chain, copied to the gpu straight from the mapping
+    Tex(ktx::File const& file, GLenum wrap_mode = GL_REPEAT);
     Tex(Tex&&);
     Tex(Tex const&) = delete;
     Tex& operator   =(Tex&&);
     Tex& operator=(Tex const&) = delete;
     ~Tex();
+    // bind to the active unit or to the given one, through gl_state
     void bind() const;
+    void bind(GLuint unit) const;
     GLuint index() const;
     glm::uvec2 const& dimensions() const;
 
@@ -38,6 +52,7 @@ class Fbo
 {
     GLuint id;
     std::vector<GLenum> attachment_ids;
+    mutable bool draw_buffers_set;
 
    public:
     Fbo();
@@ -0,0 +1,72 @@
+#ifndef KTX_TEXTURE_HPP
+#define KTX_TEXTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/type_precision.hpp>
+
+#include "mapped_file.hpp"
+
+// khronos ktx 1.1 container holding a complete, precompressed mip chain
+// levels are stored bottom row first so they can be uploaded straight from the mapping
+namespace ktx
+{
+// little endian header following the 12 byte identifier, gl enums as plain values
+struct Header
+{
+    std::uint32_t endianness;
+    // 0 for compressed formats
+    std::uint32_t gl_type;
+    std::uint32_t gl_type_size;
+    std::uint32_t gl_format;
+    std::uint32_t gl_internal_format;
+    std::uint32_t gl_base_internal_format;
+    std::uint32_t pixel_width;
+    std::uint32_t pixel_height;
+    std::uint32_t pixel_depth;
+    std::uint32_t array_elements;
+    std::uint32_t faces;
+    std::uint32_t mip_levels;
+    std::uint32_t key_value_bytes;
+};
+
+// one mip level inside the file
+struct Level
+{
+    char const* data;
+    std::size_t size;
+    glm::uvec2 dimensions;
+};
+
+// validated view of a memory mapped 2d texture
+class File
+{
+   public:
+    // throws std::runtime_error if the file is no 2d ktx texture, truncated, of an unknown format or
+    // a level's size does not match its dimensions and format
+    explicit File(std::string const& path);
+
+    Header const& header() const { return m_header; }
+    std::vector<Level> const& levels() const { return m_levels; }
+    glm::uvec2 dimensions() const { return glm::uvec2{m_header.pixel_width, m_header.pixel_height}; }
+    bool compressed() const { return m_header.gl_type == 0; }
+    std::string const& path() const { return m_mapped->path(); }
+
+   private:
+    std::unique_ptr<MappedFile> m_mapped;
+    Header m_header;
+    std::vector<Level> m_levels;
+};
+
+// header of a 2d texture, type and format are 0 for compressed internal formats
+Header header(std::uint32_t internal_format, std::uint32_t base_internal_format, glm::uvec2 const& dimensions,
+              std::uint32_t levels, std::uint32_t format = 0, std::uint32_t type = 0, std::uint32_t type_size = 1);
+// levels in gl row order, throws std::runtime_error if the file cannot be written
+void write(std::string const& path, Header const& header, std::vector<std::vector<std::uint8_t>> const& levels);
+}  // namespace ktx
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// read-only view of a whole file, memory mapped where the platform allows it
+class MappedFile
+{
+   public:
+    // throws std::runtime_error if the file cannot be opened
+    MappedFile(std::string const& path);
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    ~MappedFile();
+
+    char const* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    std::string const& path() const { return m_path; }
+
+   private:
+    std::string m_path;
+    char const* m_data;
+    std::size_t m_size;
+    bool m_mapped;
+    // fallback storage when mapping is not available
+    std::vector<char> m_buffer;
+};
+
+#endif
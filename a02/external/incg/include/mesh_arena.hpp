@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+
+#include <glbinding/gl/types.h>
+#include <glm/gtc/type_precision.hpp>
+// use gl definitions from glbinding
+using namespace gl;
+
+// fixed attribute locations of arena geometry and instance data
+enum ArenaAttribute : GLuint {
+  ARENA_POSITION = 0,
+  ARENA_NORMAL = 1,
+  // model matrix takes four consecutive locations
+  ARENA_INSTANCE_MODEL = 4,
+  ARENA_INSTANCE_COLOR = 8,
+};
+
+// interleaved vertex of the shared vertex buffer
+struct ArenaVertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+};
+
+// per instance attributes, advanced once per instance
+struct InstanceData {
+  glm::fmat4 modelMatrix;
+  glm::fvec4 color;
+};
+
+// location of one mesh inside the shared buffers
+struct MeshRange {
+  GLuint firstIndex = 0;
+  GLuint indexCount = 0;
+  GLint baseVertex = 0;
+};
+
+// layout defined by ARB_draw_indirect
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+// suballocates meshes from one vertex and index buffer pair behind a single
+// vao, so switching meshes needs no state change
+class MeshArena {
+public:
+  MeshArena();
+  ~MeshArena();
+  MeshArena(const MeshArena &) = delete;
+  MeshArena &operator=(const MeshArena &) = delete;
+
+  // append mesh, buffers grow on demand
+  MeshRange add(std::vector<glm::vec3> const &vertices,
+                std::vector<glm::vec3> const &normals,
+                std::vector<uint32_t> const &indices);
+
+  void bind() const;
+  GLuint vertexArray() const { return vao; }
+  // single instance draw without instance buffer, the instance attributes are
+  // an identity model matrix and white without pattern
+  void draw(MeshRange const &mesh) const;
+
+  // stream instances and commands and issue them in one multi draw call
+  void drawIndirect(std::vector<DrawElementsIndirectCommand> const &commands,
+                    std::vector<InstanceData> const &instances);
+
+  size_t vertexCount() const { return vertex_count; }
+  size_t indexCount() const { return index_count; }
+
+protected:
+  void grow(GLuint &buffer, size_t &capacity, size_t used, size_t required,
+            GLenum target);
+  void setupAttributes();
+
+  GLuint vao = 0;
+  GLuint vertex_buffer = 0;
+  GLuint index_buffer = 0;
+  GLuint instance_buffer = 0;
+  GLuint indirect_buffer = 0;
+  size_t vertex_capacity = 0;
+  size_t index_capacity = 0;
+  size_t vertex_count = 0;
+  size_t index_count = 0;
+  bool multi_draw_indirect = false;
+};
+
+// collects instances per mesh and submits them with one multi draw call
+class DrawBatch {
+public:
+  void add(MeshRange const &mesh, InstanceData const &instance);
+  void clear();
+  // one indirect command per distinct mesh, instances grouped by mesh
+  void submit(MeshArena &arena);
+
+  size_t instanceCount() const { return instance_count; }
+  size_t triangleCount() const { return triangle_count; }
+
+protected:
+  struct Group {
+    MeshRange mesh;
+    std::vector<InstanceData> instances;
+  };
+  std::vector<Group> groups;
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<InstanceData> instances;
+  size_t instance_count = 0;
+  size_t triangle_count = 0;
+};
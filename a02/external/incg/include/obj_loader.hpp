@@ -0,0 +1,42 @@
+#ifndef OBJ_LOADER_HPP
+#define OBJ_LOADER_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/type_precision.hpp>
+
+namespace obj_loader
+{
+// triangulated mesh, one vertex per distinct position/texcoord/normal combination
+struct Mesh
+{
+    std::vector<glm::vec3> positions;
+    // computed from the faces where the file has none
+    std::vector<glm::vec3> normals;
+    // empty if no face references texture coordinates
+    std::vector<glm::vec2> texcoords;
+    std::vector<uint32_t> indices;
+};
+
+// malformed input, the message contains file and line
+class ParseError : public std::runtime_error
+{
+   public:
+    ParseError(std::string const& name, std::size_t line, std::string const& message);
+    std::size_t line() const { return m_line; }
+
+   private:
+    std::size_t m_line;
+};
+
+// parse obj text split into line aligned chunks, threads = 0 uses all hardware threads
+// supports v, v/vt, v/vt/vn and v//vn faces, polygons are fan triangulated
+Mesh parse(char const* data, std::size_t size, std::string const& name = "obj", unsigned threads = 0);
+// memory map file and parse it
+Mesh load(std::string const& path, unsigned threads = 0);
+}  // namespace obj_loader
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TEXTURE_CODEC_HPP
+#define TEXTURE_CODEC_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/gtc/type_precision.hpp>
+
+// cpu side image processing shared by texture streaming and the offline texture tools
+// images are tightly packed rgba8 unless noted otherwise
+namespace texture_codec
+{
+// size of a mip level, never below one texel
+glm::uvec2 level_dimensions(glm::uvec2 const& dimensions, unsigned level);
+unsigned level_count(glm::uvec2 const& dimensions);
+
+// 2x2 box filter like glGenerateMipmap, edge texels are repeated for odd sizes
+std::vector<std::uint8_t> downsample(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& from,
+                                     glm::uvec2 const& to);
+// level 0 followed by all smaller levels down to 1x1
+std::vector<std::vector<std::uint8_t>> mip_chain(std::vector<std::uint8_t> pixels, glm::uvec2 const& dimensions);
+
+// reverse row order, converts between png (top down) and gl (bottom up)
+void flip_rows(std::vector<std::uint8_t>& pixels, glm::uvec2 const& dimensions, std::size_t bytes_per_pixel = 4);
+
+// 4x4 block compression with endpoints fitted along the principal axis of each block
+// partial blocks at the border repeat their last row and column
+std::vector<std::uint8_t> encode_bc1(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& dimensions);
+std::vector<std::uint8_t> encode_bc3(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& dimensions);
+
+// unorm8 to half float per channel
+std::vector<std::uint16_t> to_rgba16f(std::vector<std::uint8_t> const& pixels);
+}  // namespace texture_codec
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads executing tasks in submission order
+class ThreadPool
+{
+   public:
+    // threads = 0 leaves one hardware thread for rendering
+    explicit ThreadPool(unsigned threads = 0);
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+    // discards tasks that have not started and waits for running ones
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+    std::size_t size() const { return m_workers.size(); }
+
+   private:
+    void work();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop;
+};
+
+#endif
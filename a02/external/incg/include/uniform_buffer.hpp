@@ -0,0 +1,44 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <cstddef>
+#include <vector>
+// use gl definitions from glbinding
+using namespace gl;
+
+// persistently mapped uniform buffer split into one region per frame in flight
+// each region is fenced, so writing never overwrites data the gpu may still read
+class UniformRing
+{
+   public:
+    UniformRing(std::size_t frame_capacity = 256 * 1024, unsigned frames_in_flight = 3);
+    UniformRing(UniformRing const&) = delete;
+    UniformRing& operator=(UniformRing const&) = delete;
+    ~UniformRing();
+
+    // switch to next region, waits only if the gpu is more than the ring behind
+    void beginFrame();
+    // fence the region written this frame
+    void endFrame();
+
+    // copy std140 block into the current region and bind it to the uniform binding point
+    void bind(GLuint binding, void const* data, std::size_t size);
+    template <typename T>
+    void bind(GLuint binding, T const& block)
+    {
+        bind(binding, &block, sizeof(T));
+    }
+
+   private:
+    GLuint m_buffer;
+    std::size_t m_capacity;
+    std::size_t m_alignment;
+    unsigned char* m_mapping;
+    std::vector<GLsync> m_fences;
+    std::size_t m_region;
+    std::size_t m_offset;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef UNIFORM_CACHE_HPP
+#define UNIFORM_CACHE_HPP
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/types.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "shader_loader.hpp"
+#include "uniform_upload.hpp"
+// use gl definitions from glbinding
+using namespace gl;
+
+// gl type reported by reflection for a uniform uploaded as T
+template <typename T>
+struct uniform_type;
+template <>
+struct uniform_type<bool>
+{
+    static constexpr GLenum value = GL_BOOL;
+};
+template <>
+struct uniform_type<int>
+{
+    static constexpr GLenum value = GL_INT;
+};
+template <>
+struct uniform_type<unsigned>
+{
+    static constexpr GLenum value = GL_UNSIGNED_INT;
+};
+template <>
+struct uniform_type<float>
+{
+    static constexpr GLenum value = GL_FLOAT;
+};
+template <>
+struct uniform_type<glm::fvec2>
+{
+    static constexpr GLenum value = GL_FLOAT_VEC2;
+};
+template <>
+struct uniform_type<glm::fvec3>
+{
+    static constexpr GLenum value = GL_FLOAT_VEC3;
+};
+template <>
+struct uniform_type<glm::fvec4>
+{
+    static constexpr GLenum value = GL_FLOAT_VEC4;
+};
+template <>
+struct uniform_type<glm::uvec2>
+{
+    static constexpr GLenum value = GL_UNSIGNED_INT_VEC2;
+};
+template <>
+struct uniform_type<glm::fmat4>
+{
+    static constexpr GLenum value = GL_FLOAT_MAT4;
+};
+template <typename T, std::size_t N>
+struct uniform_type<std::array<T, N>>
+{
+    static constexpr GLenum value = uniform_type<T>::value;
+};
+
+// uniform locations of one named program, kept valid when the program is relinked
+class ProgramUniforms
+{
+   public:
+    ProgramUniforms(std::string const& name);
+    ProgramUniforms(ProgramUniforms const&) = delete;
+    ProgramUniforms& operator=(ProgramUniforms const&) = delete;
+
+    // reflect newly linked program and re-resolve all registered uniforms
+    void update(GLuint program, shader_loader::Reflection&& reflection);
+
+    // register uniform, warns if the declared type does not match
+    std::size_t index(std::string const& name, GLenum type);
+    GLint location(std::size_t index) const { return m_locations[index]; }
+    // location lookup without registering, -1 if not active
+    GLint location(std::string const& name) const;
+
+    GLuint program() const { return m_program; }
+    shader_loader::Reflection const& reflection() const { return m_reflection; }
+
+   private:
+    GLint resolve(std::string const& name, GLenum type) const;
+
+    std::string m_name;
+    GLuint m_program;
+    shader_loader::Reflection m_reflection;
+    std::vector<std::string> m_names;
+    std::vector<GLenum> m_types;
+    std::vector<GLint> m_locations;
+};
+
+// typed handle to a cached uniform location, uploads to the currently bound program
+template <typename T>
+class Uniform
+{
+   public:
+    Uniform() : m_uniforms{nullptr}, m_index{0} {}
+    Uniform(ProgramUniforms& uniforms, std::string const& name)
+        : m_uniforms{&uniforms}, m_index{uniforms.index(name, uniform_type<T>::value)}
+    {
+    }
+
+    void set(T const& value) const { glUniform(m_uniforms->location(m_index), value); }
+
+   private:
+    ProgramUniforms* m_uniforms;
+    std::size_t m_index;
+};
+
+#endif
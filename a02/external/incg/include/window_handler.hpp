@@ -11,6 +11,8 @@
 // forward declarations
 
 extern GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor);
+// create offscreen context rendering into a framebuffer object instead of a window
+extern void initialize_headless(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor);
 
 namespace window_handler { 
   // create window and set callbacks
@@ -48,7 +50,10 @@ inline void set_mouse_callback(GLFWwindow* window, void (*func)(GLFWwindow*, dou
       glfwSetCursorPosCallback(window, func);
   }
 
-  // free resources
+  // framebuffer standing in for the window, 0 unless running headless
+  unsigned default_framebuffer();
+
+  // free resources, window is null when running headless
   void close_and_quit(GLFWwindow* window, int status);
 }
 
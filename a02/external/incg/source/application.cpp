@@ -1,6 +1,10 @@
 #include "application.hpp"
 
 #include <glbinding/gl/gl.h>
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
 #include <iostream>
 #include <thread>
 // use gl definitions from glbinding
@@ -13,13 +17,47 @@ using namespace gl;
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include "benchmark.hpp"
 #include "shader_loader.hpp"
 
+#include <sys/stat.h>
+#ifdef _WIN32
+#    include <direct.h>
+#endif
+
+LaunchOptions Application::s_launch_options{};
+
+namespace
+{
+// longer pauses (breakpoints, blocking loads) are not simulated in one step
+const float MAX_STEP_SECONDS = 0.25f;
+
+// create a missing directory, false if the path is no directory afterwards
+bool make_directory(std::string const& path)
+{
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+    struct stat sb;
+    return stat(path.c_str(), &sb) == 0 && (sb.st_mode & S_IFMT) == S_IFDIR;
+}
+}  // namespace
+
+void Application::setLaunchOptions(LaunchOptions const& options)
+{
+    s_launch_options = options;
+}
+
 Application::Application(std::string const& resource_path)
     : m_resource_path{resource_path},
       m_cam{glm::vec3(3.0f, 16.0f, 22.f)},
       m_shader_handles{},
       m_shader_files{},
+      m_pending_shaders{},
+      m_shader_dependencies{},
+      m_file_watcher{},
       m_pressed_right{false},
       m_pressed_middle{false},
       m_pressed_left{false},
@@ -27,9 +65,27 @@ Application::Application(std::string const& resource_path)
       m_speed_mouse{1.0f},
       m_viewMatrix{},
       m_projMatrix{},
-      m_resolution{WIDTH, HEIGHT}
+      m_resolution{s_launch_options.resolution},
+      window{nullptr},
+      m_profiler{},
+      m_uniform_ring{},
+      m_texture_streamer{},
+      m_frame_capture{},
+      m_golden{},
+      m_recording{},
+      m_frame{},
+      m_simulation_mutex{},
+      m_state_calls{},
+      m_start_time{std::chrono::steady_clock::now()}
 {
-    window = initialize(glm::uvec2{WIDTH, HEIGHT}, 3, 2);
+    if (s_launch_options.headless)
+    {
+        initialize_headless(m_resolution, 3, 2);
+    }
+    else
+    {
+        window = initialize(m_resolution, 3, 2);
+    }
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -42,6 +98,66 @@ Application::Application(std::string const& resource_path)
     ImGui::StyleColorsDark();
     // ImGui::StyleColorsClassic();
 
+    if (window)
+    {
+        setupCallbacks();
+        // Setup Platform backend
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+    }
+    // Setup Renderer backend
+    ImGui_ImplOpenGL3_Init();
+
+    // the uniform ring fences each frame, waiting on it is what keeps the cpu from running further ahead
+    unsigned frames_in_flight = s_launch_options.frames_in_flight;
+    m_profiler.reset(new Profiler{std::max(4u, frames_in_flight + 1)});
+    m_uniform_ring.reset(new UniformRing{256 * 1024, frames_in_flight});
+    m_texture_streamer.reset(new TextureStreamer{});
+    // a capture waits at least frames_in_flight frames for its fence, --capture and --golden read twice per frame
+    m_frame_capture.reset(new FrameCapture{2 * (frames_in_flight + 2)});
+    // checked once here, otherwise every frame's encode fails on its own
+    if (!s_launch_options.capture.empty() && !make_directory(s_launch_options.capture))
+    {
+        throw std::runtime_error{"capture directory " + s_launch_options.capture + " could not be created"};
+    }
+
+    std::string const& shader_cache = s_launch_options.shader_cache;
+    if (shader_cache != "off")
+    {
+        shader_loader::set_binary_cache(shader_cache.empty() ? m_resource_path + "/.shader_cache" : shader_cache);
+    }
+    // programs created by the subclass compile side by side and are waited for on first use
+    shader_loader::enable_parallel_compile();
+    m_file_watcher.reset(new FileWatcher{});
+
+    if (!s_launch_options.replay.empty())
+    {
+        m_recording.reset(new FrameRecording{s_launch_options.replay});
+        if (s_launch_options.frames == 0)
+        {
+            s_launch_options.frames = unsigned(m_recording->size());
+        }
+        std::cout << "Replaying " << m_recording->size() << " frames of " << s_launch_options.replay << std::endl;
+    }
+    else if (!s_launch_options.record.empty())
+    {
+        m_recording.reset(new FrameRecording{});
+    }
+
+
+
+    glClearDepth(1);
+    glClearColor(0.1f, 0.4f, 1.0f, 1.0f);
+    gl_state::set_enabled(GL_DEPTH_TEST, true);
+
+    // initialize view and projection matrices
+    updateCamera();
+    resizeCallback(m_resolution.x, m_resolution.y);
+
+    std::fill(last_frame_times, last_frame_times + last_frame_times_N, 0);
+}
+
+void Application::setupCallbacks()
+{
     window_handler::set_callback_object(window, this);
     window_handler::set_key_callback(window,
                                      [](GLFWwindow* w, int a, int b, int c, int d)
@@ -68,33 +184,25 @@ Application::Application(std::string const& resource_path)
     window_handler::set_char_mods_callback(
         window, [](GLFWwindow* w, unsigned int unicode_codepoint, int mods)
         { static_cast<Application*>(glfwGetWindowUserPointer(w))->charModsCallback(unicode_codepoint, mods); });
-
-
-
-    // Setup Platform/Renderer backends
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init();
-
-
-
-    glClearDepth(1);
-    glClearColor(0.1f, 0.4f, 1.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);  // turn on the depth test
-
-    // initialize view and projection matrices
-    updateCamera();
-    resizeCallback(m_resolution.x, m_resolution.y);
-
-    std::fill(last_frame_times, last_frame_times + last_frame_times_N, 0);
 }
 
 Application::~Application()
 {
+    m_file_watcher.reset();
+    for (auto& pending : m_pending_shaders)
+    {
+        shader_loader::cancel(pending.second);
+    }
     // free all shader program objects
     for (auto const& pair : m_shader_handles)
     {
+        gl_state::forget_program(pair.second);
         glDeleteProgram(pair.second);
     }
+    // joins decode workers and frees staging buffers while the context exists
+    m_texture_streamer.reset();
+    // finishes captures in flight, their buffers belong to the context
+    m_frame_capture.reset();
 
     window_handler::close_and_quit(window, EXIT_SUCCESS);
 }
@@ -104,22 +212,94 @@ void Application::updateShaderPrograms()
     std::cout << "Reloading Shaders" << std::endl;
     for (auto const& pair : m_shader_files)
     {
-        auto& handle = m_shader_handles[pair.first];
+        beginShader(pair.first);
+    }
+}
+
+void Application::beginShader(std::string const& name)
+{
+    auto pending = m_pending_shaders.find(name);
+    if (pending != m_pending_shaders.end())
+    {
+        // a newer edit supersedes the build in flight
+        shader_loader::cancel(pending->second);
+        m_pending_shaders.erase(pending);
+    }
+    try
+    {
+        auto started = shader_loader::begin_program(m_shader_files.at(name));
+        m_shader_dependencies[name] = started.files;
+        for (auto const& file : started.files)
+        {
+            m_file_watcher->watch(file);
+        }
+        m_pending_shaders.emplace(name, std::move(started));
+    }
+    catch (std::exception&)
+    {
+        // missing file, the old program stays
+    }
+}
+
+void Application::finishShader(std::string const& name) const
+{
+    auto& handle = m_shader_handles.at(name);
+    auto pending = m_pending_shaders.find(name);
+    if (handle != 0 || pending == m_pending_shaders.end())
+    {
+        return;
+    }
+    // the initial build has no program to fall back to, errors are fatal like before
+    auto linked = shader_loader::finish(pending->second);
+    m_pending_shaders.erase(pending);
+    handle = linked;
+    updateUniforms(name);
+}
+
+void Application::pollShaderPrograms()
+{
+    for (auto const& file : m_file_watcher->takeChanged())
+    {
+        shader_loader::invalidate(file);
+        for (auto const& dependencies : m_shader_dependencies)
+        {
+            if (std::find(dependencies.second.begin(), dependencies.second.end(), file) != dependencies.second.end())
+            {
+                beginShader(dependencies.first);
+            }
+        }
+    }
+
+    for (auto pending = m_pending_shaders.begin(); pending != m_pending_shaders.end();)
+    {
+        auto& handle = m_shader_handles.at(pending->first);
+        if (handle == 0 || !shader_loader::ready(pending->second))
+        {
+            ++pending;
+            continue;
+        }
         try
         {
-            auto handle_new = shader_loader::program(pair.second);
+            auto handle_new = shader_loader::finish(pending->second);
             // if compilation throws exception, old handle is not overridden
+            // the reload may get the deleted name back, gl_state must not take it as bound
+            gl_state::forget_program(handle);
             glDeleteProgram(handle);
+            m_uniforms_by_handle.erase(handle);
             handle = handle_new;
+            updateUniforms(pending->first);
+            std::cout << "Reloaded " << pending->first << std::endl;
         }
         catch (std::exception&)
         {
         }
+        pending = m_pending_shaders.erase(pending);
     }
 }
 
 uint32_t Application::shader(std::string const& name) const
 {
+    finishShader(name);
     return m_shader_handles.at(name);
 }
 
@@ -130,7 +310,50 @@ void Application::initializeShader(std::string const& name, std::map<GLenum, std
         throw std::runtime_error{"SPIR-V loading through this interface not supported"};
     }
     m_shader_files.emplace(name, files);
-    m_shader_handles.emplace(name, shader_loader::program(files, binary));
+    m_shader_handles.emplace(name, 0);
+    m_shader_uniforms.emplace(name, std::unique_ptr<ProgramUniforms>{new ProgramUniforms{name}});
+    // initial builds throw right away when a file is missing
+    auto started = shader_loader::begin_program(files);
+    m_shader_dependencies[name] = started.files;
+    for (auto const& file : started.files)
+    {
+        m_file_watcher->watch(file);
+    }
+    m_pending_shaders.emplace(name, std::move(started));
+}
+
+void Application::updateUniforms(std::string const& name) const
+{
+    GLuint handle  = m_shader_handles.at(name);
+    bool compute   = m_shader_files.at(name).count(GL_COMPUTE_SHADER) > 0;
+    auto& uniforms = *m_shader_uniforms.at(name);
+    auto bindings  = m_block_bindings.find(name);
+    if (bindings != m_block_bindings.end())
+    {
+        for (auto const& block : bindings->second)
+        {
+            GLuint index = glGetUniformBlockIndex(handle, block.first.c_str());
+            if (index != GL_INVALID_INDEX)
+            {
+                glUniformBlockBinding(handle, index, block.second);
+            }
+        }
+    }
+    uniforms.update(handle, shader_loader::reflect(handle, compute));
+    m_uniforms_by_handle[handle] = &uniforms;
+}
+
+void Application::bindUniformBlock(std::string const& program, std::string const& block, GLuint binding)
+{
+    m_block_bindings[program][block] = binding;
+    finishShader(program);
+    updateUniforms(program);
+}
+
+shader_loader::Reflection const& Application::shaderInfo(std::string const& name) const
+{
+    finishShader(name);
+    return m_shader_uniforms.at(name)->reflection();
 }
 
 void Application::updateCamera()
@@ -324,88 +547,233 @@ void Application::scrollCallback(double offset_x, double offset_y)
 
 void Application::run(int max_fps)
 {
-    using Time = std::chrono::duration<double>;
-
-    Time delta_time = Time(1.0 / max_fps);
+    using Clock = std::chrono::steady_clock;
 
-    auto start_time = std::chrono::system_clock::now();
+    // benchmark mode renders a fixed number of frames as fast as possible
+    bool benchmark         = s_launch_options.frames > 0;
+    unsigned total_frames  = s_launch_options.warmup + s_launch_options.frames;
+    FrameTimings timings{};
+    gl_state::Counters measured_calls{};
 
-    auto current_time = Time(0);
-    auto next_update  = current_time;
-
-
-    int current_query = 0;
-    GLuint timer_queries[2];
-    glGenQueries(2, &timer_queries[0]);
-    for (int i = 0; i < 2; ++i)
+    for (auto const& pair : m_shader_files)
     {
-        glBeginQuery(GL_TIME_ELAPSED, timer_queries[i]);
-        glEndQuery(GL_TIME_ELAPSED);
+        finishShader(pair.first);
     }
-
+    // cold starts compile every program, warm starts load them from the binary cache
+    shader_loader::BuildStats const& build = shader_loader::build_stats();
+    std::cout << "startup " << std::chrono::duration<double, std::milli>(Clock::now() - m_start_time).count()
+              << " ms, " << build.cached + build.compiled << " shader programs in " << build.milliseconds << " ms ("
+              << build.cached << " cached, " << build.compiled << " compiled)" << std::endl;
+
+    // benchmarks step by a fixed time so every run simulates the same frames
+    float fixed_dt = 1.0f / float(max_fps);
+    m_frame.view     = m_viewMatrix;
+    m_frame.eye      = m_cam.position;
+    m_frame.view_dir = m_cam.viewDir;
+    m_frame.up_dir   = m_cam.upDir;
+    // last step and its start, only touched by the simulation thread once it runs
+    FrameSnapshot previous = m_frame;
+    auto last_step         = Clock::now();
+    FramePipeline simulation{[&]()
+                             {
+                                 auto now = Clock::now();
+                                 float dt = std::chrono::duration<float>(now - last_step).count();
+                                 last_step = now;
+                                 FrameSnapshot snapshot =
+                                     simulate(previous, benchmark ? fixed_dt : std::min(dt, MAX_STEP_SECONDS));
+                                 previous       = snapshot;
+                                 previous.scene = nullptr;
+                                 return snapshot;
+                             },
+                             s_launch_options.frames_in_flight};
+    FramePacer pacer{1.0 / max_fps};
+    auto last_frame = Clock::now();
 
     // rendering loop
-    while (!glfwWindowShouldClose(window))
+    for (unsigned frame = 0; window ? !glfwWindowShouldClose(window) : benchmark; ++frame)
     {
-        if (shader_loader::RequireReload())
+        if (benchmark && frame >= total_frames)
         {
-            updateShaderPrograms();
+            break;
+        }
+        auto frame_start = Clock::now();
+        m_state_calls    = gl_state::counters();
+        gl_state::reset_counters();
+        if (benchmark && frame > s_launch_options.warmup)
+        {
+            measured_calls.issued += m_state_calls.issued;
+            measured_calls.filtered += m_state_calls.filtered;
         }
 
-        // query input
-        glfwPollEvents();
-        // draw geometry
-        update(delta_time.count());
-
-        glBeginQuery(GL_TIME_ELAPSED, timer_queries[current_query]);
-        render();
-        glEndQuery(GL_TIME_ELAPSED);
-
-        current_query = (current_query + 1) % 2;
-
-
-        int done = 0;
-        while (!done)
+        // query input, callbacks move the camera for the next simulation step
+        if (window)
         {
-            glGetQueryObjectiv(timer_queries[current_query], GL_QUERY_RESULT_AVAILABLE, &done);
+            auto lock = simulationLock();
+            glfwPollEvents();
         }
 
-        GLuint64 elapsed_time = 0;
-        glGetQueryObjectui64v(timer_queries[current_query], GL_QUERY_RESULT, &elapsed_time);
-        last_frame_time = elapsed_time / 1000000.0;
-        float last_frame_fp = 1000.0 * 1.0 / last_frame_time;
-        last_frame_times[last_frame_times_i % (last_frame_times_N * 2)]                = last_frame_time;
-        last_frame_times[(last_frame_times_i + last_frame_times_N) % (last_frame_times_N * 2)] = last_frame_time;
-        last_frame_fps[last_frame_times_i % (last_frame_times_N * 2)]                = last_frame_fp;
-        last_frame_fps[(last_frame_times_i + last_frame_times_N) % (last_frame_times_N * 2)] = last_frame_fp;
-        last_frame_times_i++;
+        m_profiler->beginFrame();
+        m_uniform_ring->beginFrame();
 
+        // gpu results of earlier frames, read back without waiting
+        for (auto const& resolved : m_profiler->takeResolved())
+        {
+            updateFrameTimes(float(resolved.gpu()));
+            if (benchmark && resolved.index >= s_launch_options.warmup)
+            {
+                timings.recordGpu(resolved.index - s_launch_options.warmup, float(resolved.gpu()));
+            }
+        }
 
+        pollShaderPrograms();
+        {
+            auto scope = profile("textures");
+            m_texture_streamer->update();
+        }
+        {
+            auto scope = profile("simulation");
+            m_frame = simulation.take();
+        }
+        if (m_recording)
+        {
+            // render parameters belong to the frame as it is rendered, not as it was simulated
+            auto lock = simulationLock();
+            if (!s_launch_options.replay.empty())
+            {
+                m_recording->replay(recordedFrame(m_frame.index), FrameRecording::RENDER);
+            }
+            else
+            {
+                m_recording->record(CameraState{m_frame.eye, m_frame.view_dir, m_frame.up_dir});
+            }
+        }
 
-        // Start the Dear ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-        imgui();
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            auto scope = profile("render");
+            render();
+        }
+        if (!benchmark || frame >= s_launch_options.warmup)
+        {
+            captureFrame(benchmark ? frame - s_launch_options.warmup : frame);
+        }
+        {
+            auto scope = profile("capture");
+            m_frame_capture->update();
+        }
+        {
+            auto scope = profile("imgui");
+            renderImgui(std::max(std::chrono::duration<float>(frame_start - last_frame).count(), 1e-6f));
+        }
+        last_frame = frame_start;
+        m_uniform_ring->endFrame();
+        m_profiler->endFrame();
 
-        // tweak bar
-        // TwDraw();
         // swap draw buffer to front
-        glfwSwapBuffers(window);
+        if (window)
+        {
+            glfwSwapBuffers(window);
+        }
 
-        current_time = std::chrono::duration_cast<Time>(std::chrono::system_clock::now() - start_time);
-        next_update += delta_time;
+        auto frame_end = Clock::now();
+        if (benchmark && frame >= s_launch_options.warmup)
+        {
+            float cpu_ms = float(std::chrono::duration<double, std::milli>(frame_end - frame_start).count());
+            timings.recordCpu(frame - s_launch_options.warmup, cpu_ms);
+        }
+        if (!benchmark)
+        {
+            pacer.wait();
+        }
+    }
+
+    // snapshots simulated ahead are dropped, the recording is complete once the step stopped
+    simulation.stop();
+    // remaining frames are still in flight
+    m_profiler->flush();
+    m_frame_capture->flush();
+    for (auto const& resolved : m_profiler->takeResolved())
+    {
+        if (benchmark && resolved.index >= s_launch_options.warmup)
+        {
+            timings.recordGpu(resolved.index - s_launch_options.warmup, float(resolved.gpu()));
+        }
+    }
+    if (m_recording && !s_launch_options.record.empty())
+    {
+        m_recording->write(s_launch_options.record);
+        std::cout << "Recorded " << m_recording->size() << " frames to " << s_launch_options.record << std::endl;
+    }
+    if (!s_launch_options.capture.empty())
+    {
+        std::cout << "Captured frames to " << s_launch_options.capture << ", " << m_frame_capture->dropped()
+                  << " dropped" << std::endl;
+    }
+    if (!s_launch_options.golden.empty())
+    {
+        std::lock_guard<std::mutex> lock{m_golden.mutex};
+        std::cout << "golden " << m_golden.compared << " frames compared, " << m_golden.failed
+                  << " over tolerance, max difference " << m_golden.max_difference * 255.0f << "/255, "
+                  << m_frame_capture->dropped() << " dropped" << std::endl;
+    }
+    if (!s_launch_options.trace.empty())
+    {
+        m_profiler->writeChromeTrace(s_launch_options.trace);
+        std::cout << "Trace written to " << s_launch_options.trace << std::endl;
+    }
 
-        auto wait_time = next_update - current_time;
-        if (wait_time.count() > 0)
+    if (benchmark)
+    {
+        timings.print(std::cout);
+        // the last frame's calls are collected after the loop
+        measured_calls.issued += gl_state::counters().issued;
+        measured_calls.filtered += gl_state::counters().filtered;
+        double frames = std::max(1.0, double(s_launch_options.frames));
+        std::cout << "gl state calls per frame: " << double(measured_calls.issued) / frames << " issued, "
+                  << double(measured_calls.filtered) / frames << " filtered" << std::endl;
+        if (!s_launch_options.report.empty())
         {
-            std::this_thread::sleep_for(wait_time);
+            timings.write(s_launch_options.report, m_resolution);
+            std::cout << "Timings written to " << s_launch_options.report << std::endl;
         }
     }
 }
 
+void Application::renderImgui(float delta_time)
+{
+    // Start the Dear ImGui frame
+    ImGui_ImplOpenGL3_NewFrame();
+    if (window)
+    {
+        ImGui_ImplGlfw_NewFrame();
+    }
+    else
+    {
+        // no platform backend when headless, provide frame info directly
+        ImGuiIO& io    = ImGui::GetIO();
+        io.DisplaySize = ImVec2(float(m_resolution.x), float(m_resolution.y));
+        io.DeltaTime   = delta_time;
+    }
+    ImGui::NewFrame();
+    {
+        // the interface edits parameters the simulation step reads
+        auto lock = simulationLock();
+        imgui();
+    }
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
+
+void Application::updateFrameTimes(float frame_time)
+{
+    last_frame_time     = frame_time;
+    float last_frame_fp = 1000.0f / last_frame_time;
+    last_frame_times[last_frame_times_i % (last_frame_times_N * 2)]                        = last_frame_time;
+    last_frame_times[(last_frame_times_i + last_frame_times_N) % (last_frame_times_N * 2)] = last_frame_time;
+    last_frame_fps[last_frame_times_i % (last_frame_times_N * 2)]                          = last_frame_fp;
+    last_frame_fps[(last_frame_times_i + last_frame_times_N) % (last_frame_times_N * 2)]   = last_frame_fp;
+    last_frame_times_i++;
+}
+
 void Application::imGui_plotFPS()
 {
     
@@ -422,12 +790,161 @@ void Application::imGui_plotFPS()
 
     if(show_ms_fps==0) ImGui::PlotLines("###ms", last_frame_times, last_frame_times_N, offset, average_string.c_str(), 0,  FLT_MAX, ImVec2(ImGui::GetWindowWidth(), 50));
     else               ImGui::PlotLines("###fps", last_frame_fps, last_frame_times_N, offset, average_string.c_str(), 0,  FLT_MAX, ImVec2(ImGui::GetWindowWidth(), 50));
-    
+
+    if (ImGui::CollapsingHeader("Profiler"))
+    {
+        m_profiler->imgui();
+        ImGui::Text("gl state calls: %zu issued, %zu filtered", m_state_calls.issued, m_state_calls.filtered);
+        if (ImGui::Button("Export trace"))
+        {
+            // the --trace file if given, otherwise next to the resources instead of the working directory
+            std::string path =
+                s_launch_options.trace.empty() ? m_resource_path + "/trace.json" : s_launch_options.trace;
+            try
+            {
+                m_profiler->writeChromeTrace(path);
+                m_trace_status = "written to " + path;
+            }
+            catch (std::exception const&)
+            {
+                // keep the imgui frame balanced, the error is shown below the button
+                m_trace_status = "could not write " + path;
+            }
+        }
+        if (!m_trace_status.empty())
+        {
+            ImGui::TextWrapped("%s", m_trace_status.c_str());
+        }
+    }
+}
+
+ProfileScope Application::profile(char const* name) const
+{
+    return ProfileScope{*m_profiler, name};
+}
+
+Profiler& Application::profiler() const
+{
+    return *m_profiler;
+}
+
+TextureStreamer& Application::textureStreamer() const
+{
+    return *m_texture_streamer;
+}
+
+FrameCapture& Application::frameCapture() const
+{
+    return *m_frame_capture;
+}
+
+std::string Application::captureDirectory() const
+{
+    return s_launch_options.capture.empty() ? m_resource_path : s_launch_options.capture;
+}
+
+void Application::captureFrame(unsigned index)
+{
+    if (s_launch_options.capture.empty() && s_launch_options.golden.empty())
+    {
+        return;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%05u.png", index);
+    GLuint framebuffer = window_handler::default_framebuffer();
+    if (!s_launch_options.capture.empty())
+    {
+        m_frame_capture->captureFramebuffer(framebuffer, m_resolution, s_launch_options.capture + "/" + name);
+    }
+    if (!s_launch_options.golden.empty())
+    {
+        std::string path = s_launch_options.golden + "/" + name;
+        float tolerance  = s_launch_options.golden_tolerance;
+        m_frame_capture->captureFramebuffer(
+            framebuffer, m_resolution, GL_UNSIGNED_BYTE,
+            [this, path, tolerance, index](CapturedImage& image)
+            {
+                // a missing or mismatched golden image fails the frame
+                ImageDifference difference{1.0f, std::size_t(image.size.x) * image.size.y};
+                try
+                {
+                    difference = compare_images(image, read_image(path), tolerance);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "golden image " << path << ": " << e.what() << std::endl;
+                }
+                std::lock_guard<std::mutex> lock{m_golden.mutex};
+                ++m_golden.compared;
+                m_golden.max_difference = std::max(m_golden.max_difference, difference.max_difference);
+                if (difference.pixels_over > 0)
+                {
+                    ++m_golden.failed;
+                    std::cout << "golden frame " << index << ": " << difference.pixels_over
+                              << " pixels differ by up to " << difference.max_difference * 255.0f << "/255"
+                              << std::endl;
+                }
+            });
+    }
+}
+
+FrameSnapshot Application::simulate(FrameSnapshot const& previous, float dt)
+{
+    auto lock = simulationLock();
+    FrameSnapshot snapshot{};
+    snapshot.index = previous.index + 1;
+    snapshot.time  = previous.time + dt;
+    snapshot.dt    = dt;
+
+    // parameters are replayed before update() reads them, the camera after it has moved
+    bool const replay = m_recording && !s_launch_options.replay.empty();
+    if (replay)
+    {
+        m_recording->replay(recordedFrame(snapshot.index), FrameRecording::SIMULATION);
+    }
+    update(dt);
+    if (replay)
+    {
+        CameraState camera = m_recording->camera(recordedFrame(snapshot.index));
+        m_cam.position     = camera.position;
+        m_cam.viewDir      = camera.view_dir;
+        m_cam.upDir        = camera.up_dir;
+        m_cam.rightDir     = glm::normalize(glm::cross(camera.view_dir, camera.up_dir));
+        updateCamera();
+    }
+    snapshot.view     = m_viewMatrix;
+    snapshot.eye      = m_cam.position;
+    snapshot.view_dir = m_cam.viewDir;
+    snapshot.up_dir   = m_cam.upDir;
+    snapshot.scene    = buildScene(snapshot);
+    return snapshot;
+}
+
+std::size_t Application::recordedFrame(std::uint64_t index) const
+{
+    unsigned const warmup = s_launch_options.warmup;
+    return index > warmup + 1 ? std::size_t(index - 1 - warmup) : 0;
+}
+
+std::shared_ptr<SceneSnapshot> Application::buildScene(FrameSnapshot const& frame)
+{
+    (void)frame;
+    return nullptr;
+}
+
+std::unique_lock<std::mutex> Application::simulationLock() const
+{
+    return std::unique_lock<std::mutex>{m_simulation_mutex};
+}
+
+FrameSnapshot const& Application::frame() const
+{
+    return m_frame;
 }
 
 glm::fmat4 const& Application::viewMatrix() const
 {
-    return m_viewMatrix;
+    return m_frame.view;
 }
 glm::fmat4 const& Application::projectionMatrix() const
 {
@@ -441,30 +958,13 @@ glm::uvec2 const& Application::resolution() const
 
 GLint Application::glGetUniformLocation(GLuint program, const GLchar* name) const
 {
+    // locations are reflected once after linking
+    auto uniforms = m_uniforms_by_handle.find(program);
+    if (uniforms != m_uniforms_by_handle.end())
+    {
+        return uniforms->second->location(name);
+    }
     // use function from outer namespace to prevent recursion
     GLint loc = ::glGetUniformLocation(program, name);
     return loc;
-    // bool check = false;
-    // // if location invalid, output info similar to gl errors
-    // if (check && loc == -1) {
-    //   std::cerr <<  "OpenGL Error: " << "glGetUniformLocation" << "(";
-    //   std::cerr << program << ", " << name << ") - ";
-    //   // if no program is bound
-    //   if (program == 0) {
-    //     std::cerr << "no program bound" << std::endl;
-    //     return loc;
-    //   }
-    //   // a program is bound
-    //   std::cerr << name <<" is not an active uniform variable in program ";
-    //   for (auto const& pair : m_shader_handles) {
-    //     if (pair.second == program) {
-    //       std::cerr << '\'' << pair.first << '\'' << std::endl;
-    //     }
-    //   }
-    //   // dont throw, allow retrying
-    //   // throw std::runtime_error("Execution of " +
-    //   std::string("glGetUniformLocation"));
-    //   // exit(EXIT_FAILURE);
-    // }
-    // return loc;
 }
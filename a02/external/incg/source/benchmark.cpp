@@ -0,0 +1,164 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+TimingSummary TimingSummary::of(std::vector<float> values)
+{
+    TimingSummary summary{};
+    if (values.empty())
+    {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    // nearest rank percentile
+    auto percentile = [&values](float p)
+    {
+        std::size_t rank = std::size_t(p * float(values.size() - 1) + 0.5f);
+        return values[std::min(rank, values.size() - 1)];
+    };
+    summary.min  = values.front();
+    summary.mean = std::accumulate(values.begin(), values.end(), 0.0f) / float(values.size());
+    summary.p50  = percentile(0.50f);
+    summary.p99  = percentile(0.99f);
+    return summary;
+}
+
+// frames without a result keep a negative placeholder
+static void set_sample(std::vector<float>& samples, std::size_t frame, float ms)
+{
+    if (frame >= samples.size())
+    {
+        samples.resize(frame + 1, -1.0f);
+    }
+    samples[frame] = ms;
+}
+
+static std::vector<float> valid_samples(std::vector<float> const& samples)
+{
+    std::vector<float> valid{};
+    std::copy_if(samples.begin(), samples.end(), std::back_inserter(valid), [](float ms) { return ms >= 0.0f; });
+    return valid;
+}
+
+void FrameTimings::recordCpu(std::size_t frame, float ms)
+{
+    set_sample(m_cpu, frame, ms);
+}
+
+void FrameTimings::recordGpu(std::size_t frame, float ms)
+{
+    set_sample(m_gpu, frame, ms);
+}
+
+std::size_t FrameTimings::size() const
+{
+    return m_cpu.size();
+}
+
+TimingSummary FrameTimings::cpu() const
+{
+    return TimingSummary::of(valid_samples(m_cpu));
+}
+
+TimingSummary FrameTimings::gpu() const
+{
+    return TimingSummary::of(valid_samples(m_gpu));
+}
+
+void FrameTimings::write(std::string const& path, glm::uvec2 const& resolution) const
+{
+    std::ofstream file{path};
+    if (!file)
+    {
+        std::cerr << "Could not open \'" << path << "\' for writing" << std::endl;
+        throw std::invalid_argument(path);
+    }
+
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json)
+    {
+        writeJson(file, resolution);
+    }
+    else
+    {
+        writeCsv(file);
+    }
+}
+
+void FrameTimings::print(std::ostream& stream) const
+{
+    auto line = [&stream](char const* name, TimingSummary const& s)
+    {
+        stream << name << " ms: min " << s.min << ", mean " << s.mean << ", p50 " << s.p50 << ", p99 " << s.p99
+               << std::endl;
+    };
+    stream << size() << " frames" << std::endl;
+    line("cpu", cpu());
+    line("gpu", gpu());
+}
+
+void FrameTimings::writeCsv(std::ostream& stream) const
+{
+    // summary as comment lines, so the file stays a plain per-frame table
+    auto line = [&stream](char const* name, TimingSummary const& s)
+    { stream << "# " << name << "," << s.min << "," << s.mean << "," << s.p50 << "," << s.p99 << "\n"; };
+    stream << "# timing,min,mean,p50,p99\n";
+    line("cpu_ms", cpu());
+    line("gpu_ms", gpu());
+
+    stream << "frame,cpu_ms,gpu_ms\n";
+    for (std::size_t i = 0; i < size(); ++i)
+    {
+        stream << i << "," << m_cpu[i] << ",";
+        if (i < m_gpu.size() && m_gpu[i] >= 0.0f)
+        {
+            stream << m_gpu[i];
+        }
+        stream << "\n";
+    }
+}
+
+void FrameTimings::writeJson(std::ostream& stream, glm::uvec2 const& resolution) const
+{
+    auto summary = [&stream](TimingSummary const& s)
+    {
+        stream << "{\"min\": " << s.min << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+               << ", \"p99\": " << s.p99 << "}";
+    };
+    auto samples = [&stream](std::vector<float> const& values)
+    {
+        stream << "[";
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            stream << (i > 0 ? ", " : "");
+            // missing results as null
+            if (values[i] >= 0.0f)
+            {
+                stream << values[i];
+            }
+            else
+            {
+                stream << "null";
+            }
+        }
+        stream << "]";
+    };
+
+    stream << "{\n";
+    stream << "  \"frames\": " << size() << ",\n";
+    stream << "  \"resolution\": [" << resolution.x << ", " << resolution.y << "],\n";
+    stream << "  \"cpu_ms\": ";
+    summary(cpu());
+    stream << ",\n  \"gpu_ms\": ";
+    summary(gpu());
+    stream << ",\n  \"cpu_ms_samples\": ";
+    samples(m_cpu);
+    stream << ",\n  \"gpu_ms_samples\": ";
+    samples(m_gpu);
+    stream << "\n}\n";
+}
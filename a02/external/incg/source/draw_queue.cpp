@@ -0,0 +1,79 @@
+#include "draw_queue.hpp"
+
+#include <glbinding/gl/enum.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "gl_state.hpp"
+
+const unsigned DrawItem::MAX_TEXTURES;
+
+void DrawQueue::add(DrawItem item)
+{
+    m_items.push_back(std::move(item));
+}
+
+void DrawQueue::clear()
+{
+    m_items.clear();
+}
+
+std::uint64_t DrawQueue::key(DrawItem const& item)
+{
+    // textures are grouped by a hash of the whole set, equal sets stay adjacent
+    std::uint32_t textures = 2166136261u;
+    for (GLuint texture : item.textures)
+    {
+        textures = (textures ^ texture) * 16777619u;
+    }
+    return std::uint64_t(item.layer) << 56 | std::uint64_t(item.program & 0xffffu) << 40 |
+           std::uint64_t(textures & 0xffffffu) << 16 | std::uint64_t(item.mesh & 0xffffu);
+}
+
+void DrawQueue::submit(bool sorted)
+{
+    m_order.clear();
+    for (std::size_t i = 0; i < m_items.size(); ++i)
+    {
+        m_order.emplace_back(sorted ? key(m_items[i]) : 0, std::uint32_t(i));
+    }
+    // stable, draws of equal keys keep the order they were added in
+    std::stable_sort(m_order.begin(), m_order.end(),
+                     [](std::pair<std::uint64_t, std::uint32_t> const& lhs,
+                        std::pair<std::uint64_t, std::uint32_t> const& rhs) { return lhs.first < rhs.first; });
+
+    m_state_changes          = 0;
+    DrawItem const* previous = nullptr;
+    for (auto const& entry : m_order)
+    {
+        DrawItem const& item = m_items[entry.second];
+        if (!previous || previous->program != item.program)
+        {
+            ++m_state_changes;
+        }
+        if (!previous || std::memcmp(previous->textures, item.textures, sizeof(item.textures)) != 0)
+        {
+            ++m_state_changes;
+        }
+        if (!previous || previous->mesh != item.mesh)
+        {
+            ++m_state_changes;
+        }
+        previous = &item;
+
+        gl_state::use_program(item.program);
+        for (unsigned unit = 0; unit < DrawItem::MAX_TEXTURES; ++unit)
+        {
+            if (item.textures[unit] != 0)
+            {
+                gl_state::bind_texture(unit, GL_TEXTURE_2D, item.textures[unit]);
+            }
+        }
+        if (item.mesh != 0)
+        {
+            gl_state::bind_vertex_array(item.mesh);
+        }
+        item.draw();
+    }
+}
@@ -0,0 +1,214 @@
+#include "frame_recording.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+char const MAGIC[4]           = {'I', 'N', 'C', 'R'};
+const std::uint32_t VERSION   = 1;
+const std::size_t CAMERA_SIZE = sizeof(float) * 9;
+
+// little endian file header, parameter names and the frames follow
+struct Header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t parameter_count;
+    std::uint32_t frame_count;
+};
+
+template <typename T>
+void read_value(std::istream& file, T& value, std::string const& path)
+{
+    if (!file.read(reinterpret_cast<char*>(&value), sizeof(T)))
+    {
+        throw std::runtime_error(path + ": recording truncated");
+    }
+}
+
+template <typename T>
+void write_value(std::ostream& file, T const& value)
+{
+    file.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+}  // namespace
+
+FrameRecording::FrameRecording() : m_parameters{}, m_stored{0}, m_cameras{}, m_values{} {}
+
+FrameRecording::FrameRecording(std::string const& path) : FrameRecording{}
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        throw std::runtime_error("Could not open recording \'" + path + "\'");
+    }
+    Header header{};
+    read_value(file, header, path);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw std::runtime_error(path + ": not a recording");
+    }
+    if (header.version != VERSION)
+    {
+        throw std::runtime_error(path + ": recording version " + std::to_string(header.version) + ", expected " +
+                                 std::to_string(VERSION));
+    }
+    for (std::uint32_t i = 0; i < header.parameter_count; ++i)
+    {
+        std::uint32_t type = 0, length = 0;
+        read_value(file, type, path);
+        read_value(file, length, path);
+        std::string name(length, '\0');
+        if (type > FLOAT || !file.read(&name[0], std::streamsize(length)))
+        {
+            throw std::runtime_error(path + ": recording truncated or corrupt");
+        }
+        m_parameters.push_back(Parameter{name, Type(type), nullptr, RENDER});
+    }
+    m_stored = m_parameters.size();
+    m_cameras.resize(header.frame_count);
+    m_values.resize(std::size_t(header.frame_count) * m_stored);
+    for (std::uint32_t frame = 0; frame < header.frame_count; ++frame)
+    {
+        read_value(file, m_cameras[frame], path);
+        if (m_stored > 0 && !file.read(reinterpret_cast<char*>(&m_values[frame * m_stored]),
+                                       std::streamsize(m_stored * sizeof(std::uint32_t))))
+        {
+            throw std::runtime_error(path + ": recording truncated");
+        }
+    }
+}
+
+void FrameRecording::bind(std::string const& name, bool& value, Stage stage)
+{
+    bind(name, BOOL, &value, stage);
+}
+
+void FrameRecording::bind(std::string const& name, int& value, Stage stage)
+{
+    bind(name, INT, &value, stage);
+}
+
+void FrameRecording::bind(std::string const& name, float& value, Stage stage)
+{
+    bind(name, FLOAT, &value, stage);
+}
+
+void FrameRecording::bind(std::string const& name, Type type, void* value, Stage stage)
+{
+    auto parameter = std::find_if(m_parameters.begin(), m_parameters.end(),
+                                  [&](Parameter const& parameter) { return parameter.name == name; });
+    if (parameter != m_parameters.end())
+    {
+        if (parameter->type != type)
+        {
+            throw std::runtime_error("recorded parameter " + name + " has another type");
+        }
+        parameter->value = value;
+        parameter->stage = stage;
+        return;
+    }
+    m_parameters.push_back(Parameter{name, type, value, stage});
+    // a new recording stores every parameter bound before its first frame
+    if (m_cameras.empty() && m_stored + 1 == m_parameters.size())
+    {
+        ++m_stored;
+    }
+}
+
+void FrameRecording::record(CameraState const& camera)
+{
+    m_cameras.push_back(camera);
+    for (std::size_t i = 0; i < m_stored; ++i)
+    {
+        Parameter const& parameter = m_parameters[i];
+        std::uint32_t bits         = 0;
+        if (parameter.type == BOOL)
+        {
+            bits = *static_cast<bool const*>(parameter.value) ? 1 : 0;
+        }
+        else
+        {
+            std::memcpy(&bits, parameter.value, sizeof(bits));
+        }
+        m_values.push_back(bits);
+    }
+}
+
+CameraState FrameRecording::camera(std::size_t frame) const
+{
+    if (m_cameras.empty())
+    {
+        throw std::runtime_error("FrameRecording: no frames recorded");
+    }
+    return m_cameras[std::min(frame, m_cameras.size() - 1)];
+}
+
+void FrameRecording::replay(std::size_t frame, Stage stage)
+{
+    if (m_cameras.empty())
+    {
+        return;
+    }
+    frame = std::min(frame, m_cameras.size() - 1);
+    for (std::size_t i = 0; i < m_stored; ++i)
+    {
+        Parameter const& parameter = m_parameters[i];
+        std::uint32_t const bits   = m_values[frame * m_stored + i];
+        if (!parameter.value || parameter.stage != stage)
+        {
+            continue;
+        }
+        if (parameter.type == BOOL)
+        {
+            *static_cast<bool*>(parameter.value) = bits != 0;
+        }
+        else
+        {
+            std::memcpy(parameter.value, &bits, sizeof(bits));
+        }
+    }
+}
+
+void FrameRecording::write(std::string const& path) const
+{
+    static_assert(sizeof(CameraState) == CAMERA_SIZE, "CameraState must be 9 packed floats");
+    // write aside and rename so an interrupted write keeps the previous recording
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version         = VERSION;
+        header.parameter_count = std::uint32_t(m_stored);
+        header.frame_count     = std::uint32_t(m_cameras.size());
+        write_value(file, header);
+        for (std::size_t i = 0; i < m_stored; ++i)
+        {
+            write_value(file, std::uint32_t(m_parameters[i].type));
+            write_value(file, std::uint32_t(m_parameters[i].name.size()));
+            file.write(m_parameters[i].name.data(), std::streamsize(m_parameters[i].name.size()));
+        }
+        for (std::size_t frame = 0; frame < m_cameras.size(); ++frame)
+        {
+            write_value(file, m_cameras[frame]);
+            file.write(reinterpret_cast<char const*>(m_values.data() + frame * m_stored),
+                       std::streamsize(m_stored * sizeof(std::uint32_t)));
+        }
+        if (!file)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not write \'" + path + "\'");
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write \'" + path + "\'");
+    }
+}
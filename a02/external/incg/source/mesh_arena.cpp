@@ -0,0 +1,221 @@
+#include "mesh_arena.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include "gl_state.hpp"
+
+MeshArena::MeshArena() {
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  multi_draw_indirect = major > 4 || (major == 4 && minor >= 3);
+
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &instance_buffer);
+  glGenBuffers(1, &indirect_buffer);
+}
+
+MeshArena::~MeshArena() {
+  GLuint buffers[4] = {vertex_buffer, index_buffer, instance_buffer,
+                       indirect_buffer};
+  glDeleteBuffers(4, buffers);
+  gl_state::forget_vertex_array(vao);
+  glDeleteVertexArrays(1, &vao);
+}
+
+void MeshArena::grow(GLuint &buffer, size_t &capacity, size_t used,
+                     size_t required, GLenum target) {
+  if (required <= capacity)
+    return;
+  // double capacity to amortize copies when many meshes are added
+  size_t new_capacity = std::max(required, capacity * 2);
+  GLuint new_buffer = 0;
+  glGenBuffers(1, &new_buffer);
+  glBindBuffer(target, new_buffer);
+  glBufferData(target, new_capacity, nullptr, GL_STATIC_DRAW);
+  if (used > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, target, 0, 0, used);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  }
+  glBindBuffer(target, 0);
+  glDeleteBuffers(1, &buffer);
+  buffer = new_buffer;
+  capacity = new_capacity;
+}
+
+void MeshArena::setupAttributes() {
+  gl_state::bind_vertex_array(vao);
+
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+  glEnableVertexAttribArray(ARENA_POSITION);
+  glVertexAttribPointer(ARENA_POSITION, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(ArenaVertex),
+                        (void *)offsetof(ArenaVertex, position));
+  glEnableVertexAttribArray(ARENA_NORMAL);
+  glVertexAttribPointer(ARENA_NORMAL, 3, GL_FLOAT, GL_FALSE,
+                        sizeof(ArenaVertex),
+                        (void *)offsetof(ArenaVertex, normal));
+
+  glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+  for (GLuint i = 0; i < 4; ++i) {
+    glEnableVertexAttribArray(ARENA_INSTANCE_MODEL + i);
+    glVertexAttribPointer(
+        ARENA_INSTANCE_MODEL + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        (void *)(offsetof(InstanceData, modelMatrix) + i * sizeof(glm::fvec4)));
+    glVertexAttribDivisor(ARENA_INSTANCE_MODEL + i, 1);
+  }
+  glEnableVertexAttribArray(ARENA_INSTANCE_COLOR);
+  glVertexAttribPointer(ARENA_INSTANCE_COLOR, 4, GL_FLOAT, GL_FALSE,
+                        sizeof(InstanceData),
+                        (void *)offsetof(InstanceData, color));
+  glVertexAttribDivisor(ARENA_INSTANCE_COLOR, 1);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+  gl_state::bind_vertex_array(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+MeshRange MeshArena::add(std::vector<glm::vec3> const &vertices,
+                         std::vector<glm::vec3> const &normals,
+                         std::vector<uint32_t> const &indices) {
+  if (vertices.size() != normals.size()) {
+    throw std::invalid_argument(
+        "MeshArena: vertex and normal count differ");
+  }
+  std::vector<ArenaVertex> interleaved(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i)
+    interleaved[i] = ArenaVertex{vertices[i], normals[i]};
+
+  size_t vertex_bytes = vertex_count * sizeof(ArenaVertex);
+  size_t index_bytes = index_count * sizeof(uint32_t);
+  GLuint old_vertex_buffer = vertex_buffer, old_index_buffer = index_buffer;
+  grow(vertex_buffer, vertex_capacity, vertex_bytes,
+       vertex_bytes + interleaved.size() * sizeof(ArenaVertex),
+       GL_ARRAY_BUFFER);
+  grow(index_buffer, index_capacity, index_bytes,
+       index_bytes + indices.size() * sizeof(uint32_t), GL_ARRAY_BUFFER);
+  if (vertex_buffer != old_vertex_buffer || index_buffer != old_index_buffer)
+    setupAttributes();
+
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, vertex_bytes,
+                  interleaved.size() * sizeof(ArenaVertex), interleaved.data());
+  // indices stay relative to the mesh, base vertex offsets them at draw time
+  glBindBuffer(GL_ARRAY_BUFFER, index_buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, index_bytes,
+                  indices.size() * sizeof(uint32_t), indices.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  MeshRange mesh;
+  mesh.firstIndex = GLuint(index_count);
+  mesh.indexCount = GLuint(indices.size());
+  mesh.baseVertex = GLint(vertex_count);
+  vertex_count += vertices.size();
+  index_count += indices.size();
+  return mesh;
+}
+
+void MeshArena::bind() const { gl_state::bind_vertex_array(vao); }
+
+void MeshArena::draw(MeshRange const &mesh) const {
+  gl_state::bind_vertex_array(vao);
+  // instance arrays off, the shader reads the constant values set here instead
+  // of whatever the last batch left in the instance buffer
+  for (GLuint i = 0; i < 4; ++i) {
+    glDisableVertexAttribArray(ARENA_INSTANCE_MODEL + i);
+    glVertexAttrib4f(ARENA_INSTANCE_MODEL + i, i == 0 ? 1.0f : 0.0f,
+                     i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f,
+                     i == 3 ? 1.0f : 0.0f);
+  }
+  glDisableVertexAttribArray(ARENA_INSTANCE_COLOR);
+  glVertexAttrib4f(ARENA_INSTANCE_COLOR, 1.0f, 1.0f, 1.0f, 0.0f);
+
+  glDrawElementsBaseVertex(
+      GL_TRIANGLES, GLsizei(mesh.indexCount), GL_UNSIGNED_INT,
+      (void *)(size_t(mesh.firstIndex) * sizeof(uint32_t)), mesh.baseVertex);
+
+  for (GLuint i = 0; i < 4; ++i)
+    glEnableVertexAttribArray(ARENA_INSTANCE_MODEL + i);
+  glEnableVertexAttribArray(ARENA_INSTANCE_COLOR);
+}
+
+void MeshArena::drawIndirect(
+    std::vector<DrawElementsIndirectCommand> const &commands,
+    std::vector<InstanceData> const &instances) {
+  if (commands.empty())
+    return;
+  // orphan streamed buffers, the driver hands out fresh storage each frame
+  glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+  glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData),
+               nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData),
+                  instances.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  gl_state::bind_vertex_array(vao);
+  if (multi_draw_indirect) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 commands.size() * sizeof(DrawElementsIndirectCommand),
+                 commands.data(), GL_STREAM_DRAW);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+                                GLsizei(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  } else {
+    // gl 4.2 fallback, same commands issued one by one
+    for (auto const &command : commands)
+      glDrawElementsInstancedBaseVertexBaseInstance(
+          GL_TRIANGLES, GLsizei(command.count), GL_UNSIGNED_INT,
+          (void *)(size_t(command.firstIndex) * sizeof(uint32_t)),
+          GLsizei(command.instanceCount), command.baseVertex,
+          command.baseInstance);
+  }
+}
+
+void DrawBatch::add(MeshRange const &mesh, InstanceData const &instance) {
+  auto group =
+      std::find_if(groups.begin(), groups.end(), [&](Group const &g) {
+        return g.mesh.firstIndex == mesh.firstIndex &&
+               g.mesh.baseVertex == mesh.baseVertex;
+      });
+  if (group == groups.end()) {
+    groups.push_back(Group{mesh, {}});
+    group = groups.end() - 1;
+  }
+  group->instances.push_back(instance);
+  ++instance_count;
+  triangle_count += mesh.indexCount / 3;
+}
+
+void DrawBatch::clear() {
+  // keep group storage to avoid reallocating every frame
+  for (auto &group : groups)
+    group.instances.clear();
+  instance_count = 0;
+  triangle_count = 0;
+}
+
+void DrawBatch::submit(MeshArena &arena) {
+  commands.clear();
+  instances.clear();
+  for (auto const &group : groups) {
+    if (group.instances.empty())
+      continue;
+    DrawElementsIndirectCommand command;
+    command.count = group.mesh.indexCount;
+    command.instanceCount = GLuint(group.instances.size());
+    command.firstIndex = group.mesh.firstIndex;
+    command.baseVertex = group.mesh.baseVertex;
+    command.baseInstance = GLuint(instances.size());
+    commands.push_back(command);
+    instances.insert(instances.end(), group.instances.begin(),
+                     group.instances.end());
+  }
+  arena.drawIndirect(commands, instances);
+}
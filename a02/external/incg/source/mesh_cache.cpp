@@ -0,0 +1,524 @@
+#include "mesh_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace mesh_cache
+{
+namespace
+{
+char const MAGIC[4] = {'I', 'N', 'C', 'M'};
+// size of the lru cache the triangle order is optimized for
+std::size_t const FORSYTH_CACHE_SIZE = 32;
+
+std::size_t align(std::size_t offset, std::size_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+std::uint32_t vertex_stride(NormalEncoding encoding)
+{
+    switch (encoding)
+    {
+        case NORMAL_FLOAT:
+            return 24;
+        case NORMAL_HALF:
+            return 20;
+        case NORMAL_OCTAHEDRAL:
+            return 16;
+    }
+    throw std::invalid_argument("mesh_cache: unknown normal encoding");
+}
+
+glm::vec2 octahedral_encode(glm::vec3 n)
+{
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 p{n.x, n.y};
+    if (n.z < 0.0f)
+    {
+        p = glm::vec2{(1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)};
+    }
+    return p;
+}
+
+glm::vec3 octahedral_decode(glm::vec2 p)
+{
+    glm::vec3 n{p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y)};
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+// weight of a vertex by its lru position and number of triangles still using it
+float vertex_score(int cache_position, std::uint32_t live_triangles)
+{
+    if (live_triangles == 0)
+    {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        // the last triangle's vertices score the same so it is not simply continued
+        score = cache_position < 3
+                    ? 0.75f
+                    : std::pow(1.0f - float(cache_position - 3) / float(FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    // favour vertices with few remaining triangles to finish them off
+    return score + 2.0f / std::sqrt(float(live_triangles));
+}
+
+// exact duplicates are welded, obj_loader only merges equal index tuples
+struct WeldKey
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+
+    bool operator==(WeldKey const& other) const { return std::memcmp(this, &other, sizeof(WeldKey)) == 0; }
+};
+
+struct WeldHash
+{
+    std::size_t operator()(WeldKey const& key) const
+    {
+        std::uint32_t words[6];
+        std::memcpy(words, &key, sizeof(words));
+        std::size_t hash = 14695981039346656037ull;
+        for (std::uint32_t word : words)
+        {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+std::int64_t modification_time(struct stat const& info)
+{
+    return std::int64_t(info.st_mtime);
+}
+}  // namespace
+
+File::File(std::string const& path)
+    : m_mapped{new MappedFile{path}}, m_image{}, m_data{m_mapped->data()}, m_size{m_mapped->size()}
+{
+    validate(path);
+}
+
+File::File(std::vector<char> image)
+    : m_mapped{}, m_image{std::move(image)}, m_data{m_image.data()}, m_size{m_image.size()}
+{
+    validate("mesh cache");
+}
+
+void File::validate(std::string const& name) const
+{
+    if (m_size < sizeof(Header) || std::memcmp(header().magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw std::runtime_error(name + ": not a mesh cache");
+    }
+    Header const& h = header();
+    if (h.version != VERSION)
+    {
+        throw std::runtime_error(name + ": mesh cache version " + std::to_string(h.version) + ", expected " +
+                                 std::to_string(VERSION));
+    }
+    bool valid = h.normal_encoding <= NORMAL_OCTAHEDRAL &&
+                 h.vertex_stride == vertex_stride(NormalEncoding(h.normal_encoding)) &&
+                 (h.index_size == 2 || h.index_size == 4) && h.lod_count >= 1 &&
+                 h.vertex_offset >= sizeof(Header) + std::uint64_t(h.lod_count) * sizeof(mesh_simplify::Lod) &&
+                 h.vertex_offset + std::uint64_t(h.vertex_count) * h.vertex_stride <= h.index_offset &&
+                 h.index_offset + std::uint64_t(h.index_count) * h.index_size <= m_size;
+    if (valid)
+    {
+        for (mesh_simplify::Lod const& lod : lods())
+        {
+            valid = valid && std::uint64_t(lod.first_index) + lod.index_count <= h.index_count;
+        }
+    }
+    if (!valid)
+    {
+        throw std::runtime_error(name + ": mesh cache truncated or corrupt");
+    }
+}
+
+std::vector<mesh_simplify::Lod> File::lods() const
+{
+    std::vector<mesh_simplify::Lod> lods(header().lod_count);
+    std::memcpy(lods.data(), m_data + sizeof(Header), lods.size() * sizeof(mesh_simplify::Lod));
+    return lods;
+}
+
+void File::unpack(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals,
+                  std::vector<std::uint32_t>& indices) const
+{
+    Header const& h = header();
+    positions.resize(h.vertex_count);
+    normals.resize(h.vertex_count);
+    char const* vertex = vertices();
+    for (std::uint32_t i = 0; i < h.vertex_count; ++i, vertex += h.vertex_stride)
+    {
+        std::memcpy(&positions[i], vertex, sizeof(glm::vec3));
+        char const* normal = vertex + sizeof(glm::vec3);
+        if (h.normal_encoding == NORMAL_FLOAT)
+        {
+            std::memcpy(&normals[i], normal, sizeof(glm::vec3));
+        }
+        else if (h.normal_encoding == NORMAL_HALF)
+        {
+            glm::uint64 packed;
+            std::memcpy(&packed, normal, sizeof(packed));
+            normals[i] = glm::vec3(glm::unpackHalf4x16(packed));
+        }
+        else
+        {
+            glm::uint32 packed;
+            std::memcpy(&packed, normal, sizeof(packed));
+            normals[i] = octahedral_decode(glm::unpackSnorm2x16(packed));
+        }
+    }
+    indices.resize(h.index_count);
+    if (h.index_size == 4)
+    {
+        std::memcpy(indices.data(), this->indices(), indices.size() * sizeof(std::uint32_t));
+        return;
+    }
+    char const* index = this->indices();
+    for (std::uint32_t i = 0; i < h.index_count; ++i, index += sizeof(std::uint16_t))
+    {
+        std::uint16_t value;
+        std::memcpy(&value, index, sizeof(value));
+        indices[i] = value;
+    }
+}
+
+void File::write(std::string const& path) const
+{
+    // write aside and rename so readers never map a partial file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file{temporary, std::ios::binary | std::ios::trunc};
+        file.write(m_data, std::streamsize(m_size));
+        if (!file)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not write \'" + path + "\'");
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write \'" + path + "\'");
+    }
+}
+
+std::vector<std::uint32_t> optimize_vertex_cache(std::vector<std::uint32_t> const& indices,
+                                                 std::size_t vertex_count)
+{
+    std::size_t const triangle_count = indices.size() / 3;
+    // triangles of each vertex, the first live[v] entries are not emitted yet
+    std::vector<std::uint32_t> live(vertex_count, 0);
+    for (std::uint32_t index : indices)
+    {
+        ++live[index];
+    }
+    std::vector<std::uint32_t> offsets(vertex_count + 1, 0);
+    for (std::size_t v = 0; v < vertex_count; ++v)
+    {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<std::uint32_t> adjacency(indices.size());
+    {
+        std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+        {
+            adjacency[fill[indices[i]]++] = std::uint32_t(i / 3);
+        }
+    }
+
+    std::vector<float> score(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v)
+    {
+        score[v] = vertex_score(-1, live[v]);
+    }
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<char> emitted(triangle_count, 0);
+    std::vector<std::uint32_t> cache{};
+    std::vector<std::uint32_t> next_cache{};
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    std::vector<std::uint32_t> result{};
+    result.reserve(triangle_count * 3);
+    std::size_t cursor = 0;
+    long best          = -1;
+    while (result.size() < triangle_count * 3)
+    {
+        if (best < 0)
+        {
+            // nothing adjacent to the cache, continue with the next triangle in input order
+            while (emitted[cursor])
+            {
+                ++cursor;
+            }
+            best = long(cursor);
+        }
+        std::uint32_t const* triangle = &indices[std::size_t(best) * 3];
+        emitted[std::size_t(best)]    = 1;
+        next_cache.clear();
+        for (int k = 0; k < 3; ++k)
+        {
+            std::uint32_t v = triangle[k];
+            result.push_back(v);
+            std::uint32_t* begin = &adjacency[offsets[v]];
+            std::uint32_t* end   = begin + live[v];
+            std::iter_swap(std::find(begin, end, std::uint32_t(best)), end - 1);
+            --live[v];
+            if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end())
+            {
+                next_cache.push_back(v);
+            }
+        }
+        for (std::uint32_t v : cache)
+        {
+            if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end())
+            {
+                next_cache.push_back(v);
+            }
+        }
+        cache.swap(next_cache);
+
+        for (std::size_t i = 0; i < cache.size(); ++i)
+        {
+            std::uint32_t v   = cache[i];
+            cache_position[v] = i < FORSYTH_CACHE_SIZE ? int(i) : -1;
+            score[v]          = vertex_score(cache_position[v], live[v]);
+        }
+        if (cache.size() > FORSYTH_CACHE_SIZE)
+        {
+            cache.resize(FORSYTH_CACHE_SIZE);
+        }
+
+        // only triangles touching the cache changed their score
+        best             = -1;
+        float best_score = -1.0f;
+        for (std::uint32_t v : cache)
+        {
+            for (std::uint32_t i = offsets[v]; i < offsets[v] + live[v]; ++i)
+            {
+                std::uint32_t t = adjacency[i];
+                float const s   = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                if (s > best_score)
+                {
+                    best_score = s;
+                    best       = long(t);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+float acmr(std::vector<std::uint32_t> const& indices, std::size_t cache_size)
+{
+    if (indices.empty())
+    {
+        return 0.0f;
+    }
+    // fifo holds the vertices of the last cache_size misses
+    std::vector<std::size_t> inserted(*std::max_element(indices.begin(), indices.end()) + 1, 0);
+    std::size_t misses = 0;
+    for (std::uint32_t index : indices)
+    {
+        if (inserted[index] == 0 || misses - inserted[index] >= cache_size)
+        {
+            inserted[index] = ++misses;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+std::vector<char> build(obj_loader::Mesh const& mesh, NormalEncoding encoding, std::uint64_t source_size,
+                        std::int64_t source_time)
+{
+    // weld identical vertices
+    std::vector<WeldKey> welded{};
+    std::vector<std::uint32_t> indices(mesh.indices.size());
+    {
+        std::unordered_map<WeldKey, std::uint32_t, WeldHash> unique{};
+        unique.reserve(mesh.positions.size());
+        std::vector<std::uint32_t> remap(mesh.positions.size());
+        for (std::size_t i = 0; i < mesh.positions.size(); ++i)
+        {
+            WeldKey key{mesh.positions[i], mesh.normals[i]};
+            auto inserted = unique.emplace(key, std::uint32_t(welded.size()));
+            if (inserted.second)
+            {
+                welded.push_back(key);
+            }
+            remap[i] = inserted.first->second;
+        }
+        for (std::size_t i = 0; i < indices.size(); ++i)
+        {
+            indices[i] = remap[mesh.indices[i]];
+        }
+    }
+
+    indices = optimize_vertex_cache(indices, welded.size());
+
+    // number vertices by first use so fetches walk the buffer forward
+    std::vector<std::uint32_t> order(welded.size(), std::uint32_t(-1));
+    std::vector<WeldKey> vertices{};
+    vertices.reserve(welded.size());
+    for (std::uint32_t& index : indices)
+    {
+        if (order[index] == std::uint32_t(-1))
+        {
+            order[index] = std::uint32_t(vertices.size());
+            vertices.push_back(welded[index]);
+        }
+        index = order[index];
+    }
+
+    // levels collapse onto the vertices of the full mesh, each is ordered for the cache on its own
+    std::vector<mesh_simplify::Lod> lods{};
+    {
+        std::vector<glm::vec3> positions(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            positions[i] = vertices[i].position;
+        }
+        indices = mesh_simplify::build_lods(positions, indices, lods);
+        for (std::size_t level = 1; level < lods.size(); ++level)
+        {
+            auto first = indices.begin() + lods[level].first_index;
+            std::vector<std::uint32_t> optimized =
+                optimize_vertex_cache(std::vector<std::uint32_t>(first, first + lods[level].index_count), vertices.size());
+            std::copy(optimized.begin(), optimized.end(), first);
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version         = VERSION;
+    header.normal_encoding = encoding;
+    header.vertex_stride   = vertex_stride(encoding);
+    header.vertex_count    = std::uint32_t(vertices.size());
+    header.index_count     = std::uint32_t(indices.size());
+    header.index_size      = vertices.size() <= 0xffff ? 2 : 4;
+    header.lod_count       = std::uint32_t(lods.size());
+    header.source_size     = source_size;
+    header.source_time     = source_time;
+    // gl needs aligned attributes, 16 keeps whole vertices in as few cache lines as possible
+    header.vertex_offset = align(sizeof(Header) + lods.size() * sizeof(mesh_simplify::Lod), 16);
+    header.index_offset  = align(header.vertex_offset + std::size_t(header.vertex_count) * header.vertex_stride, 4);
+    glm::vec3 bounds_min{vertices.empty() ? 0.0f : INFINITY};
+    glm::vec3 bounds_max{vertices.empty() ? 0.0f : -INFINITY};
+    for (auto const& vertex : vertices)
+    {
+        bounds_min = glm::min(bounds_min, vertex.position);
+        bounds_max = glm::max(bounds_max, vertex.position);
+    }
+    std::memcpy(header.bounds_min, &bounds_min, sizeof(header.bounds_min));
+    std::memcpy(header.bounds_max, &bounds_max, sizeof(header.bounds_max));
+
+    std::vector<char> image(std::size_t(header.index_offset) + std::size_t(header.index_count) * header.index_size, 0);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + sizeof(header), lods.data(), lods.size() * sizeof(mesh_simplify::Lod));
+    char* out = image.data() + header.vertex_offset;
+    for (auto const& vertex : vertices)
+    {
+        std::memcpy(out, &vertex.position, sizeof(glm::vec3));
+        char* normal = out + sizeof(glm::vec3);
+        if (encoding == NORMAL_FLOAT)
+        {
+            std::memcpy(normal, &vertex.normal, sizeof(glm::vec3));
+        }
+        else if (encoding == NORMAL_HALF)
+        {
+            glm::uint64 packed = glm::packHalf4x16(glm::vec4(vertex.normal, 0.0f));
+            std::memcpy(normal, &packed, sizeof(packed));
+        }
+        else
+        {
+            glm::uint32 packed = glm::packSnorm2x16(octahedral_encode(vertex.normal));
+            std::memcpy(normal, &packed, sizeof(packed));
+        }
+        out += header.vertex_stride;
+    }
+    out = image.data() + header.index_offset;
+    for (std::uint32_t index : indices)
+    {
+        if (header.index_size == 2)
+        {
+            std::uint16_t value = std::uint16_t(index);
+            std::memcpy(out, &value, sizeof(value));
+        }
+        else
+        {
+            std::memcpy(out, &index, sizeof(index));
+        }
+        out += header.index_size;
+    }
+    return image;
+}
+
+std::string cache_path(std::string const& obj_path)
+{
+    return obj_path + ".mesh";
+}
+
+File load(std::string const& obj_path, NormalEncoding encoding)
+{
+    struct stat source;
+    if (stat(obj_path.c_str(), &source) != 0)
+    {
+        std::cerr << "File \'" << obj_path << "\' not found" << std::endl;
+        throw std::runtime_error(obj_path);
+    }
+    std::string const path = cache_path(obj_path);
+    struct stat cached;
+    if (stat(path.c_str(), &cached) == 0)
+    {
+        try
+        {
+            File file{path};
+            Header const& header = file.header();
+            if (header.source_size == std::uint64_t(source.st_size) &&
+                header.source_time == modification_time(source) && header.normal_encoding == encoding)
+            {
+                return file;
+            }
+        }
+        catch (std::runtime_error const& error)
+        {
+            std::cerr << "Mesh cache " << error.what() << ", rebuilding" << std::endl;
+        }
+    }
+
+    File file{build(obj_loader::load(obj_path), encoding, std::uint64_t(source.st_size), modification_time(source))};
+    try
+    {
+        file.write(path);
+    }
+    catch (std::runtime_error const& error)
+    {
+        // read only resource folder, keep using the in-memory image
+        std::cerr << error.what() << ", mesh cache not saved" << std::endl;
+    }
+    return file;
+}
+}  // namespace mesh_cache
@@ -0,0 +1,372 @@
+#include "render_graph.hpp"
+
+#include <glbinding/gl/bitfield.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "gl_state.hpp"
+#include "window_handler.hpp"
+
+namespace
+{
+unsigned bits(MemoryBarrierMask mask) { return static_cast<unsigned>(mask); }
+
+// reads that see image writes only after a barrier
+const unsigned IMAGE_WRITE_BARRIERS = bits(GL_TEXTURE_FETCH_BARRIER_BIT) | bits(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT) |
+                                      bits(GL_FRAMEBUFFER_BARRIER_BIT);
+}  // namespace
+
+bool operator==(TextureDesc const& lhs, TextureDesc const& rhs)
+{
+    return lhs.dimensions == rhs.dimensions && lhs.internal_format == rhs.internal_format;
+}
+
+bool operator!=(TextureDesc const& lhs, TextureDesc const& rhs) { return !(lhs == rhs); }
+
+TexturePool::TexturePool(unsigned retire_frames)
+    : m_entries{}, m_retire_frames{retire_frames}, m_frame{0}, m_allocations{0}
+{
+}
+
+Tex& TexturePool::acquire(TextureDesc const& desc)
+{
+    for (auto& entry : m_entries)
+    {
+        if (!entry.in_use && entry.desc == desc)
+        {
+            entry.in_use   = true;
+            entry.last_use = m_frame;
+            return *entry.texture;
+        }
+    }
+    m_entries.push_back(Entry{std::unique_ptr<Tex>{new Tex{desc.dimensions, desc.internal_format}}, desc, true, m_frame});
+    ++m_allocations;
+    return *m_entries.back().texture;
+}
+
+void TexturePool::release(Tex const& texture)
+{
+    for (auto& entry : m_entries)
+    {
+        if (entry.texture.get() == &texture)
+        {
+            entry.in_use   = false;
+            entry.last_use = m_frame;
+            return;
+        }
+    }
+    throw std::runtime_error("TexturePool: released texture was not acquired from this pool");
+}
+
+std::vector<GLuint> TexturePool::endFrame()
+{
+    ++m_frame;
+    std::vector<GLuint> retired{};
+    auto idle = [&](Entry const& entry) {
+        if (entry.in_use || m_frame - entry.last_use <= m_retire_frames)
+        {
+            return false;
+        }
+        retired.push_back(entry.texture->index());
+        return true;
+    };
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), idle), m_entries.end());
+    return retired;
+}
+
+std::size_t TexturePool::size() const { return m_entries.size(); }
+
+std::size_t TexturePool::allocations() const { return m_allocations; }
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, std::size_t pass) : m_graph(graph), m_pass{pass} {}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::sample(Resource texture, GLuint unit)
+{
+    m_graph.use(m_pass, texture, SAMPLE, unit, GL_READ_ONLY);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::image(Resource texture, GLuint unit, GLenum access)
+{
+    m_graph.use(m_pass, texture, IMAGE, unit, access);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::color(Resource texture)
+{
+    m_graph.use(m_pass, texture, COLOR, 0, GL_WRITE_ONLY);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::depth(Resource texture)
+{
+    m_graph.use(m_pass, texture, DEPTH, 0, GL_WRITE_ONLY);
+    return *this;
+}
+
+RenderGraph::RenderGraph(unsigned retire_frames)
+    : m_pool{retire_frames},
+      m_passes{},
+      m_resources{},
+      m_histories{},
+      m_framebuffers{},
+      m_pending{},
+      m_frame{0},
+      m_barriers{0}
+{
+}
+
+RenderGraph::Resource RenderGraph::transient(TextureDesc const& desc)
+{
+    m_resources.push_back(Entry{desc, nullptr, true});
+    return Resource{unsigned(m_resources.size() - 1)};
+}
+
+RenderGraph::History RenderGraph::history(std::string const& name, TextureDesc const& desc)
+{
+    bool reset = false;
+    auto pair  = m_histories.find(name);
+    if (pair == m_histories.end() || pair->second.desc != desc)
+    {
+        if (pair != m_histories.end())
+        {
+            m_pool.release(*pair->second.textures[0]);
+            m_pool.release(*pair->second.textures[1]);
+            m_histories.erase(pair);
+        }
+        HistoryPair created{desc, {&m_pool.acquire(desc), &m_pool.acquire(desc)}, 0, m_frame};
+        pair  = m_histories.emplace(name, created).first;
+        reset = true;
+    }
+    HistoryPair& ping_pong = pair->second;
+    ping_pong.last_use     = m_frame;
+
+    m_resources.push_back(Entry{desc, ping_pong.textures[1 - ping_pong.current], false});
+    m_resources.push_back(Entry{desc, ping_pong.textures[ping_pong.current], false});
+    unsigned current = unsigned(m_resources.size() - 1);
+    return History{Resource{current - 1}, Resource{current}, reset};
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(std::string const& name, std::function<void()> const& run)
+{
+    m_passes.push_back(Pass{name, run, {}});
+    return PassBuilder{*this, m_passes.size() - 1};
+}
+
+void RenderGraph::use(std::size_t pass, Resource resource, Access access, GLuint unit, GLenum image_access)
+{
+    if (resource.index >= m_resources.size())
+    {
+        throw std::runtime_error("RenderGraph: pass " + m_passes[pass].name + " uses an unknown resource");
+    }
+    m_passes[pass].uses.push_back(Use{resource.index, access, unit, image_access});
+}
+
+void RenderGraph::execute(glm::uvec2 const& output)
+{
+    m_barriers = 0;
+    // transients are released after the pass using them last
+    std::vector<std::vector<unsigned>> releases(m_passes.size());
+    {
+        std::vector<std::size_t> last(m_resources.size(), m_passes.size());
+        for (std::size_t pass = 0; pass < m_passes.size(); ++pass)
+        {
+            for (auto const& use : m_passes[pass].uses)
+            {
+                last[use.resource] = pass;
+            }
+        }
+        for (unsigned resource = 0; resource < m_resources.size(); ++resource)
+        {
+            if (m_resources[resource].transient && last[resource] < m_passes.size())
+            {
+                releases[last[resource]].push_back(resource);
+            }
+        }
+    }
+
+    for (std::size_t pass = 0; pass < m_passes.size(); ++pass)
+    {
+        for (auto const& use : m_passes[pass].uses)
+        {
+            Entry& entry = m_resources[use.resource];
+            if (!entry.texture)
+            {
+                entry.texture = &m_pool.acquire(entry.desc);
+            }
+        }
+        prepare(m_passes[pass], output);
+        m_passes[pass].run();
+
+        for (auto const& use : m_passes[pass].uses)
+        {
+            if (use.access == IMAGE && use.image_access != GL_READ_ONLY)
+            {
+                m_pending[m_resources[use.resource].texture->index()] = IMAGE_WRITE_BARRIERS;
+            }
+        }
+        for (unsigned resource : releases[pass])
+        {
+            m_pool.release(*m_resources[resource].texture);
+        }
+    }
+
+    for (auto& pair : m_histories)
+    {
+        if (pair.second.last_use == m_frame)
+        {
+            pair.second.current = 1 - pair.second.current;
+        }
+    }
+    m_passes.clear();
+    m_resources.clear();
+
+    // forget framebuffers and barriers of deleted textures, their names may be reused
+    for (GLuint name : m_pool.endFrame())
+    {
+        m_pending.erase(name);
+        for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end();)
+        {
+            auto const& key = framebuffer->first;
+            if (std::find(key.begin(), key.end(), name) != key.end())
+            {
+                framebuffer = m_framebuffers.erase(framebuffer);
+            }
+            else
+            {
+                ++framebuffer;
+            }
+        }
+    }
+    ++m_frame;
+}
+
+void RenderGraph::prepare(Pass const& pass, glm::uvec2 const& output)
+{
+    // barriers owed by earlier image writes to the way this pass reads
+    unsigned needed = 0;
+    for (auto const& use : pass.uses)
+    {
+        auto pending = m_pending.find(m_resources[use.resource].texture->index());
+        if (pending == m_pending.end())
+        {
+            continue;
+        }
+        switch (use.access)
+        {
+            case SAMPLE:
+                needed |= pending->second & bits(GL_TEXTURE_FETCH_BARRIER_BIT);
+                break;
+            case IMAGE:
+                needed |= pending->second & bits(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                break;
+            default:
+                needed |= pending->second & bits(GL_FRAMEBUFFER_BARRIER_BIT);
+                break;
+        }
+    }
+    if (needed)
+    {
+        glMemoryBarrier(static_cast<MemoryBarrierMask>(needed));
+        ++m_barriers;
+        for (auto pending = m_pending.begin(); pending != m_pending.end();)
+        {
+            pending->second &= ~needed;
+            pending = pending->second ? std::next(pending) : m_pending.erase(pending);
+        }
+    }
+
+    // render targets, colors in declaration order and depth last
+    std::vector<GLuint> key{};
+    Tex const* depth = nullptr;
+    glm::uvec2 size  = output;
+    for (auto const& use : pass.uses)
+    {
+        Tex const& texture = *m_resources[use.resource].texture;
+        if (use.access == COLOR)
+        {
+            key.push_back(texture.index());
+            size = texture.dimensions();
+        }
+        else if (use.access == DEPTH)
+        {
+            depth = &texture;
+            size  = texture.dimensions();
+        }
+    }
+    if (depth)
+    {
+        key.push_back(depth->index());
+    }
+    if (key.empty())
+    {
+        gl_state::bind_framebuffer(GL_FRAMEBUFFER, window_handler::default_framebuffer());
+    }
+    else
+    {
+        auto framebuffer = m_framebuffers.find(key);
+        if (framebuffer == m_framebuffers.end())
+        {
+            Fbo created{};
+            created.bind();
+            for (auto const& use : pass.uses)
+            {
+                if (use.access == COLOR)
+                {
+                    created.addTextureAsColorbuffer(*m_resources[use.resource].texture);
+                }
+            }
+            if (depth)
+            {
+                created.addTextureAsDepthbuffer(*depth);
+            }
+            created.check();
+            framebuffer = m_framebuffers.emplace(key, std::move(created)).first;
+        }
+        framebuffer->second.bind();
+    }
+    glViewport(0, 0, GLsizei(size.x), GLsizei(size.y));
+
+    for (auto const& use : pass.uses)
+    {
+        Entry const& entry = m_resources[use.resource];
+        if (use.access == SAMPLE)
+        {
+            entry.texture->bind(use.unit);
+        }
+        else if (use.access == IMAGE)
+        {
+            gl_state::bind_image_texture(use.unit, entry.texture->index(), 0, GL_FALSE, 0, use.image_access,
+                                         entry.desc.internal_format);
+        }
+    }
+}
+
+Tex const& RenderGraph::texture(Resource resource) const
+{
+    Tex const* texture = resource.index < m_resources.size() ? m_resources[resource.index].texture : nullptr;
+    if (!texture)
+    {
+        throw std::runtime_error("RenderGraph: resource is not allocated outside its passes");
+    }
+    return *texture;
+}
+
+Tex const& RenderGraph::previous(std::string const& name) const
+{
+    auto pair = m_histories.find(name);
+    if (pair == m_histories.end())
+    {
+        throw std::runtime_error("RenderGraph: unknown history " + name);
+    }
+    return *pair->second.textures[1 - pair->second.current];
+}
+
+TexturePool const& RenderGraph::pool() const { return m_pool; }
+
+std::size_t RenderGraph::framebuffers() const { return m_framebuffers.size(); }
+
+unsigned RenderGraph::barriers() const { return m_barriers; }
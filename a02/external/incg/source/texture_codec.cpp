@@ -0,0 +1,268 @@
+#include "texture_codec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace texture_codec
+{
+namespace
+{
+// texels of a 4x4 block, border blocks repeat the last row and column
+void fetch_block(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& dimensions, unsigned block_x,
+                 unsigned block_y, glm::vec4 texels[16])
+{
+    for (unsigned y = 0; y < 4; ++y)
+    {
+        unsigned source_y = std::min(block_y * 4 + y, dimensions.y - 1);
+        for (unsigned x = 0; x < 4; ++x)
+        {
+            unsigned source_x       = std::min(block_x * 4 + x, dimensions.x - 1);
+            std::uint8_t const* rgba = &pixels[(std::size_t(source_y) * dimensions.x + source_x) * 4];
+            texels[y * 4 + x]        = glm::vec4(rgba[0], rgba[1], rgba[2], rgba[3]);
+        }
+    }
+}
+
+std::uint16_t pack_565(glm::vec3 const& color)
+{
+    glm::uvec3 q = glm::uvec3(glm::round(glm::clamp(color, 0.0f, 255.0f) * glm::vec3(31, 63, 31) / 255.0f));
+    return std::uint16_t((q.r << 11) | (q.g << 5) | q.b);
+}
+
+glm::vec3 unpack_565(std::uint16_t color)
+{
+    unsigned r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+// endpoints at the extremes of the block projected onto its principal axis
+void fit_endpoints(glm::vec4 const texels[16], glm::vec3& high, glm::vec3& low)
+{
+    glm::vec3 mean{0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        mean += glm::vec3(texels[i]);
+    }
+    mean /= 16.0f;
+    glm::mat3 covariance{0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        glm::vec3 d = glm::vec3(texels[i]) - mean;
+        covariance += glm::outerProduct(d, d);
+    }
+    // a few power iterations are enough to separate the dominant axis
+    glm::vec3 axis{1.0f, 1.0f, 1.0f};
+    for (int i = 0; i < 8; ++i)
+    {
+        axis = covariance * axis;
+        float length = glm::length(axis);
+        if (length < 1e-6f)
+        {
+            axis = glm::vec3(0.57735f);
+            break;
+        }
+        axis /= length;
+    }
+    float t_min = 1e30f, t_max = -1e30f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = glm::dot(glm::vec3(texels[i]) - mean, axis);
+        t_min   = std::min(t_min, t);
+        t_max   = std::max(t_max, t);
+    }
+    high = mean + axis * t_max;
+    low  = mean + axis * t_min;
+}
+
+// 8 byte color block, four color mode
+void encode_color_block(glm::vec4 const texels[16], std::uint8_t* out)
+{
+    glm::vec3 high, low;
+    fit_endpoints(texels, high, low);
+    std::uint16_t c0 = pack_565(high), c1 = pack_565(low);
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+    }
+    glm::vec3 palette[4];
+    palette[0] = unpack_565(c0);
+    palette[1] = unpack_565(c1);
+    palette[2] = (2.0f * palette[0] + palette[1]) / 3.0f;
+    palette[3] = (palette[0] + 2.0f * palette[1]) / 3.0f;
+
+    std::uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            unsigned best       = 0;
+            float best_distance = 1e30f;
+            for (unsigned p = 0; p < 4; ++p)
+            {
+                glm::vec3 d    = glm::vec3(texels[i]) - palette[p];
+                float distance = glm::dot(d, d);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best          = p;
+                }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+    out[0] = std::uint8_t(c0);
+    out[1] = std::uint8_t(c0 >> 8);
+    out[2] = std::uint8_t(c1);
+    out[3] = std::uint8_t(c1 >> 8);
+    std::memcpy(out + 4, &indices, sizeof(indices));
+}
+
+// 8 byte alpha block, eight value mode with 3 bit indices
+void encode_alpha_block(glm::vec4 const texels[16], std::uint8_t* out)
+{
+    float a_max = 0.0f, a_min = 255.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        a_max = std::max(a_max, texels[i].a);
+        a_min = std::min(a_min, texels[i].a);
+    }
+    unsigned a0 = unsigned(a_max + 0.5f), a1 = unsigned(a_min + 0.5f);
+    float palette[8] = {float(a0), float(a1)};
+    for (unsigned p = 1; p < 7; ++p)
+    {
+        palette[p + 1] = (float(7 - p) * float(a0) + float(p) * float(a1)) / 7.0f;
+    }
+    std::uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            unsigned best       = 0;
+            float best_distance = 1e30f;
+            for (unsigned p = 0; p < 8; ++p)
+            {
+                float distance = std::abs(texels[i].a - palette[p]);
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best          = p;
+                }
+            }
+            indices |= std::uint64_t(best) << (3 * i);
+        }
+    }
+    out[0] = std::uint8_t(a0);
+    out[1] = std::uint8_t(a1);
+    for (unsigned i = 0; i < 6; ++i)
+    {
+        out[2 + i] = std::uint8_t(indices >> (8 * i));
+    }
+}
+
+template <typename EncodeBlock>
+std::vector<std::uint8_t> encode_blocks(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& dimensions,
+                                        std::size_t block_bytes, EncodeBlock const& encode)
+{
+    glm::uvec2 blocks = (dimensions + 3u) / 4u;
+    std::vector<std::uint8_t> result(std::size_t(blocks.x) * blocks.y * block_bytes);
+    glm::vec4 texels[16];
+    for (unsigned y = 0; y < blocks.y; ++y)
+    {
+        for (unsigned x = 0; x < blocks.x; ++x)
+        {
+            fetch_block(pixels, dimensions, x, y, texels);
+            encode(texels, &result[(std::size_t(y) * blocks.x + x) * block_bytes]);
+        }
+    }
+    return result;
+}
+}  // namespace
+
+glm::uvec2 level_dimensions(glm::uvec2 const& dimensions, unsigned level)
+{
+    return glm::max(dimensions >> level, glm::uvec2{1});
+}
+
+unsigned level_count(glm::uvec2 const& dimensions)
+{
+    unsigned count = 1;
+    while (level_dimensions(dimensions, count - 1) != glm::uvec2{1})
+    {
+        ++count;
+    }
+    return count;
+}
+
+std::vector<std::uint8_t> downsample(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& from,
+                                     glm::uvec2 const& to)
+{
+    std::vector<std::uint8_t> result(std::size_t(to.x) * to.y * 4);
+    for (unsigned y = 0; y < to.y; ++y)
+    {
+        unsigned y0 = std::min(2 * y, from.y - 1), y1 = std::min(2 * y + 1, from.y - 1);
+        for (unsigned x = 0; x < to.x; ++x)
+        {
+            unsigned x0 = std::min(2 * x, from.x - 1), x1 = std::min(2 * x + 1, from.x - 1);
+            for (unsigned c = 0; c < 4; ++c)
+            {
+                unsigned sum = pixels[(std::size_t(y0) * from.x + x0) * 4 + c] +
+                               pixels[(std::size_t(y0) * from.x + x1) * 4 + c] +
+                               pixels[(std::size_t(y1) * from.x + x0) * 4 + c] +
+                               pixels[(std::size_t(y1) * from.x + x1) * 4 + c];
+                result[(std::size_t(y) * to.x + x) * 4 + c] = std::uint8_t((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<std::vector<std::uint8_t>> mip_chain(std::vector<std::uint8_t> pixels, glm::uvec2 const& dimensions)
+{
+    std::vector<std::vector<std::uint8_t>> levels{};
+    levels.push_back(std::move(pixels));
+    for (unsigned level = 1; level < level_count(dimensions); ++level)
+    {
+        levels.push_back(downsample(levels.back(), level_dimensions(dimensions, level - 1),
+                                    level_dimensions(dimensions, level)));
+    }
+    return levels;
+}
+
+void flip_rows(std::vector<std::uint8_t>& pixels, glm::uvec2 const& dimensions, std::size_t bytes_per_pixel)
+{
+    std::size_t row_size = std::size_t(dimensions.x) * bytes_per_pixel;
+    for (unsigned y = 0; y < dimensions.y / 2; ++y)
+    {
+        std::swap_ranges(pixels.begin() + y * row_size, pixels.begin() + (y + 1) * row_size,
+                         pixels.begin() + (dimensions.y - y - 1) * row_size);
+    }
+}
+
+std::vector<std::uint8_t> encode_bc1(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& dimensions)
+{
+    return encode_blocks(pixels, dimensions, 8,
+                         [](glm::vec4 const texels[16], std::uint8_t* out) { encode_color_block(texels, out); });
+}
+
+std::vector<std::uint8_t> encode_bc3(std::vector<std::uint8_t> const& pixels, glm::uvec2 const& dimensions)
+{
+    return encode_blocks(pixels, dimensions, 16,
+                         [](glm::vec4 const texels[16], std::uint8_t* out) {
+                             encode_alpha_block(texels, out);
+                             encode_color_block(texels, out + 8);
+                         });
+}
+
+std::vector<std::uint16_t> to_rgba16f(std::vector<std::uint8_t> const& pixels)
+{
+    std::vector<std::uint16_t> result(pixels.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i)
+    {
+        result[i] = glm::packHalf1x16(float(pixels[i]) / 255.0f);
+    }
+    return result;
+}
+}  // namespace texture_codec
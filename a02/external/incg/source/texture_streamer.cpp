@@ -0,0 +1,329 @@
+#include "texture_streamer.hpp"
+
+#include <glbinding/gl/bitfield.h>
+#include <glbinding/gl/enum.h>
+#include <glbinding/gl/functions.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <lodepng.h>
+
+#include "gl_state.hpp"
+#include "texture_codec.hpp"
+
+struct TextureRequest
+{
+    enum State
+    {
+        DECODING,
+        UPLOADING,
+        // all levels staged, waiting for the gpu
+        FINISHING,
+        RESIDENT,
+        FAILED,
+    };
+
+    TextureRequest(std::string const& filename, GLenum wrap_mode, GLuint placeholder)
+        : filename{filename},
+          wrap_mode{wrap_mode},
+          placeholder{placeholder},
+          levels{},
+          dimensions{0, 0},
+          error{},
+          decoded{false},
+          state{DECODING},
+          texture{},
+          level{0},
+          next_row{0},
+          fence{nullptr}
+    {
+    }
+
+    std::string const filename;
+    GLenum const wrap_mode;
+    GLuint const placeholder;
+
+    // written by the worker before decoded is set, full mip chain in png row order
+    std::vector<std::vector<std::uint8_t>> levels;
+    glm::uvec2 dimensions;
+    std::string error;
+    std::atomic<bool> decoded;
+
+    // render thread only
+    State state;
+    std::unique_ptr<Tex> texture;
+    unsigned level;
+    unsigned next_row;
+    GLsync fence;
+};
+
+using texture_codec::level_dimensions;
+
+StreamedTexture::StreamedTexture(std::shared_ptr<TextureRequest> request) : m_request{std::move(request)} {}
+
+void StreamedTexture::bind() const
+{
+    gl_state::bind_texture(GL_TEXTURE_2D, index());
+}
+
+GLuint StreamedTexture::index() const
+{
+    if (!m_request)
+    {
+        return 0;
+    }
+    return m_request->state == TextureRequest::RESIDENT ? m_request->texture->index() : m_request->placeholder;
+}
+
+bool StreamedTexture::resident() const
+{
+    return m_request && m_request->state == TextureRequest::RESIDENT;
+}
+
+bool StreamedTexture::failed() const
+{
+    return m_request && m_request->state == TextureRequest::FAILED;
+}
+
+glm::uvec2 StreamedTexture::dimensions() const
+{
+    return m_request && m_request->state != TextureRequest::DECODING ? m_request->dimensions : glm::uvec2{0, 0};
+}
+
+TextureStreamer::TextureStreamer(std::size_t bytes_per_frame, unsigned threads)
+    : m_bytes_per_frame{bytes_per_frame},
+      m_staging{},
+      m_next_staging{0},
+      m_placeholder{1, 1, GL_RGBA8},
+      m_pending{},
+      m_pool{threads}
+{
+    // neutral grey, close to the average of most environment maps
+    std::uint8_t const grey[4] = {128, 128, 128, 255};
+    m_placeholder.bind();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+
+    for (auto& staging : m_staging)
+    {
+        glGenBuffers(1, &staging.buffer);
+    }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    for (auto& staging : m_staging)
+    {
+        if (staging.fence)
+        {
+            glDeleteSync(staging.fence);
+        }
+        glDeleteBuffers(1, &staging.buffer);
+    }
+    for (auto const& request : m_pending)
+    {
+        if (request->fence)
+        {
+            glDeleteSync(request->fence);
+        }
+    }
+}
+
+StreamedTexture TextureStreamer::load(std::string const& filename, GLenum wrap_mode)
+{
+    auto request = std::make_shared<TextureRequest>(filename, wrap_mode, m_placeholder.index());
+    m_pending.push_back(request);
+    // pending keeps the request alive until decoded is set, which is the worker's last access
+    TextureRequest* target = request.get();
+    m_pool.submit(
+        [target]()
+        {
+            std::vector<std::uint8_t> png{};
+            std::vector<std::uint8_t> pixels{};
+            unsigned width  = 0;
+            unsigned height = 0;
+            unsigned error  = lodepng::load_file(png, target->filename);
+            if (!error)
+            {
+                error = lodepng::decode(pixels, width, height, png);
+            }
+            if (error)
+            {
+                target->error = "LodePNG error - " + std::to_string(error) + ": " + lodepng_error_text(error) +
+                                "\nfailed to load file " + target->filename;
+            }
+            else
+            {
+                // mipmaps are filtered here, so the render thread only copies
+                target->levels = texture_codec::mip_chain(std::move(pixels), glm::uvec2{width, height});
+            }
+            target->dimensions = glm::uvec2{width, height};
+            target->decoded.store(true, std::memory_order_release);
+        });
+    return StreamedTexture{request};
+}
+
+bool TextureStreamer::uploadRows(TextureRequest& request, std::size_t& budget)
+{
+    Staging& staging = m_staging[m_next_staging];
+    if (staging.fence)
+    {
+        GLenum result = glClientWaitSync(staging.fence, GL_NONE_BIT, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            return false;
+        }
+        glDeleteSync(staging.fence);
+        staging.fence = nullptr;
+    }
+
+    // rows of consecutive levels that fit the budget, at least one row so wide textures still progress
+    struct Segment
+    {
+        unsigned level;
+        unsigned first_row;
+        unsigned rows;
+        std::size_t offset;
+    };
+    std::vector<Segment> segments{};
+    std::size_t bytes = 0;
+    for (unsigned level = request.level, row = request.next_row; level < request.levels.size(); ++level, row = 0)
+    {
+        glm::uvec2 const size       = level_dimensions(request.dimensions, level);
+        std::size_t const row_bytes = std::size_t(size.x) * 4;
+        std::size_t fitting         = budget > bytes ? (budget - bytes) / row_bytes : 0;
+        if (segments.empty())
+        {
+            fitting = std::max(std::size_t(1), fitting);
+        }
+        unsigned rows = unsigned(std::min(std::size_t(size.y - row), fitting));
+        if (rows == 0)
+        {
+            break;
+        }
+        segments.push_back(Segment{level, row, rows, bytes});
+        bytes += rows * row_bytes;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.buffer);
+    if (bytes > staging.size)
+    {
+        staging.size = std::max(bytes, m_bytes_per_frame);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, staging.size, nullptr, GL_STREAM_DRAW);
+    }
+    // the fence guarantees the gpu is done with the previous contents
+    auto* target = static_cast<std::uint8_t*>(glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    // png rows are stored top down and gl expects the bottom row first, so the copy flips
+    for (auto const& segment : segments)
+    {
+        glm::uvec2 const size       = level_dimensions(request.dimensions, segment.level);
+        std::size_t const row_bytes = std::size_t(size.x) * 4;
+        std::uint8_t const* pixels  = request.levels[segment.level].data();
+        for (unsigned i = 0; i < segment.rows; ++i)
+        {
+            std::size_t source_row = size.y - 1 - (segment.first_row + i);
+            std::memcpy(target + segment.offset + i * row_bytes, pixels + source_row * row_bytes, row_bytes);
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    request.texture->bind();
+    for (auto const& segment : segments)
+    {
+        glm::uvec2 const size = level_dimensions(request.dimensions, segment.level);
+        glTexSubImage2D(GL_TEXTURE_2D, GLint(segment.level), 0, GLint(segment.first_row), GLsizei(size.x),
+                        GLsizei(segment.rows), GL_RGBA, GL_UNSIGNED_BYTE, (void*)segment.offset);
+        if (segment.first_row + segment.rows == size.y)
+        {
+            // level complete, its pixels are no longer needed
+            std::vector<std::uint8_t>{}.swap(request.levels[segment.level]);
+            request.level    = segment.level + 1;
+            request.next_row = 0;
+        }
+        else
+        {
+            request.next_row = segment.first_row + segment.rows;
+        }
+    }
+    staging.fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT);
+    m_next_staging = (m_next_staging + 1) % STAGING_BUFFERS;
+
+    budget -= std::min(budget, bytes);
+    return true;
+}
+
+void TextureStreamer::update()
+{
+    if (m_pending.empty())
+    {
+        return;
+    }
+    std::size_t budget = m_bytes_per_frame;
+    for (auto const& pointer : m_pending)
+    {
+        TextureRequest& request = *pointer;
+        if (request.state == TextureRequest::DECODING)
+        {
+            if (!request.decoded.load(std::memory_order_acquire))
+            {
+                continue;
+            }
+            if (!request.error.empty())
+            {
+                std::cerr << request.error << std::endl;
+                request.state = TextureRequest::FAILED;
+                continue;
+            }
+            // allocate all levels up front, staged rows fill them over the following frames
+            request.texture.reset(new Tex{request.dimensions, GL_RGBA8});
+            for (unsigned level = 1; level < request.levels.size(); ++level)
+            {
+                glm::uvec2 size = level_dimensions(request.dimensions, level);
+                glTexImage2D(GL_TEXTURE_2D, GLint(level), GL_RGBA8, GLsizei(size.x), GLsizei(size.y), 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, nullptr);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(request.levels.size() - 1));
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, request.wrap_mode);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, request.wrap_mode);
+            request.state = TextureRequest::UPLOADING;
+        }
+        if (request.state == TextureRequest::UPLOADING)
+        {
+            while (budget > 0 && request.level < request.levels.size() && uploadRows(request, budget))
+            {
+            }
+            if (request.level == request.levels.size())
+            {
+                // resident once the gpu has consumed the last staged rows
+                request.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_NONE_BIT);
+                request.state = TextureRequest::FINISHING;
+                request.levels.clear();
+            }
+        }
+        else if (request.state == TextureRequest::FINISHING)
+        {
+            GLenum result = glClientWaitSync(request.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            {
+                glDeleteSync(request.fence);
+                request.fence = nullptr;
+                request.state = TextureRequest::RESIDENT;
+            }
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+                                   [](std::shared_ptr<TextureRequest> const& request)
+                                   {
+                                       return request->state == TextureRequest::RESIDENT ||
+                                              request->state == TextureRequest::FAILED;
+                                   }),
+                    m_pending.end());
+}
@@ -0,0 +1,57 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) : m_workers{}, m_tasks{}, m_mutex{}, m_wake{}, m_stop{false}
+{
+    if (threads == 0)
+    {
+        threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+        m_tasks.clear();
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> task{};
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_wake.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_stop)
+            {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,115 @@
+// compares culling random instances one by one, in sse batches and through the bvh
+// usage: cull_benchmark [--runs=N] [--instances=N]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "culling.hpp"
+
+namespace
+{
+template <typename F>
+double best_seconds(unsigned runs, F const& function)
+{
+    double best = 1e30;
+    for (unsigned i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned runs        = 20;
+    std::size_t instances = 100000;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg.compare(0, 7, "--runs=") == 0)
+        {
+            runs = std::max(1, std::stoi(arg.substr(7)));
+        }
+        else if (arg.compare(0, 12, "--instances=") == 0)
+        {
+            instances = std::stoul(arg.substr(12));
+        }
+        else
+        {
+            std::cerr << "usage: cull_benchmark [--runs=N] [--instances=N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // unit boxes scattered and rotated in a cube around a camera looking down -z
+    std::mt19937 random{42};
+    std::uniform_real_distribution<float> position{-200.0f, 200.0f};
+    std::uniform_real_distribution<float> angle{0.0f, 6.2831853f};
+    std::uniform_real_distribution<float> scale{0.5f, 3.0f};
+    Bounds const unit = compute_bounds(std::vector<glm::fvec3>{glm::fvec3{-1.0f}, glm::fvec3{1.0f}});
+    std::vector<Bounds> world;
+    world.reserve(instances);
+    for (std::size_t i = 0; i < instances; ++i)
+    {
+        glm::fmat4 model = glm::translate(glm::fmat4{1.0f}, glm::fvec3{position(random), position(random), position(random)});
+        model            = glm::rotate(model, angle(random), glm::normalize(glm::fvec3{1.0f, 2.0f, 3.0f}));
+        model            = glm::scale(model, glm::fvec3{scale(random)});
+        world.push_back(transform_bounds(unit, model));
+    }
+    glm::fmat4 const view       = glm::lookAt(glm::fvec3{0.0f}, glm::fvec3{0.0f, 0.0f, -1.0f}, glm::fvec3{0.0f, 1.0f, 0.0f});
+    glm::fmat4 const projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+    Frustum const frustum       = extract_frustum(projection * view);
+
+    std::size_t reference = 0;
+    double const scalar   = best_seconds(runs, [&]() {
+        reference = 0;
+        for (Bounds const& bounds : world)
+        {
+            reference += intersects(frustum, bounds) ? 1 : 0;
+        }
+    });
+
+    std::cout << instances << " instances, " << reference << " visible" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  scalar      " << scalar * 1e3 << " ms" << std::endl;
+    Visibility visibility;
+    for (Visibility::Mode mode : {Visibility::LINEAR, Visibility::BVH})
+    {
+        visibility.setMode(mode);
+        visibility.clear();
+        for (Bounds const& bounds : world)
+        {
+            visibility.add(bounds);
+        }
+        // the first bvh cull builds the tree, timed on its own
+        auto start   = std::chrono::steady_clock::now();
+        visibility.cull(frustum);
+        double first = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double best  = best_seconds(runs, [&]() { visibility.cull(frustum); });
+        std::cout << (mode == Visibility::LINEAR ? "  sse batch   " : "  bvh         ") << best * 1e3 << " ms";
+        if (mode == Visibility::BVH)
+        {
+            std::cout << ", " << first * 1e3 << " ms with build, " << visibility.nodeTests() << " nodes and "
+                      << visibility.instanceTests() << " instances tested";
+        }
+        std::cout << std::endl;
+        if (visibility.visibleCount() != reference)
+        {
+            std::cerr << "visible instances differ: " << visibility.visibleCount() << " instead of " << reference
+                      << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
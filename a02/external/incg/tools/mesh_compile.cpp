@@ -0,0 +1,84 @@
+// converts obj files into the binary mesh cache ahead of time
+// usage: mesh_compile [--normals=float|half|octahedral] input.obj [output]
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+#include "mesh_cache.hpp"
+
+int main(int argc, char* argv[])
+{
+    mesh_cache::NormalEncoding encoding = mesh_cache::NORMAL_HALF;
+    std::string input{};
+    std::string output{};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--normals=float")
+        {
+            encoding = mesh_cache::NORMAL_FLOAT;
+        }
+        else if (arg == "--normals=half")
+        {
+            encoding = mesh_cache::NORMAL_HALF;
+        }
+        else if (arg == "--normals=octahedral")
+        {
+            encoding = mesh_cache::NORMAL_OCTAHEDRAL;
+        }
+        else if (input.empty())
+        {
+            input = arg;
+        }
+        else
+        {
+            output = arg;
+        }
+    }
+    if (input.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--normals=float|half|octahedral] input.obj [output]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    // default name is the one simpleModel looks for
+    if (output.empty())
+    {
+        output = mesh_cache::cache_path(input);
+    }
+
+    try
+    {
+        obj_loader::Mesh mesh = obj_loader::load(input);
+        struct stat source;
+        stat(input.c_str(), &source);
+        mesh_cache::File file{
+            mesh_cache::build(mesh, encoding, std::uint64_t(source.st_size), std::int64_t(source.st_mtime))};
+        file.write(output);
+
+        std::vector<glm::vec3> positions, normals;
+        std::vector<std::uint32_t> indices;
+        file.unpack(positions, normals, indices);
+        std::vector<mesh_simplify::Lod> const lods = file.lods();
+        indices.resize(lods.front().index_count);
+        mesh_cache::Header const& header = file.header();
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << output << std::endl
+                  << "  vertices: " << mesh.positions.size() << " -> " << header.vertex_count << std::endl
+                  << "  acmr:     " << mesh_cache::acmr(mesh.indices) << " -> " << mesh_cache::acmr(indices)
+                  << std::endl
+                  << "  bytes:    " << mesh.positions.size() * 2 * sizeof(glm::vec3) + mesh.indices.size() * 4
+                  << " -> " << file.payloadSize() << ", " << header.index_size * 8 << " bit indices" << std::endl;
+        for (std::size_t level = 0; level < lods.size(); ++level)
+        {
+            std::cout << "  lod " << level << ":    " << lods[level].index_count / 3 << " triangles, error "
+                      << lods[level].error << std::endl;
+        }
+    }
+    catch (std::exception const& error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
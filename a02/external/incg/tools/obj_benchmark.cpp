@@ -0,0 +1,165 @@
+// compares the throughput of obj_loader with the fscanf parser it replaced
+// usage: obj_benchmark [--runs=N] [--threads=N] file.obj...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/type_precision.hpp>
+
+#include "mapped_file.hpp"
+#include "obj_loader.hpp"
+
+namespace
+{
+// former simpleModel parser without the gl upload, only supports v//vn faces
+bool legacy_parse(std::string const& filename, std::size_t& triangles)
+{
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> nIndices;
+
+    FILE* file = fopen(filename.c_str(), "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    while (1)
+    {
+        char lineHeader[128];
+        int res = fscanf(file, "%127s", lineHeader);
+        if (res == EOF) break;
+
+        if (strcmp(lineHeader, "v") == 0)
+        {
+            glm::vec3 vertex;
+            if (fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z) != 3) break;
+            vertices.push_back(vertex);
+        }
+        else if (strcmp(lineHeader, "vn") == 0)
+        {
+            glm::vec3 normal;
+            if (fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z) != 3) break;
+            normals.push_back(normal);
+        }
+        else if (strcmp(lineHeader, "f") == 0)
+        {
+            unsigned vIndex[3], nIndex[3];
+            int matches = fscanf(file, "%u//%u %u//%u %u//%u\n", &vIndex[0], &nIndex[0], &vIndex[1], &nIndex[1],
+                                 &vIndex[2], &nIndex[2]);
+            if (matches < 6)
+            {
+                fclose(file);
+                return false;
+            }
+            for (int i = 0; i < 3; ++i)
+            {
+                indices.push_back(vIndex[i] - 1);
+                nIndices.push_back(nIndex[i] - 1);
+            }
+        }
+    }
+    fclose(file);
+    triangles = indices.size() / 3;
+    return true;
+}
+
+template <typename F>
+double best_seconds(unsigned runs, F const& function)
+{
+    double best = 1e30;
+    for (unsigned i = 0; i < runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned runs    = 5;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> files{};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg.compare(0, 7, "--runs=") == 0)
+        {
+            runs = unsigned(std::max(1, std::stoi(arg.substr(7))));
+        }
+        else if (arg.compare(0, 10, "--threads=") == 0)
+        {
+            threads = unsigned(std::max(1, std::stoi(arg.substr(10))));
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [--runs=N] [--threads=N] file.obj..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (auto const& path : files)
+    {
+        double megabytes = 0.0;
+        {
+            MappedFile file{path};
+            megabytes = double(file.size()) / (1024.0 * 1024.0);
+        }
+        std::cout << path << ", " << megabytes << " MB" << std::endl;
+
+        std::size_t legacy_triangles = 0;
+        bool legacy_supported        = true;
+        double legacy = best_seconds(runs, [&]() { legacy_supported = legacy_parse(path, legacy_triangles); });
+        if (legacy_supported)
+        {
+            std::cout << "  fscanf:           " << megabytes / legacy << " MB/s, " << legacy_triangles
+                      << " triangles" << std::endl;
+        }
+        else
+        {
+            std::cout << "  fscanf:           face format not supported" << std::endl;
+        }
+
+        for (unsigned thread_count : {1u, threads})
+        {
+            std::size_t triangles = 0;
+            double seconds        = 0.0;
+            try
+            {
+                seconds = best_seconds(
+                    runs, [&]() { triangles = obj_loader::load(path, thread_count).indices.size() / 3; });
+            }
+            catch (obj_loader::ParseError const&)
+            {
+                // already reported by the loader
+                break;
+            }
+            std::cout << "  obj_loader (" << std::setw(2) << thread_count << "t): " << megabytes / seconds
+                      << " MB/s, " << triangles << " triangles";
+            if (legacy_supported)
+            {
+                std::cout << ", " << legacy / seconds << "x";
+            }
+            std::cout << std::endl;
+            if (thread_count == threads)
+            {
+                break;
+            }
+        }
+    }
+}
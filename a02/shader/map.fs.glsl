@@ -2,14 +2,25 @@
 
 layout(location = 0) out vec4 out0;  // color
 
-in vec2 uvc;
+in vec3 view_dir;
 
 uniform sampler2D envMap;
 uniform bool debugUV;
 
+#pragma incg_include "spherical_coordinates.inc.glsl"
+
 void main()
 {
+    vec2 uvc = SphericalCoordinates(normalize(view_dir));
+    // u jumps from 1 to 0 where atan wraps, take the gradient of the shifted copy there
+    // so the seam does not fall back to the smallest mip level
+    float u_wrapped = fract(uvc.x + 0.5);
+    vec2 dx = vec2(dFdx(uvc.x), dFdx(uvc.y));
+    vec2 dy = vec2(dFdy(uvc.x), dFdy(uvc.y));
+    if (abs(dFdx(u_wrapped)) < abs(dx.x)) dx.x = dFdx(u_wrapped);
+    if (abs(dFdy(u_wrapped)) < abs(dy.x)) dy.x = dFdy(u_wrapped);
+
     out0 = vec4( debugUV ? vec3(uvc, 0) 
-						 : texture2D(envMap, uvc).rgb
+						 : textureGrad(envMap, uvc, dx, dy).rgb
 			   , 1);
 }
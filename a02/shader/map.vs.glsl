@@ -1,16 +1,21 @@
 #version 330
 
-layout(location = 0) in vec3 vPosition;
-layout(location = 1) in vec2 vUV;
-
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
-uniform mat4 modelMatrix;
+layout(std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projMatrix;
+};
 
-out vec2 uvc;
+out vec3 view_dir;  // world space, not normalized
 
 void main()
 {
-    uvc         = vUV;
-    gl_Position = projMatrix * viewMatrix * modelMatrix * vec4(vPosition, 1);
+    // vertices (-1,-1), (3,-1), (-1,3) cover the viewport with one triangle
+    vec2 ndc = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    // point on the far plane, depth 1 after the perspective divide
+    gl_Position = vec4(ndc, 1, 1);
+
+    // direction is linear in screen space, so it can be interpolated unnormalized
+    vec4 view_pos = inverse(projMatrix) * gl_Position;
+    view_dir      = inverse(mat3(viewMatrix)) * (view_pos.xyz / view_pos.w);
 }
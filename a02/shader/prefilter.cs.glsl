@@ -0,0 +1,68 @@
+#version 430
+
+// convolves the environment map with the glossy reflection lobe of one roughness
+// into one level of the prefiltered map, run per level whenever the map changes
+
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(binding = 0) uniform sampler2D envMap;
+layout(binding = 0, rgba16f) uniform writeonly image2D prefiltered;
+
+// standard deviation of the facet normal perturbation, as in shaderC
+uniform float roughness;
+uniform int sampleCount;
+
+#pragma incg_include "spherical_coordinates.inc.glsl"
+
+const float GOLDEN_ANGLE = 2.39996323;
+
+// inverse of SphericalCoordinates
+vec3 direction(vec2 uv)
+{
+    float theta = uv.x * 2.0 * PI - PI;
+    float y     = cylindricMapping ? uv.y * 2.0 - 1.0 : -cos(uv.y * PI);
+    float s     = sqrt(max(0.0, 1.0 - y * y));
+    return vec3(cos(theta) * s, y, sin(theta) * s);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size  = imageSize(prefiltered);
+    if (texel.x >= size.x || texel.y >= size.y) return;
+
+    vec2 uv = (vec2(texel) + 0.5) / vec2(size);
+    if (roughness <= 0.0)
+    {
+        imageStore(prefiltered, texel, vec4(textureLod(envMap, uv, 0).rgb, 1));
+        return;
+    }
+
+    vec3 R = direction(uv);
+    vec3 tangent;
+    if (abs(R.x) > abs(R.y))
+        tangent = normalize(vec3(R.z, 0, -R.x));
+    else
+        tangent = normalize(vec3(0, -R.z, R.y));
+    vec3 bitangent = cross(R, tangent);
+
+    // a normal tilted by x tilts the reflection by about 2x
+    float sigma = 2.0 * roughness;
+    // read from the level whose texels match the sample spacing, so few samples do not alias
+    vec2 source       = vec2(textureSize(envMap, 0));
+    float texel_angle = max(2.0 * PI / source.x, PI / source.y);
+    float spacing     = sigma * sqrt(2.0 * PI / float(sampleCount));
+    float lod         = max(0.0, log2(spacing / texel_angle));
+
+    // gaussian distributed offsets on a golden angle spiral, radius by the inverse rayleigh cdf,
+    // so all samples carry equal weight
+    vec3 color = vec3(0);
+    for (int i = 0; i < sampleCount; i++)
+    {
+        float p      = (float(i) + 0.5) / float(sampleCount);
+        float radius = sigma * sqrt(-2.0 * log(1.0 - p));
+        float angle  = float(i) * GOLDEN_ANGLE;
+        vec3 dir     = normalize(R + radius * (cos(angle) * tangent + sin(angle) * bitangent));
+        color += textureLod(envMap, SphericalCoordinates(dir), lod).rgb;
+    }
+    imageStore(prefiltered, texel, vec4(color / float(sampleCount), 1));
+}
@@ -4,8 +4,11 @@ layout(location = 0) in vec3 vPosition;
 layout(location = 1) in vec3 vNormal;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+layout(std140) uniform Camera
+{
+    mat4 viewMatrix;
+    mat4 projMatrix;
+};
 
 #pragma incg_include "spherical_coordinates.inc.glsl"
 
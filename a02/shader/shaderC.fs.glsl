@@ -45,12 +45,35 @@ vec2 reflection(vec3 facet_normal_view_space)
 uniform float roughness;
 uniform int glossyRays;
 
+// environment convolved per roughness, level 0 is the sharp map
+uniform bool usePrefiltered;
+uniform sampler2D prefilteredMap;
+// roughness of level 1, every further level doubles it
+uniform float prefilteredRoughness;
+uniform float prefilteredMaxLevel;
+
+// single trilinear fetch replacing the ray loop
+vec3 prefilteredReflection(vec3 N)
+{
+    vec2 lookup_coord = reflection(N);
+    if (debugUV) return vec3(lookup_coord, 0);
+    float level = roughness < prefilteredRoughness ? roughness / prefilteredRoughness
+                                                   : 1.0 + log2(roughness / prefilteredRoughness);
+    return textureLod(prefilteredMap, lookup_coord, min(level, prefilteredMaxLevel)).rgb;
+}
+
 
 void main()
 {
     vec3 N          = normalize(normal_view_space);
     vec3 refl_color = vec3(0, 0, 0);
 
+    if (usePrefiltered)
+    {
+        out0 = vec4(prefilteredReflection(N), 1.0);
+        return;
+    }
+
     // TODO: Take glossyRays reflected samples, note the texture() call below.
     // The bias is used to get accurate samples and to bypass the texture mipmap level (wich otherwise results in the
     // brown visible pixel-seam)